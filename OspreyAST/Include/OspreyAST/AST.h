@@ -2,10 +2,13 @@
 
 #include "OspreyAST/Types.h"
 #include "OspreyAST/BinaryOperator.h"
+#include "OspreyAST/Symbol.h"
+#include "OspreyAST/ASTArena.h"
 
 #include <cstdint>
-#include <string>
 #include <memory>
+#include <string>
+#include <span>
 #include <vector>
 #include <optional>
 
@@ -13,19 +16,63 @@ namespace Osprey
 {
 	class ASTVisitor;
 	enum class ASTVisitorTraversal;
+	class LazyFunctionBody;
+
+	// The concrete type of a node, so that it can be checked without a dynamic_cast
+	enum class ASTNodeKind : uint8_t
+	{
+		Literal,
+		Variable,
+		UnaryExpr,
+		BinaryExpr,
+		FunctionCall,
+		FunctionExpr,
+		VariableDeclaration,
+		Return,
+		Block,
+		Assignment,
+		If,
+		While,
+		For,
+		Match,
+		FunctionDeclaration,
+		Program,
+	};
 
 	/*
 		All nodes in the AST must derive from ASTNode but should
 		derive from either ASTStmt or ASTExpr.
+
+		Nodes live in the ASTArena of their AST and are never destroyed
+		one at a time, so they hold no resources and have no virtual
+		destructor. Children are referenced by pointers into the arena.
 	*/
 	class ASTNode
 	{
 	public:
-		virtual ~ASTNode() = default;
-
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const = 0;
+
+		ASTNodeKind GetKind() const { return m_kind; }
+
+	protected:
+		ASTNode(ASTNodeKind kind)
+			: m_kind(kind)
+		{
+		}
+
+		~ASTNode() = default;
+
+	private:
+		ASTNodeKind m_kind;
 	};
 
+	// A cheaper dynamic_cast for nodes, returning null unless 'node' is a 'Node'
+	template<typename Node>
+	const Node* ASTNodeCast(const ASTNode* node)
+	{
+		return node->GetKind() == Node::Kind ? static_cast<const Node*>(node) : nullptr;
+	}
+
 	/*
 		Statements are units of code that perform an action but
 		does not produce a value itself.
@@ -34,6 +81,8 @@ namespace Osprey
 	*/
 	class ASTStmt : public ASTNode
 	{
+	protected:
+		using ASTNode::ASTNode;
 	};
 
 	/*
@@ -43,31 +92,54 @@ namespace Osprey
 	*/
 	class ASTExpr : public ASTNode
 	{
+	protected:
+		using ASTNode::ASTNode;
 	};
 
 	class ASTProgram : public ASTNode
 	{
 	public:
-		ASTProgram(std::vector<std::unique_ptr<ASTStmt>> statements);
-		virtual ~ASTProgram() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Program;
+
+		ASTProgram(std::span<const ASTStmt* const> statements);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::vector<std::unique_ptr<ASTStmt>>& GetStatements() const { return m_statements; }
+		std::span<const ASTStmt* const> GetStatements() const { return m_statements; }
 
 	private:
-		std::vector<std::unique_ptr<ASTStmt>> m_statements;
+		std::span<const ASTStmt* const> m_statements;
 	};
 
 	class AST
 	{
 	public:
-		AST(std::unique_ptr<ASTProgram> root);
+		// 'statement_token_starts' holds the index of the first token of each top-level
+		// statement. 'replaced_bytes' is how much of the arena is taken by statements that
+		// have since been replaced by Reparse.
+		AST(ASTArena arena, const ASTProgram* root, std::vector<uint32_t> statement_token_starts, std::vector<std::unique_ptr<LazyFunctionBody>> lazy_bodies = {}, size_t replaced_bytes = 0);
+		AST(AST&&) noexcept;
+		AST& operator=(AST&&) noexcept;
+		~AST();
+
+		const ASTProgram* GetRoot() const;
+		const ASTArena& GetArena() const { return m_arena; }
+
+		std::span<const uint32_t> GetStatementTokenStarts() const { return m_statement_token_starts; }
+		size_t GetReplacedBytes() const { return m_replaced_bytes; }
+		bool HasLazyFunctionBodies() const { return !m_lazy_bodies.empty(); }
 
-		const std::unique_ptr<ASTProgram>& GetRoot() const;
+		// Hands over the arena, and with it every node, leaving the AST empty
+		ASTArena TakeArena() &&;
 
 	private:
-		std::unique_ptr<ASTProgram> m_root;
+		// Owns every node reachable from the root, apart from those in function bodies
+		// the parser skipped, which are owned by their LazyFunctionBody
+		ASTArena m_arena;
+		const ASTProgram* m_root;
+		std::vector<uint32_t> m_statement_token_starts;
+		std::vector<std::unique_ptr<LazyFunctionBody>> m_lazy_bodies;
+		size_t m_replaced_bytes;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Osprey
+{
+	/*
+	* Bump allocator that owns every node of an AST and the arrays of children they
+	* point to. Nodes are laid out in the order the parser creates them, and are
+	* never destroyed individually: freeing the arena releases its blocks in bulk,
+	* which is why everything placed in it must be trivially destructible.
+	*/
+	class ASTArena
+	{
+	public:
+		ASTArena() = default;
+		ASTArena(ASTArena&&) noexcept = default;
+		ASTArena& operator=(ASTArena&&) noexcept = default;
+		ASTArena(const ASTArena&) = delete;
+		ASTArena& operator=(const ASTArena&) = delete;
+
+		template<typename T, typename... Args>
+		T* Make(Args&&... args)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "Objects in the arena are never destroyed");
+			return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		// Copies 'elements' into the arena, so the caller can reuse its buffer
+		template<typename T>
+		std::span<const T> MakeArray(std::span<const T> elements)
+		{
+			static_assert(std::is_trivially_destructible_v<T>, "Objects in the arena are never destroyed");
+			if (elements.empty())
+			{
+				return {};
+			}
+
+			T* data = static_cast<T*>(Allocate(elements.size_bytes(), alignof(T)));
+			std::uninitialized_copy(elements.begin(), elements.end(), data);
+			return { data, elements.size() };
+		}
+
+		template<typename T>
+		std::span<const T> MakeArray(const std::vector<T>& elements)
+		{
+			return MakeArray(std::span<const T>(elements));
+		}
+
+		// Takes over the blocks of 'other', whose objects stay where they are
+		void Adopt(ASTArena&& other);
+
+		size_t GetBytesAllocated() const { return m_bytes_allocated; }
+
+	private:
+		void* Allocate(size_t size, size_t alignment);
+
+		// Blocks double in size up to BlockSize, so that the many small arenas of lazily
+		// parsed function bodies stay small
+		static constexpr size_t FirstBlockSize = 1024;
+		static constexpr size_t BlockSize = 64 * 1024;
+
+		std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+		size_t m_next_block_size = FirstBlockSize;
+		std::byte* m_cursor = nullptr;
+		std::byte* m_end = nullptr;
+		size_t m_bytes_allocated = 0;
+	};
+}
\ No newline at end of file
@@ -19,6 +19,9 @@ namespace Osprey
 		ASTVisitorTraversal Visit(const class ASTBlock& node);
 		ASTVisitorTraversal Visit(const class ASTAssignmentStmt& node);
 		ASTVisitorTraversal Visit(const class ASTIfStmt& node);
+		ASTVisitorTraversal Visit(const class ASTWhileStmt& node);
+		ASTVisitorTraversal Visit(const class ASTForStmt& node);
+		ASTVisitorTraversal Visit(const class ASTMatchStmt& node);
 		ASTVisitorTraversal Visit(const class ASTFunctionCall& node);
 		ASTVisitorTraversal Visit(const class ASTFunctionDeclarationStmt& node);
 		ASTVisitorTraversal Visit(const class ASTProgram& Node);
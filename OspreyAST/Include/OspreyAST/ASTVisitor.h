@@ -20,6 +20,9 @@ namespace Osprey
 		virtual ASTVisitorTraversal Visit(const class ASTBlock& Node) = 0;
 		virtual ASTVisitorTraversal Visit(const class ASTAssignmentStmt& Node) = 0;
 		virtual ASTVisitorTraversal Visit(const class ASTIfStmt& Node) = 0;
+		virtual ASTVisitorTraversal Visit(const class ASTWhileStmt& Node) = 0;
+		virtual ASTVisitorTraversal Visit(const class ASTForStmt& Node) = 0;
+		virtual ASTVisitorTraversal Visit(const class ASTMatchStmt& Node) = 0;
 		virtual ASTVisitorTraversal Visit(const class ASTProgram& Node) = 0;
 		virtual ASTVisitorTraversal Visit(const class ASTFunctionCall& Node) = 0;
 		virtual ASTVisitorTraversal Visit(const class ASTFunctionDeclarationStmt& Node) = 0;
@@ -7,19 +7,20 @@ namespace Osprey
 	class ASTBinaryExpr : public ASTExpr
 	{
 	public:
-		ASTBinaryExpr(BinaryOperator op, std::unique_ptr<ASTExpr> left, std::unique_ptr<ASTExpr> right);
-		virtual ~ASTBinaryExpr() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::BinaryExpr;
+
+		ASTBinaryExpr(BinaryOperator op, const ASTExpr* left, const ASTExpr* right);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
 		BinaryOperator GetOperator() const;
-		const std::unique_ptr<ASTExpr>& GetLeftNode() const;
-		const std::unique_ptr<ASTExpr>& GetRightNode() const;
+		const ASTExpr* GetLeftNode() const;
+		const ASTExpr* GetRightNode() const;
 
 	private:
 		BinaryOperator m_op;
-		std::unique_ptr<ASTExpr> m_left_node;
-		std::unique_ptr<ASTExpr> m_right_node;
+		const ASTExpr* m_left_node;
+		const ASTExpr* m_right_node;
 	};
 }
\ No newline at end of file
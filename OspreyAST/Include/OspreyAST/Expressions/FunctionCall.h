@@ -7,17 +7,19 @@ namespace Osprey
 	class ASTFunctionCall : public ASTExpr
 	{
 	public:
-		ASTFunctionCall(std::string identifier, ArgumentList args);
-		virtual ~ASTFunctionCall() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::FunctionCall;
+
+		ASTFunctionCall(SymbolId symbol, ArgumentList args);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::string& GetIdentifier() const { return m_identifier; }
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
 		const ArgumentList& GetArgs() const { return m_args; }
 
 	private:
-		std::string m_identifier;
+		SymbolId m_symbol;
 		ArgumentList m_args;
 	};
 }
\ No newline at end of file
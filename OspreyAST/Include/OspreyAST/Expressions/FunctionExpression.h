@@ -1,41 +1,55 @@
 #pragma once
 
 #include "OspreyAST/AST.h"
+#include "OspreyAST/Tokeniser.h"
 
-#include <vector>
+#include <optional>
+#include <span>
 
 namespace Osprey
 {
 	class ASTBlock;
+	class LazyFunctionBody;
 
 	class FunctionParameter
 	{
 	public:
-		FunctionParameter(std::string identifier, Type type);
+		FunctionParameter(SymbolId symbol, Type type);
+
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
+		Type GetType() const { return m_type; }
 
 	private:
-		std::string m_identifier;
+		SymbolId m_symbol;
 		Type m_type;
 	};
 
-	using ParameterList = std::vector<FunctionParameter>;
+	using ParameterList = std::span<const FunctionParameter>;
 
 	class ASTFunctionExpr : public ASTExpr
 	{
 	public:
-		ASTFunctionExpr(std::vector<FunctionParameter> parameters, Type return_type, std::unique_ptr<ASTBlock> body);
-		virtual ~ASTFunctionExpr() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::FunctionExpr;
+
+		ASTFunctionExpr(ParameterList parameters, Type return_type, const ASTBlock* body);
+		// A function whose body is parsed the first time GetBody is called
+		ASTFunctionExpr(ParameterList parameters, Type return_type, const LazyFunctionBody* body);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const ParameterList& GetParameters() const;
+		ParameterList GetParameters() const;
 		Type GetReturnType() const;
-		const std::unique_ptr<ASTBlock>& GetBody() const;
+		// Null if the parser skipped the body and it fails to parse now, see GetBodyError
+		const ASTBlock* GetBody() const;
+		std::optional<ErrorMessage> GetBodyError() const;
 
 	private:
 		ParameterList m_parameters;
 		Type m_return_type;
-		std::unique_ptr<ASTBlock> m_body;
+		// Only one of these is set
+		const ASTBlock* m_body = nullptr;
+		const LazyFunctionBody* m_lazy_body = nullptr;
 	};
 }
\ No newline at end of file
@@ -7,8 +7,9 @@ namespace Osprey
 	class ASTLiteral : public ASTExpr
 	{
 	public:
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Literal;
+
 		ASTLiteral(Type type, int32_t value);
-		virtual ~ASTLiteral() = default;
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
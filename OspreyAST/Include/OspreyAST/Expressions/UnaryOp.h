@@ -7,17 +7,18 @@ namespace Osprey
 	class ASTUnaryExpr : public ASTExpr
 	{
 	public:
-		ASTUnaryExpr(UnaryOperator op, std::unique_ptr<ASTExpr> node);
-		virtual ~ASTUnaryExpr() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::UnaryExpr;
+
+		ASTUnaryExpr(UnaryOperator op, const ASTExpr* node);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
 		UnaryOperator GetOperator() const;
-		const std::unique_ptr<ASTExpr>& GetNode() const;
+		const ASTExpr* GetNode() const;
 
 	private:
 		UnaryOperator m_op;
-		std::unique_ptr<ASTExpr> m_node;
+		const ASTExpr* m_node;
 	};
 }
\ No newline at end of file
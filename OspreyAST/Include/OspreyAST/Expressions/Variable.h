@@ -7,15 +7,17 @@ namespace Osprey
 	class ASTVariable : public ASTExpr
 	{
 	public:
-		ASTVariable(std::string identifier);
-		virtual ~ASTVariable() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Variable;
+
+		ASTVariable(SymbolId symbol);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::string& GetIdentifier() const;
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
 
 	private:
-		std::string m_identifier;
+		SymbolId m_symbol;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "OspreyAST/AST.h"
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Osprey
+{
+	// A node of a FlatAST is its index into the FlatAST's arrays
+	using FlatNodeId = uint32_t;
+
+	constexpr FlatNodeId InvalidFlatNode = std::numeric_limits<FlatNodeId>::max();
+
+	enum class FlatNodeKind : uint8_t
+	{
+		Program,
+		Literal,
+		Variable,
+		UnaryExpr,
+		BinaryExpr,
+		FunctionCall,
+		FunctionExpr,
+		VariableDeclaration,
+		Return,
+		Block,
+		Assignment,
+		If,
+		While,
+		For,
+		Match,
+		FunctionDeclaration,
+	};
+
+	// Whether a FlatAST takes in the bodies of functions nested below its root
+	enum class FlatNestedFunctions : uint8_t
+	{
+		Include,
+		// For passes that work a function at a time, which then leave the bodies of
+		// functions the parser skipped unparsed until they get to them
+		Exclude,
+	};
+
+	/*
+	* The AST stored as parallel arrays indexed by FlatNodeId, for passes that want to walk
+	* it linearly rather than through virtual calls. Nodes are in pre-order, so the subtree
+	* of a node is the range from the node up to GetSubtreeEnd. Each node has a kind, a
+	* payload and two operands, and anything that does not fit in those lives in the extra
+	* array that the operands index into:
+	*
+	*   kind                 payload          lhs                        rhs
+	*   Program, Block       -                extra: statements          statement count
+	*   Literal              value            -                          -
+	*   Variable             symbol           -                          -
+	*   UnaryExpr            UnaryOperator    operand                    -
+	*   BinaryExpr           BinaryOperator   left                       right
+	*   FunctionCall         symbol           extra: arguments           argument count
+	*   FunctionExpr         return DataType  extra: count, (symbol, DataType)*  body
+	*   VariableDeclaration  symbol           initialiser                DataType
+	*   Return               -                expression                 -
+	*   Assignment           symbol           expression                 -
+	*   If                   -                predicate                  extra: true block, false block
+	*   While                -                predicate                  body
+	*   For                  symbol           extra: start, limit        body
+	*   Match                -                value                      extra: else arm, arm count, (body, value count, values*)*
+	*   FunctionDeclaration  symbol           function                   -
+	*
+	* Missing blocks, i.e. an 'if' without an 'else', are InvalidFlatNode, as are the bodies
+	* of nested functions when they are excluded and bodies that fail to parse. While passes
+	* move over, each node remembers the AST node it was converted from.
+	*/
+	class FlatAST
+	{
+	public:
+		explicit FlatAST(const ASTNode& root, FlatNestedFunctions nested_functions = FlatNestedFunctions::Include);
+
+		size_t GetNodeCount() const { return m_kinds.size(); }
+		FlatNodeId GetRoot() const { return 0; }
+
+		FlatNodeKind GetKind(FlatNodeId node) const { return m_kinds[node]; }
+		uint32_t GetPayload(FlatNodeId node) const { return m_payloads[node]; }
+		uint32_t GetLhs(FlatNodeId node) const { return m_lhs[node]; }
+		uint32_t GetRhs(FlatNodeId node) const { return m_rhs[node]; }
+		// One past the last node in the subtree of 'node'
+		FlatNodeId GetSubtreeEnd(FlatNodeId node) const { return m_subtree_ends[node]; }
+		std::span<const uint32_t> GetExtra(uint32_t index, size_t count) const { return std::span(m_extra).subspan(index, count); }
+
+		std::span<const FlatNodeKind> GetKinds() const { return m_kinds; }
+
+		// The statements of a Program or Block, or the arguments of a FunctionCall
+		std::span<const FlatNodeId> GetChildren(FlatNodeId node) const;
+
+		const ASTNode* GetSource(FlatNodeId node) const { return m_sources[node]; }
+		FlatNodeId FindNode(const ASTNode& source) const;
+
+	private:
+		friend class FlatASTBuilder;
+
+		std::vector<FlatNodeKind> m_kinds;
+		std::vector<uint32_t> m_payloads;
+		std::vector<uint32_t> m_lhs;
+		std::vector<uint32_t> m_rhs;
+		std::vector<FlatNodeId> m_subtree_ends;
+		std::vector<uint32_t> m_extra;
+
+		std::vector<const ASTNode*> m_sources;
+		std::unordered_map<const ASTNode*, FlatNodeId> m_ids;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "OspreyAST/ASTArena.h"
+#include "OspreyAST/Tokeniser.h"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Osprey
+{
+	class ASTBlock;
+	class LazyFunctionBody;
+
+	using LazyFunctionBodies = std::vector<std::unique_ptr<LazyFunctionBody>>;
+
+	/*
+	* The tokens of a function body that the parser skipped over by matching its braces.
+	* The body is parsed into an arena of its own the first time it is asked for, so a
+	* function that is never used costs no more than finding its closing brace. Function
+	* bodies nested inside it are skipped in turn and owned by it.
+	*
+	* It holds a span of the tokens rather than their TokenBuffer, so it is not affected
+	* by the buffer being moved, e.g. into a ParsedScript. The tokens themselves, and the
+	* script, must outlive it. Get may be called from several threads at once.
+	*/
+	class LazyFunctionBody
+	{
+	public:
+		// 'tokens' run from the body's '{' to its '}', their lexemes are views into 'source'
+		LazyFunctionBody(std::span<const Token> tokens, std::string_view source);
+
+		// The body, or null if it fails to parse
+		const ASTBlock* Get() const;
+		// Why Get returned null
+		const std::optional<ErrorMessage>& GetError() const;
+
+	private:
+		void Parse() const;
+
+		std::span<const Token> m_tokens;
+		std::string_view m_source;
+
+		mutable std::once_flag m_parsed;
+		mutable ASTArena m_arena;
+		mutable LazyFunctionBodies m_nested_bodies;
+		mutable const ASTBlock* m_body = nullptr;
+		mutable std::optional<ErrorMessage> m_error;
+	};
+}
\ No newline at end of file
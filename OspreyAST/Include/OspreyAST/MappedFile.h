@@ -0,0 +1,37 @@
+#pragma once
+
+#include "OspreyAST/Tokeniser.h"
+
+#include <filesystem>
+
+namespace Osprey
+{
+	/*
+	* A script file mapped read-only into memory, so it can be tokenised and parsed
+	* without reading it into a buffer first. The OS pages it in as the TokenStream
+	* walks through it. The view returned by GetContents lives as long as the file.
+	*/
+	class MappedFile
+	{
+	public:
+		static std::expected<MappedFile, ErrorMessage> Open(const std::filesystem::path& path);
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		std::string_view GetContents() const { return { m_data, m_size }; }
+
+	private:
+		MappedFile(const char* data, size_t size, void* mapping);
+
+		void Unmap();
+
+		const char* m_data;
+		size_t m_size;
+		// The file mapping object on Windows, unused elsewhere
+		void* m_mapping;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Osprey
+{
+	// Calls 'task' with each index in [0, count) from up to 'thread_count' threads
+	template<typename Task>
+	void ParallelFor(size_t count, size_t thread_count, const Task& task)
+	{
+		std::atomic<size_t> next_index = 0;
+		const auto worker = [&]()
+			{
+				for (size_t index = next_index++; index < count; index = next_index++)
+				{
+					task(index);
+				}
+			};
+
+		std::vector<std::jthread> threads;
+		for (size_t thread = 1; thread < std::min(count, thread_count); ++thread)
+		{
+			threads.emplace_back(worker);
+		}
+		worker();
+	}
+}
\ No newline at end of file
@@ -1,15 +1,60 @@
 #pragma once
 
-#include "OspreyAST/Token.h"
+#include "OspreyAST/Tokeniser.h"
 #include "OspreyAST/AST.h"
 
-#include <vector>
+#include <cstddef>
 #include <expected>
+#include <string_view>
 
 namespace Osprey
 {
-	using TokenBuffer = std::vector<Token>;
-	using ErrorMessage = std::string;
+	struct ParseOptions
+	{
+		// Threads to parse top-level statements on, or 0 for one per hardware thread. Parsing
+		// in parallel has not been shown to be faster in general, so it is opt-in.
+		size_t thread_count = 1;
 
-	std::expected<AST, ErrorMessage> Parse(const TokenBuffer& tokens);
+		// Top-level statements are handed to the threads in runs of at least this many tokens,
+		// so scripts smaller than this are parsed on the calling thread
+		size_t min_chunk_tokens = 16 * 1024;
+
+		// Skip over function bodies by matching their braces, and parse each the first time
+		// ASTFunctionExpr::GetBody is called, so that startup only pays for the functions a
+		// script uses. Errors in a body are then only found once it is parsed. The tokens
+		// must outlive the AST, though their TokenBuffer may be moved.
+		bool lazy_function_bodies = false;
+	};
+
+	std::expected<AST, ErrorMessage> Parse(const TokenBuffer& tokens, const ParseOptions& options = {});
+
+	// Parses straight from the source, e.g. a TokenStream, holding only a few tokens at a time
+	std::expected<AST, ErrorMessage> Parse(TokenSource& source);
+
+	// Replaces the 'length' bytes of a script at 'offset' with 'text'
+	struct TextEdit
+	{
+		size_t offset;
+		size_t length;
+		std::string_view text;
+	};
+
+	// The tokens of a script and the AST parsed from them
+	struct ParsedScript
+	{
+		TokenBuffer tokens;
+		AST ast;
+	};
+
+	// Parses 'source', which is the script 'previous_tokens' were read from with 'edit'
+	// applied, reusing what the edit leaves untouched. Only the tokens from the start of
+	// the top-level statement the edit falls in are read again, up to where they line up
+	// with the previous tokens, and only the statements those cover are parsed again.
+	// The others are moved over from 'previous', so the work follows the size of the edit
+	// rather than that of the script, bar moving the tokens after it along.
+	//
+	// The whole script is parsed again if the statements around the edit do not parse on
+	// their own, if 'previous' has lazily parsed function bodies, which refer to tokens
+	// the edit moves, and once replaced statements take up too much of the AST's arena.
+	std::expected<ParsedScript, ErrorMessage> Reparse(AST previous, TokenBuffer previous_tokens, std::string_view source, const TextEdit& edit);
 }
\ No newline at end of file
@@ -7,17 +7,19 @@ namespace Osprey
 	class ASTAssignmentStmt : public ASTStmt
 	{
 	public:
-		ASTAssignmentStmt(std::string identifier, std::unique_ptr<ASTExpr> expression);
-		virtual ~ASTAssignmentStmt() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Assignment;
+
+		ASTAssignmentStmt(SymbolId symbol, const ASTExpr* expression);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::string& GetIdentifier() const { return m_identifier; }
-		const std::unique_ptr<ASTExpr>& GetExpressionNode() const { return m_expr; }
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
+		const ASTExpr* GetExpressionNode() const { return m_expr; }
 
 	private:
-		std::string m_identifier;
-		std::unique_ptr<ASTExpr> m_expr;
+		SymbolId m_symbol;
+		const ASTExpr* m_expr;
 	};
 }
\ No newline at end of file
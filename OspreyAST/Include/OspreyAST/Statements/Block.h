@@ -7,15 +7,16 @@ namespace Osprey
 	class ASTBlock : public ASTStmt
 	{
 	public:
-		ASTBlock(std::vector<std::unique_ptr<ASTStmt>> statements);
-		virtual ~ASTBlock() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Block;
+
+		ASTBlock(std::span<const ASTStmt* const> statements);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::vector<std::unique_ptr<ASTStmt>>& GetStatements() const;
+		std::span<const ASTStmt* const> GetStatements() const;
 
 	private:
-		std::vector<std::unique_ptr<ASTStmt>> m_statements;
+		std::span<const ASTStmt* const> m_statements;
 	};
 }
\ No newline at end of file
@@ -7,15 +7,14 @@ namespace Osprey
 	class ASTExprStmt : public ASTStmt
 	{
 	public:
-		ASTExprStmt(std::unique_ptr<ASTExpr> expr);
-		virtual ~ASTExprStmt() = default;
+		ASTExprStmt(const ASTExpr* expr);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::unique_ptr<ASTExpr>& GetExpression() const { return m_expr; }
+		const ASTExpr* GetExpression() const { return m_expr; }
 
 	private:
-		std::unique_ptr<ASTExpr> m_expr;
+		const ASTExpr* m_expr;
 	};
 }
\ No newline at end of file
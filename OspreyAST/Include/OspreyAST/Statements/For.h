@@ -0,0 +1,37 @@
+#pragma once
+
+#include "OspreyAST/AST.h"
+
+namespace Osprey
+{
+	class ASTBlock;
+	class ASTExpr;
+
+	/*
+	* A counted loop, 'for (i = start, limit) { ... }'. The induction variable is an i32
+	* scoped to the body that steps by one from 'start' while it is less than 'limit'.
+	* The limit is evaluated once, before the first iteration.
+	*/
+	class ASTForStmt : public ASTStmt
+	{
+	public:
+		static constexpr ASTNodeKind Kind = ASTNodeKind::For;
+
+		ASTForStmt(SymbolId symbol, const ASTExpr* start, const ASTExpr* limit, const ASTBlock* body);
+
+		// ASTNode
+		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
+
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
+		const ASTExpr* GetStart() const;
+		const ASTExpr* GetLimit() const;
+		const ASTBlock* GetBody() const;
+
+	private:
+		SymbolId m_symbol;
+		const ASTExpr* m_start;
+		const ASTExpr* m_limit;
+		const ASTBlock* m_body;
+	};
+}
\ No newline at end of file
@@ -9,17 +9,19 @@ namespace Osprey
 	class ASTFunctionDeclarationStmt : public ASTStmt
 	{
 	public:
-		ASTFunctionDeclarationStmt(std::string identifier, std::unique_ptr<ASTFunctionExpr> function_expr);
-		virtual ~ASTFunctionDeclarationStmt() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::FunctionDeclaration;
+
+		ASTFunctionDeclarationStmt(SymbolId symbol, const ASTFunctionExpr* function_expr);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::string& GetIdentifier() const { return m_identifier; }
-		const std::unique_ptr<ASTFunctionExpr>& GetFunction() const { return m_function_expr; }
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
+		const ASTFunctionExpr* GetFunction() const { return m_function_expr; }
 
 	private:
-		std::string m_identifier;
-		std::unique_ptr<ASTFunctionExpr> m_function_expr;
+		SymbolId m_symbol;
+		const ASTFunctionExpr* m_function_expr;
 	};
 }
\ No newline at end of file
@@ -10,17 +10,21 @@ namespace Osprey
 	class ASTIfStmt : public ASTStmt
 	{
 	public:
-		ASTIfStmt(std::unique_ptr<ASTExpr> predicate, std::unique_ptr<ASTBlock> true_block);
-		virtual ~ASTIfStmt() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::If;
+
+		ASTIfStmt(const ASTExpr* predicate, const ASTBlock* true_block, const ASTBlock* false_block = nullptr);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::unique_ptr<ASTExpr>& GetPredicate() const;
-		const std::unique_ptr<ASTBlock>& GetTrueBlock() const;
+		const ASTExpr* GetPredicate() const;
+		const ASTBlock* GetTrueBlock() const;
+		// nullptr if there is no 'else'
+		const ASTBlock* GetFalseBlock() const;
 
 	private:
-		std::unique_ptr<ASTExpr> m_predicate;
-		std::unique_ptr<ASTBlock> m_true_block;
+		const ASTExpr* m_predicate;
+		const ASTBlock* m_true_block;
+		const ASTBlock* m_false_block;
 	};
 }
\ No newline at end of file
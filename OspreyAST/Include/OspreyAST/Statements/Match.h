@@ -0,0 +1,44 @@
+#pragma once
+
+#include "OspreyAST/AST.h"
+
+#include <span>
+
+namespace Osprey
+{
+	class ASTBlock;
+	class ASTExpr;
+
+	// The block run when the matched value equals any of 'values'
+	struct MatchArm
+	{
+		std::span<const int32_t> values;
+		const ASTBlock* body;
+	};
+
+	/*
+	* Runs the arm whose values contain the i32 being matched, or the 'else' arm if there
+	* is one and no other arm matches. Each value appears in at most one arm and control
+	* never falls through from one arm into the next.
+	*/
+	class ASTMatchStmt : public ASTStmt
+	{
+	public:
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Match;
+
+		ASTMatchStmt(const ASTExpr* value, std::span<const MatchArm> arms, const ASTBlock* else_arm = nullptr);
+
+		// ASTNode
+		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
+
+		const ASTExpr* GetValue() const;
+		std::span<const MatchArm> GetArms() const;
+		// nullptr if there is no 'else'
+		const ASTBlock* GetElseArm() const;
+
+	private:
+		const ASTExpr* m_value;
+		std::span<const MatchArm> m_arms;
+		const ASTBlock* m_else_arm;
+	};
+}
\ No newline at end of file
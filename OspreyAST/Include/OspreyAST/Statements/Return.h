@@ -7,15 +7,16 @@ namespace Osprey
 	class ASTReturn : public ASTStmt
 	{
 	public:
-		ASTReturn(std::unique_ptr<ASTExpr> expression);
-		virtual ~ASTReturn() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::Return;
+
+		ASTReturn(const ASTExpr* expression);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::unique_ptr<ASTExpr>& GetExpressionNode() const;
+		const ASTExpr* GetExpressionNode() const;
 
 	private:
-		std::unique_ptr<ASTExpr> m_expression_node;
+		const ASTExpr* m_expression_node;
 	};
 }
\ No newline at end of file
@@ -7,19 +7,21 @@ namespace Osprey
 	class ASTVariableDeclarationStmt : public ASTStmt
 	{
 	public:
-		ASTVariableDeclarationStmt(std::string identifier, Type type, std::unique_ptr<ASTExpr> expression);
-		virtual ~ASTVariableDeclarationStmt() = default;
+		static constexpr ASTNodeKind Kind = ASTNodeKind::VariableDeclaration;
+
+		ASTVariableDeclarationStmt(SymbolId symbol, Type type, const ASTExpr* expression);
 
 		// ASTNode
 		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
 
-		const std::string& GetIdentifier() const;
+		const std::string& GetIdentifier() const { return SymbolTable::GetName(m_symbol); }
+		SymbolId GetSymbol() const { return m_symbol; }
 		Type GetType() const { return m_type; }
-		const std::unique_ptr<ASTExpr>& GetExpressionNode() const;
+		const ASTExpr* GetExpressionNode() const;
 
 	private:
-		std::string m_identifier;
+		SymbolId m_symbol;
 		Type m_type;
-		std::unique_ptr<ASTExpr> m_expression_node;
+		const ASTExpr* m_expression_node;
 	};
 }
\ No newline at end of file
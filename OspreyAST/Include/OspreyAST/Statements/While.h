@@ -0,0 +1,27 @@
+#pragma once
+
+#include "OspreyAST/AST.h"
+
+namespace Osprey
+{
+	class ASTBlock;
+	class ASTExpr;
+
+	class ASTWhileStmt : public ASTStmt
+	{
+	public:
+		static constexpr ASTNodeKind Kind = ASTNodeKind::While;
+
+		ASTWhileStmt(const ASTExpr* predicate, const ASTBlock* body);
+
+		// ASTNode
+		virtual ASTVisitorTraversal Accept(ASTVisitor& visitor) const override;
+
+		const ASTExpr* GetPredicate() const;
+		const ASTBlock* GetBody() const;
+
+	private:
+		const ASTExpr* m_predicate;
+		const ASTBlock* m_body;
+	};
+}
\ No newline at end of file
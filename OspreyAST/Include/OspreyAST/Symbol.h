@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Osprey
+{
+	// Identifiers are interned to a SymbolId when tokenised so later phases
+	// compare and hash integers rather than strings. Zero is never assigned.
+	using SymbolId = uint32_t;
+
+	constexpr SymbolId InvalidSymbol = 0;
+
+	/*
+	* Process-wide identifier interner. Ids are stable for the lifetime of the
+	* process, so scripts tokenised separately share them.
+	*/
+	class SymbolTable
+	{
+	public:
+		static SymbolId Intern(std::string_view name);
+		static const std::string& GetName(SymbolId symbol);
+	};
+}
\ No newline at end of file
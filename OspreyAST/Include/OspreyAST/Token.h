@@ -1,10 +1,12 @@
 #pragma once
 
-#include <string>
+#include "OspreyAST/Symbol.h"
+
+#include <cstdint>
 
 namespace Osprey
 {
-	enum class TokenType
+	enum class TokenType : uint8_t
 	{
 		Identifier,
 		Assign,
@@ -20,6 +22,10 @@ namespace Osprey
 		LeftParen,
 		RightParen,
 		If,
+		Else,
+		While,
+		For,
+		Match,
 		LeftCurly,
 		RightCurly,
 		I32,
@@ -33,14 +39,17 @@ namespace Osprey
 		Or,
 		Comma,
 		RightArrow,
+		FatArrow,
 		Mutable,
 	};
 
+	// A token refers to its text in the script rather than owning it, see TokenBuffer
 	struct Token
 	{
 		TokenType type;
-		std::string lexeme;
-		size_t line;
-		size_t column;
+		uint32_t offset;
+		uint32_t length;
+		// Set for identifiers only
+		SymbolId symbol = InvalidSymbol;
 	};
 }
\ No newline at end of file
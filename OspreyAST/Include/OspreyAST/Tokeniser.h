@@ -3,12 +3,106 @@
 #include "OspreyAST/Token.h"
 
 #include <vector>
+#include <span>
+#include <string>
+#include <string_view>
 #include <expected>
+#include <optional>
 
 namespace Osprey
 {
-	using TokenBuffer = std::vector<Token>;
 	using ErrorMessage = std::string;
 
-	std::expected<TokenBuffer, ErrorMessage> Tokenise(const std::string in_script);
+	// Both 1-based, with tabs counted as 4 columns
+	struct SourceLocation
+	{
+		size_t line;
+		size_t column;
+	};
+
+	/*
+	* The tokens of a script, which view their lexemes in the script rather than
+	* copying them, so the script must outlive the buffer. Lines and columns are
+	* not tracked while tokenising, GetLocation works them out when a diagnostic
+	* needs one.
+	*/
+	class TokenBuffer
+	{
+	public:
+		explicit TokenBuffer(std::string_view source);
+
+		void Push(const Token& token) { m_tokens.push_back(token); }
+		// Moves the buffer over to 'source', an edited copy of its script, replacing the tokens
+		// in [begin, end) with 'tokens'. The tokens after are moved along by 'offset_shift'
+		// bytes, by which the edit changed the length of the text before them.
+		void Replace(size_t begin, size_t end, std::span<const Token> tokens, int64_t offset_shift, std::string_view source);
+
+		size_t size() const { return m_tokens.size(); }
+		const Token& operator[](size_t index) const { return m_tokens[index]; }
+		std::vector<Token>::const_iterator begin() const { return m_tokens.begin(); }
+		std::vector<Token>::const_iterator end() const { return m_tokens.end(); }
+		// Stays valid when the buffer is moved, but not once it is changed or destroyed
+		std::span<const Token> GetTokens() const { return m_tokens; }
+
+		std::string_view GetSource() const { return m_source; }
+		std::string_view GetLexeme(const Token& token) const { return m_source.substr(token.offset, token.length); }
+		SourceLocation GetLocation(const Token& token) const;
+
+	private:
+		std::string_view m_source;
+		std::vector<Token> m_tokens;
+	};
+
+	/*
+	* The offset at which each line of a script starts, for turning the offsets held by
+	* tokens into lines and columns. Built on demand, as only diagnostics need it.
+	*/
+	class SourceLineIndex
+	{
+	public:
+		explicit SourceLineIndex(std::string_view source);
+
+		SourceLocation GetLocation(size_t offset) const;
+
+	private:
+		std::string_view m_source;
+		std::vector<size_t> m_line_offsets;
+	};
+
+	/*
+	* Anything the parser can pull tokens from one at a time. Next returns std::nullopt
+	* once the source is exhausted. The lexemes of the tokens are views into GetSource.
+	*/
+	class TokenSource
+	{
+	public:
+		virtual ~TokenSource() = default;
+
+		virtual std::expected<std::optional<Token>, ErrorMessage> Next() = 0;
+		virtual std::string_view GetSource() const = 0;
+	};
+
+	/*
+	* Tokenises a script on demand, so the parser can consume it without the whole
+	* token vector ever being materialised. The script can be a string in memory or
+	* a MappedFile, and must outlive the stream and any tokens it produces.
+	*/
+	class TokenStream : public TokenSource
+	{
+	public:
+		explicit TokenStream(std::string_view source);
+		// Starts at 'offset', which must not be inside a token. The tokeniser carries
+		// nothing over from one token to the next, so this yields the same tokens as
+		// starting from the beginning would from there on.
+		TokenStream(std::string_view source, size_t offset);
+
+		std::expected<std::optional<Token>, ErrorMessage> Next() override;
+		std::string_view GetSource() const override { return m_source; }
+
+	private:
+		std::string_view m_source;
+		size_t m_cursor;
+	};
+
+	std::expected<TokenBuffer, ErrorMessage> Tokenise(std::string_view script);
 }
\ No newline at end of file
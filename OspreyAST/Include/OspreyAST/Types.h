@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <span>
 #include <variant>
 #include <optional>
 #include <functional>
@@ -31,6 +32,9 @@ namespace Osprey
 
 		std::string ToString() const;
 
+		// Returns the data type, or std::nullopt if this is a function type
+		std::optional<DataType> GetDataType() const;
+
 	private:
 		std::variant<DataType, FunctionType*> m_type;
 	};
@@ -71,6 +75,6 @@ namespace Osprey
 
 	struct ArgumentList
 	{
-		std::vector<std::unique_ptr<class ASTExpr>> args;
+		std::span<const class ASTExpr* const> args;
 	};
 }
\ No newline at end of file
@@ -1,13 +1,15 @@
 #include "OspreyAST/AST.h"
 
 #include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/LazyFunctionBody.h"
 
 #include <print>
 
 namespace Osprey
 {
-	ASTProgram::ASTProgram(std::vector<std::unique_ptr<ASTStmt>> statements)
-		: m_statements(std::move(statements))
+	ASTProgram::ASTProgram(std::span<const ASTStmt* const> statements)
+		: ASTNode(ASTNodeKind::Program)
+		, m_statements(statements)
 	{
 	}
 
@@ -16,13 +18,28 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	AST::AST(std::unique_ptr<ASTProgram> root)
-		: m_root(std::move(root))
+	AST::AST(ASTArena arena, const ASTProgram* root, std::vector<uint32_t> statement_token_starts, std::vector<std::unique_ptr<LazyFunctionBody>> lazy_bodies, size_t replaced_bytes)
+		: m_arena(std::move(arena))
+		, m_root(root)
+		, m_statement_token_starts(std::move(statement_token_starts))
+		, m_lazy_bodies(std::move(lazy_bodies))
+		, m_replaced_bytes(replaced_bytes)
 	{
 	}
 
-	const std::unique_ptr<ASTProgram>& AST::GetRoot() const
+	AST::AST(AST&&) noexcept = default;
+	AST& AST::operator=(AST&&) noexcept = default;
+	AST::~AST() = default;
+
+	const ASTProgram* AST::GetRoot() const
 	{
 		return m_root;
 	}
+
+	ASTArena AST::TakeArena() &&
+	{
+		m_root = nullptr;
+		m_statement_token_starts.clear();
+		return std::move(m_arena);
+	}
 }
\ No newline at end of file
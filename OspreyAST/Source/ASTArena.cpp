@@ -0,0 +1,60 @@
+#include "OspreyAST/ASTArena.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+
+namespace Osprey
+{
+	void ASTArena::Adopt(ASTArena&& other)
+	{
+		// Allocation carries on in whichever arena has more room left in its current block
+		if (other.m_end - other.m_cursor > m_end - m_cursor)
+		{
+			std::swap(m_cursor, other.m_cursor);
+			std::swap(m_end, other.m_end);
+		}
+
+		m_blocks.insert(m_blocks.end(), std::make_move_iterator(other.m_blocks.begin()), std::make_move_iterator(other.m_blocks.end()));
+		m_bytes_allocated += other.m_bytes_allocated;
+		m_next_block_size = std::max(m_next_block_size, other.m_next_block_size);
+
+		other.m_blocks.clear();
+		other.m_cursor = nullptr;
+		other.m_end = nullptr;
+		other.m_bytes_allocated = 0;
+		other.m_next_block_size = FirstBlockSize;
+	}
+
+	void* ASTArena::Allocate(size_t size, size_t alignment)
+	{
+		assert(std::has_single_bit(alignment) && alignment <= alignof(std::max_align_t));
+
+		const uintptr_t address = reinterpret_cast<uintptr_t>(m_cursor);
+		std::byte* aligned = m_cursor + ((alignment - address % alignment) % alignment);
+		if (!m_cursor || aligned + size > m_end)
+		{
+			// Oversized requests get a block of their own so the current block keeps its space
+			if (size > BlockSize / 4)
+			{
+				m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+				m_bytes_allocated += size;
+				return m_blocks.back().get();
+			}
+
+			const size_t block_size = std::max(m_next_block_size, size);
+			m_next_block_size = std::min(m_next_block_size * 2, BlockSize);
+
+			m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+			m_cursor = m_blocks.back().get();
+			m_end = m_cursor + block_size;
+			aligned = m_cursor;
+		}
+
+		m_cursor = aligned + size;
+		m_bytes_allocated += size;
+		return aligned;
+	}
+}
\ No newline at end of file
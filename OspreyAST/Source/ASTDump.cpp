@@ -5,10 +5,15 @@
 #include "OspreyAST/Expressions/UnaryOp.h"
 #include "OspreyAST/Expressions/BinaryOp.h"
 #include "OspreyAST/Expressions/FunctionCall.h"
+#include "OspreyAST/Expressions/FunctionExpression.h"
 #include "OspreyAST/Statements/VariableDecl.h"
 #include "OspreyAST/Statements/Return.h"
 #include "OspreyAST/Statements/If.h"
+#include "OspreyAST/Statements/While.h"
+#include "OspreyAST/Statements/For.h"
+#include "OspreyAST/Statements/Match.h"
 #include "OspreyAST/Statements/Block.h"
+#include "OspreyAST/Statements/FunctionDecl.h"
 
 #include <print>
 
@@ -76,6 +81,72 @@ namespace Osprey
 	{
 		PrintIndented("if_statement");
 
+		++m_indent;
+		node.GetPredicate()->Accept(*this);
+		node.GetTrueBlock()->Accept(*this);
+		if (node.GetFalseBlock())
+		{
+			node.GetFalseBlock()->Accept(*this);
+		}
+		--m_indent;
+
+		return ASTVisitorTraversal::Continue;
+	}
+
+	ASTVisitorTraversal ASTDump::Visit(const ASTWhileStmt& node)
+	{
+		PrintIndented("while_statement");
+
+		++m_indent;
+		node.GetPredicate()->Accept(*this);
+		node.GetBody()->Accept(*this);
+		--m_indent;
+
+		return ASTVisitorTraversal::Continue;
+	}
+
+	ASTVisitorTraversal ASTDump::Visit(const ASTForStmt& node)
+	{
+		PrintIndented(std::format("for_statement ({})", node.GetIdentifier()));
+
+		++m_indent;
+		node.GetStart()->Accept(*this);
+		node.GetLimit()->Accept(*this);
+		node.GetBody()->Accept(*this);
+		--m_indent;
+
+		return ASTVisitorTraversal::Continue;
+	}
+
+	ASTVisitorTraversal ASTDump::Visit(const ASTMatchStmt& node)
+	{
+		PrintIndented("match_statement");
+
+		++m_indent;
+		node.GetValue()->Accept(*this);
+		for (const MatchArm& arm : node.GetArms())
+		{
+			std::string values;
+			for (const int32_t value : arm.values)
+			{
+				values += values.empty() ? std::to_string(value) : std::format(", {}", value);
+			}
+			PrintIndented(std::format("match_arm ({})", values));
+
+			++m_indent;
+			arm.body->Accept(*this);
+			--m_indent;
+		}
+		if (node.GetElseArm())
+		{
+			PrintIndented("match_else");
+
+			++m_indent;
+			node.GetElseArm()->Accept(*this);
+			--m_indent;
+		}
+		--m_indent;
+
 		return ASTVisitorTraversal::Continue;
 	}
 
@@ -112,7 +183,7 @@ namespace Osprey
 		PrintIndented("program");
 		
 		++m_indent;
-		for (const std::unique_ptr<ASTStmt>& statement : node.GetStatements())
+		for (const ASTStmt* statement : node.GetStatements())
 		{
 			statement->Accept(*this);
 		}
@@ -121,6 +192,41 @@ namespace Osprey
 		return ASTVisitorTraversal::Continue;
 	}
 
+	ASTVisitorTraversal ASTDump::Visit(const ASTFunctionDeclarationStmt& node)
+	{
+		PrintIndented(std::format("function_declaration ({})", node.GetIdentifier()));
+
+		++m_indent;
+		node.GetFunction()->Accept(*this);
+		--m_indent;
+
+		return ASTVisitorTraversal::Continue;
+	}
+
+	ASTVisitorTraversal ASTDump::Visit(const ASTFunctionExpr& node)
+	{
+		std::string parameters;
+		for (const FunctionParameter& parameter : node.GetParameters())
+		{
+			const std::string formatted = std::format("{}: {}", parameter.GetIdentifier(), parameter.GetType().ToString());
+			parameters += parameters.empty() ? formatted : std::format(", {}", formatted);
+		}
+		PrintIndented(std::format("function_expression ({}) -> {}", parameters, node.GetReturnType().ToString()));
+
+		++m_indent;
+		if (const ASTBlock* body = node.GetBody())
+		{
+			body->Accept(*this);
+		}
+		else
+		{
+			PrintIndented(std::format("error: {}", node.GetBodyError().value_or("")));
+		}
+		--m_indent;
+
+		return ASTVisitorTraversal::Continue;
+	}
+
 	void ASTDump::PrintIndented(std::string message)
 	{
 		std::println("{}{}", std::string(m_indent * 4, ' '), message);
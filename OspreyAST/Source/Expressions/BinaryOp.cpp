@@ -4,10 +4,11 @@
 
 namespace Osprey
 {
-	ASTBinaryExpr::ASTBinaryExpr(BinaryOperator op, std::unique_ptr<ASTExpr> left, std::unique_ptr<ASTExpr> right)
-		: m_op(op)
-		, m_left_node(std::move(left))
-		, m_right_node(std::move(right))
+	ASTBinaryExpr::ASTBinaryExpr(BinaryOperator op, const ASTExpr* left, const ASTExpr* right)
+		: ASTExpr(ASTNodeKind::BinaryExpr)
+		, m_op(op)
+		, m_left_node(left)
+		, m_right_node(right)
 	{
 	}
 
@@ -21,12 +22,12 @@ namespace Osprey
 		return m_op;
 	}
 
-	const std::unique_ptr<ASTExpr>& ASTBinaryExpr::GetLeftNode() const
+	const ASTExpr* ASTBinaryExpr::GetLeftNode() const
 	{
 		return m_left_node;
 	}
 
-	const std::unique_ptr<ASTExpr>& ASTBinaryExpr::GetRightNode() const
+	const ASTExpr* ASTBinaryExpr::GetRightNode() const
 	{
 		return m_right_node;
 	}
@@ -4,9 +4,10 @@
 
 namespace Osprey
 {
-	ASTFunctionCall::ASTFunctionCall(std::string identifier, ArgumentList args)
-		: m_identifier(std::move(identifier))
-		, m_args(std::move(args))
+	ASTFunctionCall::ASTFunctionCall(SymbolId symbol, ArgumentList args)
+		: ASTExpr(ASTNodeKind::FunctionCall)
+		, m_symbol(symbol)
+		, m_args(args)
 	{
 	}
 
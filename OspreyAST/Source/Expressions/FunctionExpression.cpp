@@ -2,13 +2,29 @@
 
 #include "OspreyAST/ASTVisitor.h"
 #include "OspreyAST/Statements/Block.h"
+#include "OspreyAST/LazyFunctionBody.h"
 
 namespace Osprey
 {
-	ASTFunctionExpr::ASTFunctionExpr(std::vector<FunctionParameter> parameters, Type return_type, std::unique_ptr<ASTBlock> body)
-		: m_parameters(std::move(parameters))
-		, m_return_type(std::move(return_type))
-		, m_body(std::move(body))
+	FunctionParameter::FunctionParameter(SymbolId symbol, Type type)
+		: m_symbol(symbol)
+		, m_type(type)
+	{
+	}
+
+	ASTFunctionExpr::ASTFunctionExpr(ParameterList parameters, Type return_type, const ASTBlock* body)
+		: ASTExpr(ASTNodeKind::FunctionExpr)
+		, m_parameters(parameters)
+		, m_return_type(return_type)
+		, m_body(body)
+	{
+	}
+
+	ASTFunctionExpr::ASTFunctionExpr(ParameterList parameters, Type return_type, const LazyFunctionBody* body)
+		: ASTExpr(ASTNodeKind::FunctionExpr)
+		, m_parameters(parameters)
+		, m_return_type(return_type)
+		, m_lazy_body(body)
 	{
 	}
 
@@ -17,7 +33,7 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	const ParameterList& ASTFunctionExpr::GetParameters() const
+	ParameterList ASTFunctionExpr::GetParameters() const
 	{
 		return m_parameters;
 	}
@@ -27,8 +43,13 @@ namespace Osprey
 		return m_return_type;
 	}
 
-	const std::unique_ptr<ASTBlock>& ASTFunctionExpr::GetBody() const
+	const ASTBlock* ASTFunctionExpr::GetBody() const
+	{
+		return m_lazy_body ? m_lazy_body->Get() : m_body;
+	}
+
+	std::optional<ErrorMessage> ASTFunctionExpr::GetBodyError() const
 	{
-		return m_body;
+		return m_lazy_body ? m_lazy_body->GetError() : std::nullopt;
 	}
 }
\ No newline at end of file
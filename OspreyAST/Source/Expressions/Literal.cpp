@@ -5,7 +5,8 @@
 namespace Osprey
 {
 	ASTLiteral::ASTLiteral(Type type, int32_t value)
-		: m_type(type)
+		: ASTExpr(ASTNodeKind::Literal)
+		, m_type(type)
 		, m_value(value)
 	{
 	}
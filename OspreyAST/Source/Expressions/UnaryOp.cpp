@@ -4,9 +4,10 @@
 
 namespace Osprey
 {
-	ASTUnaryExpr::ASTUnaryExpr(UnaryOperator op, std::unique_ptr<ASTExpr> node)
-		: m_op(op)
-		, m_node(std::move(node))
+	ASTUnaryExpr::ASTUnaryExpr(UnaryOperator op, const ASTExpr* node)
+		: ASTExpr(ASTNodeKind::UnaryExpr)
+		, m_op(op)
+		, m_node(node)
 	{
 	}
 
@@ -20,7 +21,7 @@ namespace Osprey
 		return m_op;
 	}
 
-	const std::unique_ptr<ASTExpr>& ASTUnaryExpr::GetNode() const
+	const ASTExpr* ASTUnaryExpr::GetNode() const
 	{
 		return m_node;
 	}
@@ -4,8 +4,9 @@
 
 namespace Osprey
 {
-	ASTVariable::ASTVariable(std::string identifier)
-		: m_identifier(std::move(identifier))
+	ASTVariable::ASTVariable(SymbolId symbol)
+		: ASTExpr(ASTNodeKind::Variable)
+		, m_symbol(symbol)
 	{
 	}
 
@@ -13,9 +14,4 @@ namespace Osprey
 	{
 		return visitor.Visit(*this);
 	}
-
-	const std::string& ASTVariable::GetIdentifier() const
-	{
-		return m_identifier;
-	}
 }
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "OspreyAST/FlatAST.h"
+
+#include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/Expressions/Literal.h"
+#include "OspreyAST/Expressions/Variable.h"
+#include "OspreyAST/Expressions/UnaryOp.h"
+#include "OspreyAST/Expressions/BinaryOp.h"
+#include "OspreyAST/Expressions/FunctionCall.h"
+#include "OspreyAST/Expressions/FunctionExpression.h"
+#include "OspreyAST/Statements/VariableDecl.h"
+#include "OspreyAST/Statements/Return.h"
+#include "OspreyAST/Statements/If.h"
+#include "OspreyAST/Statements/While.h"
+#include "OspreyAST/Statements/For.h"
+#include "OspreyAST/Statements/Match.h"
+#include "OspreyAST/Statements/Block.h"
+#include "OspreyAST/Statements/Assignment.h"
+#include "OspreyAST/Statements/FunctionDecl.h"
+
+#include <bit>
+#include <cassert>
+
+namespace Osprey
+{
+	/*
+		Appends each node to the FlatAST before its children, so they come out in pre-order
+	*/
+	class FlatASTBuilder : public ASTVisitor
+	{
+	public:
+		FlatASTBuilder(FlatAST& ast, FlatNestedFunctions nested_functions)
+			: m_ast(ast)
+			, m_nested_functions(nested_functions)
+		{
+		}
+
+		FlatNodeId Convert(const ASTNode* node)
+		{
+			if (!node)
+			{
+				return InvalidFlatNode;
+			}
+
+			const FlatNodeId id = static_cast<FlatNodeId>(m_ast.m_kinds.size());
+			node->Accept(*this);
+			m_ast.m_subtree_ends[id] = static_cast<FlatNodeId>(m_ast.m_kinds.size());
+			return id;
+		}
+
+	private:
+		ASTVisitorTraversal Visit(const ASTLiteral& node)
+		{
+			AddNode(FlatNodeKind::Literal, node, std::bit_cast<uint32_t>(node.GetValue()));
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariable& node)
+		{
+			AddNode(FlatNodeKind::Variable, node, node.GetSymbol());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::UnaryExpr, node, static_cast<uint32_t>(node.GetOperator()));
+			m_ast.m_lhs[id] = Convert(node.GetNode());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTBinaryExpr& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::BinaryExpr, node, static_cast<uint32_t>(node.GetOperator()));
+			m_ast.m_lhs[id] = Convert(node.GetLeftNode());
+			m_ast.m_rhs[id] = Convert(node.GetRightNode());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::VariableDeclaration, node, node.GetSymbol());
+			m_ast.m_lhs[id] = Convert(node.GetExpressionNode());
+			m_ast.m_rhs[id] = EncodeType(node.GetType());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTReturn& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::Return, node);
+			m_ast.m_lhs[id] = Convert(node.GetExpressionNode());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTBlock& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::Block, node);
+			ConvertList(id, node.GetStatements());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::Assignment, node, node.GetSymbol());
+			m_ast.m_lhs[id] = Convert(node.GetExpressionNode());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::If, node);
+			m_ast.m_lhs[id] = Convert(node.GetPredicate());
+
+			const uint32_t extra = ReserveExtra(2);
+			m_ast.m_rhs[id] = extra;
+			m_ast.m_extra[extra] = Convert(node.GetTrueBlock());
+			m_ast.m_extra[extra + 1] = Convert(node.GetFalseBlock());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTWhileStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::While, node);
+			m_ast.m_lhs[id] = Convert(node.GetPredicate());
+			m_ast.m_rhs[id] = Convert(node.GetBody());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTForStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::For, node, node.GetSymbol());
+
+			const uint32_t extra = ReserveExtra(2);
+			m_ast.m_lhs[id] = extra;
+			m_ast.m_extra[extra] = Convert(node.GetStart());
+			m_ast.m_extra[extra + 1] = Convert(node.GetLimit());
+			m_ast.m_rhs[id] = Convert(node.GetBody());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTMatchStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::Match, node);
+			m_ast.m_lhs[id] = Convert(node.GetValue());
+
+			const std::span<const MatchArm> arms = node.GetArms();
+			const uint32_t extra = ReserveExtra(2);
+			m_ast.m_rhs[id] = extra;
+			m_ast.m_extra[extra + 1] = static_cast<uint32_t>(arms.size());
+
+			for (const MatchArm& arm : arms)
+			{
+				const uint32_t arm_extra = ReserveExtra(2 + arm.values.size());
+				m_ast.m_extra[arm_extra + 1] = static_cast<uint32_t>(arm.values.size());
+				for (size_t index = 0; index < arm.values.size(); ++index)
+				{
+					m_ast.m_extra[arm_extra + 2 + index] = std::bit_cast<uint32_t>(arm.values[index]);
+				}
+				m_ast.m_extra[arm_extra] = Convert(arm.body);
+			}
+
+			m_ast.m_extra[extra] = Convert(node.GetElseArm());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTProgram& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::Program, node);
+			ConvertList(id, node.GetStatements());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionCall& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::FunctionCall, node, node.GetSymbol());
+			ConvertList(id, node.GetArgs().args);
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::FunctionDeclaration, node, node.GetSymbol());
+			m_ast.m_lhs[id] = Convert(node.GetFunction());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionExpr& node)
+		{
+			const FlatNodeId id = AddNode(FlatNodeKind::FunctionExpr, node, EncodeType(node.GetReturnType()));
+
+			const ParameterList parameters = node.GetParameters();
+			const uint32_t extra = ReserveExtra(1 + 2 * parameters.size());
+			m_ast.m_lhs[id] = extra;
+			m_ast.m_extra[extra] = static_cast<uint32_t>(parameters.size());
+			for (size_t index = 0; index < parameters.size(); ++index)
+			{
+				m_ast.m_extra[extra + 1 + 2 * index] = parameters[index].GetSymbol();
+				m_ast.m_extra[extra + 2 + 2 * index] = EncodeType(parameters[index].GetType());
+			}
+
+			if (id == m_ast.GetRoot() || m_nested_functions == FlatNestedFunctions::Include)
+			{
+				m_ast.m_rhs[id] = Convert(node.GetBody());
+			}
+			return ASTVisitorTraversal::Continue;
+		}
+
+		FlatNodeId AddNode(FlatNodeKind kind, const ASTNode& source, uint32_t payload = 0)
+		{
+			const FlatNodeId id = static_cast<FlatNodeId>(m_ast.m_kinds.size());
+			m_ast.m_kinds.push_back(kind);
+			m_ast.m_payloads.push_back(payload);
+			m_ast.m_lhs.push_back(InvalidFlatNode);
+			m_ast.m_rhs.push_back(InvalidFlatNode);
+			m_ast.m_subtree_ends.push_back(id + 1);
+			m_ast.m_sources.push_back(&source);
+			m_ast.m_ids.emplace(&source, id);
+			return id;
+		}
+
+		// Reserves 'count' entries of the extra array, which the caller fills in
+		uint32_t ReserveExtra(size_t count)
+		{
+			const uint32_t index = static_cast<uint32_t>(m_ast.m_extra.size());
+			m_ast.m_extra.resize(m_ast.m_extra.size() + count, InvalidFlatNode);
+			return index;
+		}
+
+		template<typename Node>
+		void ConvertList(FlatNodeId id, std::span<const Node* const> children)
+		{
+			const uint32_t extra = ReserveExtra(children.size());
+			m_ast.m_lhs[id] = extra;
+			m_ast.m_rhs[id] = static_cast<uint32_t>(children.size());
+			for (size_t index = 0; index < children.size(); ++index)
+			{
+				m_ast.m_extra[extra + index] = Convert(children[index]);
+			}
+		}
+
+		static uint32_t EncodeType(Type type)
+		{
+			// The parser only produces data types
+			const std::optional<DataType> data_type = type.GetDataType();
+			assert(data_type);
+			return data_type ? static_cast<uint32_t>(*data_type) : InvalidFlatNode;
+		}
+
+		FlatAST& m_ast;
+		FlatNestedFunctions m_nested_functions;
+	};
+
+	FlatAST::FlatAST(const ASTNode& root, FlatNestedFunctions nested_functions)
+	{
+		FlatASTBuilder builder(*this, nested_functions);
+		builder.Convert(&root);
+	}
+
+	std::span<const FlatNodeId> FlatAST::GetChildren(FlatNodeId node) const
+	{
+		assert(m_kinds[node] == FlatNodeKind::Program || m_kinds[node] == FlatNodeKind::Block || m_kinds[node] == FlatNodeKind::FunctionCall);
+		return GetExtra(m_lhs[node], m_rhs[node]);
+	}
+
+	FlatNodeId FlatAST::FindNode(const ASTNode& source) const
+	{
+		const auto found = m_ids.find(&source);
+		return found != m_ids.end() ? found->second : InvalidFlatNode;
+	}
+}
\ No newline at end of file
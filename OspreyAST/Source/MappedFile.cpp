@@ -0,0 +1,141 @@
+#include "OspreyAST/MappedFile.h"
+
+#include <format>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Osprey
+{
+	std::expected<MappedFile, ErrorMessage> MappedFile::Open(const std::filesystem::path& path)
+	{
+#if defined(_WIN32)
+		const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return std::unexpected(std::format("Could not open '{}'", path.string()));
+		}
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size))
+		{
+			CloseHandle(file);
+			return std::unexpected(std::format("Could not read the size of '{}'", path.string()));
+		}
+
+		// Empty files cannot be mapped
+		if (file_size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return MappedFile(nullptr, 0, nullptr);
+		}
+
+		// The mapping keeps its own reference to the file
+		const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping)
+		{
+			return std::unexpected(std::format("Could not map '{}'", path.string()));
+		}
+
+		const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+		{
+			CloseHandle(mapping);
+			return std::unexpected(std::format("Could not map '{}'", path.string()));
+		}
+
+		return MappedFile(static_cast<const char*>(data), static_cast<size_t>(file_size.QuadPart), mapping);
+#else
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return std::unexpected(std::format("Could not open '{}'", path.string()));
+		}
+
+		struct stat file_stat;
+		if (fstat(file, &file_stat) != 0)
+		{
+			close(file);
+			return std::unexpected(std::format("Could not read the size of '{}'", path.string()));
+		}
+
+		// Empty files cannot be mapped
+		if (file_stat.st_size == 0)
+		{
+			close(file);
+			return MappedFile(nullptr, 0, nullptr);
+		}
+
+		// The mapping keeps its own reference to the file
+		void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (data == MAP_FAILED)
+		{
+			return std::unexpected(std::format("Could not map '{}'", path.string()));
+		}
+
+		madvise(data, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+
+		return MappedFile(static_cast<const char*>(data), static_cast<size_t>(file_stat.st_size), nullptr);
+#endif
+	}
+
+	MappedFile::MappedFile(const char* data, size_t size, void* mapping)
+		: m_data(data)
+		, m_size(size)
+		, m_mapping(mapping)
+	{
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr))
+		, m_size(std::exchange(other.m_size, 0))
+		, m_mapping(std::exchange(other.m_mapping, nullptr))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Unmap();
+			m_data = std::exchange(other.m_data, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+			m_mapping = std::exchange(other.m_mapping, nullptr);
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Unmap();
+	}
+
+	void MappedFile::Unmap()
+	{
+		if (!m_data)
+		{
+			return;
+		}
+
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+#else
+		munmap(const_cast<char*>(m_data), m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		m_mapping = nullptr;
+	}
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "OspreyAST/Parser.h"
 
 #include "OspreyAST/Types.h"
+#include "OspreyAST/ParallelFor.h"
+#include "OspreyAST/LazyFunctionBody.h"
 #include "OspreyAST/BinaryOperator.h"
 #include "OspreyAST/Expressions/Literal.h"
 #include "OspreyAST/Expressions/Variable.h"
@@ -11,6 +13,9 @@
 #include "OspreyAST/Statements/VariableDecl.h"
 #include "OspreyAST/Statements/Return.h"
 #include "OspreyAST/Statements/If.h"
+#include "OspreyAST/Statements/While.h"
+#include "OspreyAST/Statements/For.h"
+#include "OspreyAST/Statements/Match.h"
 #include "OspreyAST/Statements/Block.h"
 #include "OspreyAST/Statements/Assignment.h"
 #include "OspreyAST/Statements/FunctionDecl.h"
@@ -20,24 +25,76 @@
 #include <print>
 #include <cassert>
 #include <span>
+#include <charconv>
+#include <unordered_set>
+#include <array>
+#include <optional>
+#include <limits>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
 
 namespace Osprey
 {
+	// Where a TokenReader's tokens come from, so that function bodies can be skipped and
+	// parsed from the same tokens later
+	struct LazyBodyContext
+	{
+		// The tokens the reader reads from, and the script their lexemes are views into
+		std::span<const Token> tokens;
+		std::string_view source;
+		// Index into 'tokens' of the reader's first token
+		size_t first_index;
+		// Takes the bodies that are skipped
+		LazyFunctionBodies& bodies;
+	};
+
+	/*
+	* Pulls tokens from a TokenSource on demand, keeping only the few the grammar looks
+	* ahead at. Tokens are handed out by value as the slots they occupy get reused. A
+	* tokeniser error ends the stream early and is kept for Parse to report.
+	*/
 	class TokenReader
 	{
 	public:
-		TokenReader(const TokenBuffer& tokens)
-			: m_tokens(tokens)
-			, m_cursor(0)
+		// The grammar never looks further ahead than 'identifier ':'' after a '('
+		static constexpr size_t MaxLookahead = 3;
+
+		// Function bodies are skipped if 'lazy' is given
+		TokenReader(TokenSource& source, LazyBodyContext* lazy = nullptr)
+			: m_source(source)
+			, m_lazy(lazy)
+			, m_head(0)
+			, m_count(0)
 		{
 		}
 
-		// Return the current token
-		[[nodiscard]] std::optional<Token> Peek(const size_t lookahead = 0) const
+		// Return the current token, or nothing at the end
+		[[nodiscard]] std::optional<Token> Peek(const size_t lookahead = 0)
 		{
-			if (m_cursor + lookahead < m_tokens.size())
+			assert(lookahead < MaxLookahead);
+
+			while (m_count <= lookahead && !m_exhausted)
+			{
+				std::expected<std::optional<Token>, ErrorMessage> token = m_source.Next();
+				if (!token || !*token)
+				{
+					m_exhausted = true;
+					if (!token)
+					{
+						m_error = std::move(token.error());
+					}
+					break;
+				}
+
+				m_lookahead[(m_head + m_count) % m_lookahead.size()] = **token;
+				++m_count;
+			}
+
+			if (lookahead < m_count)
 			{
-				return m_tokens[m_cursor + lookahead];
+				return m_lookahead[(m_head + lookahead) % m_lookahead.size()];
 			}
 			return std::nullopt;
 		}
@@ -45,15 +102,20 @@ namespace Osprey
 		// Return the current token and advance the cursor
 		std::optional<Token> Consume()
 		{
-			std::optional<Token> token = Peek();
-			++m_cursor;
+			const std::optional<Token> token = Peek();
+			if (token)
+			{
+				m_head = (m_head + 1) % m_lookahead.size();
+				--m_count;
+				++m_consumed;
+			}
 			return token;
 		}
 
 		// Returns whether the current token is of the given type
 		[[nodiscard]] bool MatchPeek(TokenType token_type, size_t lookahead = 0)
 		{
-			std::optional<Token> next = Peek(lookahead);
+			const std::optional<Token> next = Peek(lookahead);
 			return next && next->type == token_type;
 		}
 
@@ -62,31 +124,99 @@ namespace Osprey
 		{
 			if (MatchPeek(token_type))
 			{
-				return *Consume();
+				return Consume();
 			}
 			return std::nullopt;
 		}
 
-		[[nodiscard]] bool HasMore() const
+		[[nodiscard]] bool HasMore()
 		{
 			return Peek().has_value();
 		}
 
+		[[nodiscard]] std::string_view GetLexeme(const Token& token) const
+		{
+			return m_source.GetSource().substr(token.offset, token.length);
+		}
+
+		[[nodiscard]] const std::optional<ErrorMessage>& GetTokeniserError() const
+		{
+			return m_error;
+		}
+
+		[[nodiscard]] LazyBodyContext* GetLazyBodyContext() const
+		{
+			return m_lazy;
+		}
+
+		// How many tokens have been consumed, i.e. the index of the current token
+		[[nodiscard]] size_t GetConsumedCount() const
+		{
+			return m_consumed;
+		}
+
 	private:
-		const TokenBuffer& m_tokens;
-		size_t m_cursor;
+		TokenSource& m_source;
+		LazyBodyContext* m_lazy;
+		std::array<Token, MaxLookahead> m_lookahead;
+		size_t m_head;
+		size_t m_count;
+		size_t m_consumed = 0;
+		bool m_exhausted = false;
+		std::optional<ErrorMessage> m_error;
+	};
+
+	/*
+	* Replays a materialised TokenBuffer through the TokenSource interface
+	*/
+	class TokenBufferSource : public TokenSource
+	{
+	public:
+		explicit TokenBufferSource(const TokenBuffer& tokens)
+			: TokenBufferSource(tokens.GetTokens(), tokens.GetSource())
+		{
+		}
+
+		// Replays only the tokens in [begin, end)
+		TokenBufferSource(const TokenBuffer& tokens, size_t begin, size_t end)
+			: TokenBufferSource(tokens.GetTokens().subspan(begin, end - begin), tokens.GetSource())
+		{
+		}
+
+		// Replays 'tokens', whose lexemes are views into 'source'
+		TokenBufferSource(std::span<const Token> tokens, std::string_view source)
+			: m_tokens(tokens)
+			, m_source(source)
+		{
+		}
+
+		std::expected<std::optional<Token>, ErrorMessage> Next() override
+		{
+			if (m_cursor < m_tokens.size())
+			{
+				return m_tokens[m_cursor++];
+			}
+			return std::nullopt;
+		}
+
+		std::string_view GetSource() const override { return m_source; }
+
+	private:
+		std::span<const Token> m_tokens;
+		std::string_view m_source;
+		size_t m_cursor = 0;
 	};
 
 	template<typename T>
 	using ParseResult = std::expected<T, ErrorMessage>;
 	template<typename T>
-	using ParseResultPtr = std::expected<std::unique_ptr<T>, ErrorMessage>;
+	using ParseResultPtr = std::expected<const T*, ErrorMessage>;
 
 	// forward declarations
-	ParseResultPtr<ASTExpr> ParseExpression(TokenReader& reader);
-	ParseResultPtr<ASTBlock> ParseBlock(TokenReader& reader);
-	ParseResult<ArgumentList> ParseArgumentList(TokenReader& reader);
-	ParseResultPtr<ASTFunctionExpr> ParseFunctionExpression(TokenReader& reader);
+	ParseResultPtr<ASTExpr> ParseExpression(TokenReader& reader, ASTArena& arena);
+	ParseResultPtr<ASTBlock> ParseBlock(TokenReader& reader, ASTArena& arena);
+	ParseResult<ArgumentList> ParseArgumentList(TokenReader& reader, ASTArena& arena);
+	ParseResultPtr<ASTFunctionExpr> ParseFunctionExpression(TokenReader& reader, ASTArena& arena);
 	ParseResult<Type> ParseFunctionType(TokenReader& reader);
 
 	// primary_expr := identifier
@@ -94,51 +224,57 @@ namespace Osprey
 	//               | literal
 	//               | '(' expr ')'
 	//				 | function_expr
-	ParseResultPtr<ASTExpr> ParsePrimaryExpr(TokenReader& reader)
+	ParseResultPtr<ASTExpr> ParsePrimaryExpr(TokenReader& reader, ASTArena& arena)
 	{
 		if (!reader.HasMore())
 		{
 			return std::unexpected("Ran out of tokens when parsing primary expression");
 		}
 
-		if (std::optional<Token> i32_literal = reader.MatchConsume(TokenType::I32))
+		if (const std::optional<Token> i32_literal = reader.MatchConsume(TokenType::I32))
 		{
-			const int32_t value = std::stoi(i32_literal->lexeme); // TODO: throws if fails
-			return std::make_unique<ASTLiteral>(Type(DataType::I32), value);
+			const std::string_view lexeme = reader.GetLexeme(*i32_literal);
+			int32_t value = 0;
+			const std::from_chars_result result = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+			if (result.ec != std::errc() || result.ptr != lexeme.data() + lexeme.size())
+			{
+				return std::unexpected("Integer literal out of range when parsing primary expression");
+			}
+			return arena.Make<ASTLiteral>(Type(DataType::I32), value);
 		}
-		else if (std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier))
+		else if (const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier))
 		{
 			if (reader.MatchConsume(TokenType::LeftParen))
 			{
 				if (reader.MatchConsume(TokenType::RightParen))
 				{
-					return std::make_unique<ASTFunctionCall>(identifier->lexeme, ArgumentList());
+					return arena.Make<ASTFunctionCall>(identifier->symbol, ArgumentList());
 				}
 				
-				std::expected<ArgumentList, ErrorMessage> arg_list = ParseArgumentList(reader);
+				std::expected<ArgumentList, ErrorMessage> arg_list = ParseArgumentList(reader, arena);
 				if (!arg_list)
 				{
 					return std::unexpected(arg_list.error());
 				}
 				
-				return std::make_unique<ASTFunctionCall>(identifier->lexeme, std::move(*arg_list));
+				return arena.Make<ASTFunctionCall>(identifier->symbol, *arg_list);
 			}
 			else
 			{
-				return std::make_unique<ASTVariable>(identifier->lexeme);
+				return arena.Make<ASTVariable>(identifier->symbol);
 			}
 		}
 		else if (reader.MatchPeek(TokenType::LeftParen))
 		{
 			if (reader.MatchPeek(TokenType::RightParen) || (reader.MatchPeek(TokenType::Identifier, 1) && reader.MatchPeek(TokenType::Colon, 2)))
 			{
-				return ParseFunctionExpression(reader);
+				return ParseFunctionExpression(reader, arena);
 			}
 			else
 			{
 				reader.Consume(); // Eat the '('
 
-				std::expected<std::unique_ptr<ASTExpr>, ErrorMessage> expression = ParseExpression(reader);
+				ParseResultPtr<ASTExpr> expression = ParseExpression(reader, arena);
 				if (!expression)
 				{
 					return std::unexpected(expression.error());
@@ -149,7 +285,7 @@ namespace Osprey
 					return std::unexpected("Expected ')' at {} when parsing primary expression");
 				}
 
-				return std::move(expression);
+				return expression;
 			}
 		}
 
@@ -157,27 +293,27 @@ namespace Osprey
 	}
 
 	// argument_list := expr (',' expr)*
-	ParseResult<ArgumentList> ParseArgumentList(TokenReader& reader)
+	ParseResult<ArgumentList> ParseArgumentList(TokenReader& reader, ASTArena& arena)
 	{
-		ArgumentList arg_list;
+		std::vector<const ASTExpr*> args;
 
-		ParseResultPtr<ASTExpr> expr = ParseExpression(reader);
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
 		if (!expr)
 		{
 			return std::unexpected(expr.error());
 		}
 
-		arg_list.args.push_back(std::move(*expr));
+		args.push_back(*expr);
 
 		while (reader.MatchConsume(TokenType::Comma))
 		{
-			ParseResultPtr<ASTExpr> expr2 = ParseExpression(reader);
+			ParseResultPtr<ASTExpr> expr2 = ParseExpression(reader, arena);
 			if (!expr2)
 			{
-				return std::unexpected(expr.error());
+				return std::unexpected(expr2.error());
 			}
 
-			arg_list.args.push_back(std::move(*expr2));
+			args.push_back(*expr2);
 		}
 
 		if (!reader.MatchConsume(TokenType::RightParen))
@@ -185,280 +321,141 @@ namespace Osprey
 			return std::unexpected("Expected ')' when parsing argument list");
 		}
 
-		return arg_list;
+		return ArgumentList{ arena.MakeArray(args) };
 	}
 
 	// unary_expr := "!" unary_expr
 	//			   | "-" unary_expr
 	//             | primary_expr
-	ParseResultPtr<ASTExpr> ParseUnaryExpr(TokenReader& reader)
+	ParseResultPtr<ASTExpr> ParseUnaryExpr(TokenReader& reader, ASTArena& arena)
 	{
 		if (reader.MatchConsume(TokenType::Exclamation))
 		{
-			ParseResultPtr<ASTExpr> expr = ParseUnaryExpr(reader);
+			ParseResultPtr<ASTExpr> expr = ParseUnaryExpr(reader, arena);
 			if (!expr)
 			{
 				return std::unexpected(expr.error());
 			}
-			return std::make_unique<ASTUnaryExpr>(UnaryOperator::Exclamation, std::move(*expr));
+			return arena.Make<ASTUnaryExpr>(UnaryOperator::Exclamation, *expr);
 		}
 		else if (reader.MatchConsume(TokenType::Minus))
 		{
-			ParseResultPtr<ASTExpr> expr = ParseUnaryExpr(reader);
+			ParseResultPtr<ASTExpr> expr = ParseUnaryExpr(reader, arena);
 			if (!expr)
 			{
 				return std::unexpected(expr.error());
 			}
-			return std::make_unique<ASTUnaryExpr>(UnaryOperator::Minus, std::move(*expr));
+			return arena.Make<ASTUnaryExpr>(UnaryOperator::Minus, *expr);
 		}
 		else
 		{
-			return ParsePrimaryExpr(reader);
+			return ParsePrimaryExpr(reader, arena);
 		}
 	}
 
-	// multiplicative_expr := unary_expr ('*' unary_expr)*
-	//                      | unary_expr ('/' unary_expr)*
-	//                      | unary_expr ('%' unary_expr)*
-	ParseResultPtr<ASTExpr> ParseMultiplicativeExpr(TokenReader& reader)
+	/*
+	* Binary operators from loosest to tightest binding, with the grammar they replace:
+	*
+	*   logical_or_expr     := logical_and_expr ('||' logical_and_expr)*
+	*   logical_and_expr    := equality_expr ('&&' equality_expr)*
+	*   equality_expr       := relational_expr (('==' | '!=') relational_expr)?
+	*   relational_expr     := additive_expr (('<' | '<=' | '>' | '>=') additive_expr)*
+	*   additive_expr       := multiplicative_expr (('+' | '-') multiplicative_expr)*
+	*   multiplicative_expr := unary_expr (('*' | '/' | '%') unary_expr)*
+	*
+	* All are left associative except equality, which does not chain.
+	*/
+	struct BinaryOperatorInfo
 	{
-		ParseResultPtr<ASTExpr> left_expr = ParseUnaryExpr(reader);
-		if (!left_expr)
-		{
-			return std::unexpected(left_expr.error());
-		}
-
-		while (true)
-		{
-			std::optional<BinaryOperator> operator_match;
-
-			if (reader.MatchPeek(TokenType::Asterisk))
-			{
-				operator_match = BinaryOperator::Asterisk;
-			}
-			else if (reader.MatchPeek(TokenType::Divide))
-			{
-				operator_match = BinaryOperator::Divide;
-			}
-			else if (reader.MatchPeek(TokenType::Percent))
-			{
-				operator_match = BinaryOperator::Percent;
-			}
-
-			if (operator_match)
-			{
-				reader.Consume();
-
-				ParseResultPtr<ASTExpr> right_expr = ParseUnaryExpr(reader);
-				if (!right_expr)
-				{
-					return std::unexpected(right_expr.error());
-				}
-
-				left_expr = std::make_unique<ASTBinaryExpr>(*operator_match, std::move(*left_expr), std::move(*right_expr));
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		return left_expr;
+		BinaryOperator op;
+		uint8_t precedence;
+		bool associative;
 	};
 
-	// additive_expr := multiplicative_expr ('+' multiplicative_expr)*
-		//                | multiplicative_expr ('-' multiplicative_expr)*
-	ParseResultPtr<ASTExpr> ParseAdditiveExpr(TokenReader& reader)
-	{
-		ParseResultPtr<ASTExpr> left_expr = ParseMultiplicativeExpr(reader);
-		if (!left_expr)
-		{
-			return std::unexpected(left_expr.error());
-		}
-
-		while (true)
-		{
-			std::optional<BinaryOperator> operator_match;
-
-			if (reader.MatchPeek(TokenType::Plus))
-			{
-				operator_match = BinaryOperator::Plus;
-			}
-			else if (reader.MatchPeek(TokenType::Minus))
-			{
-				operator_match = BinaryOperator::Minus;
-			}
-
-			if (operator_match)
-			{
-				reader.Consume();
-
-				ParseResultPtr<ASTExpr> right_expr = ParseMultiplicativeExpr(reader);
-				if (!right_expr)
-				{
-					return std::unexpected(right_expr.error());
-				}
-
-				left_expr = std::make_unique<ASTBinaryExpr>(*operator_match, std::move(*left_expr), std::move(*right_expr));
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		return left_expr;
-	}
+	constexpr uint8_t NotABinaryOperator = 0;
 
-	// relational_expr : = additive_expr('<' additive_expr) ?
-	//                  | additive_expr ('<=' additive_expr)?
-	//                  | additive_expr ('>' additive_expr)?
-	//                  | additive_expr ('>=' additive_expr)?
-	ParseResultPtr<ASTExpr> ParseRelationalExpr(TokenReader& reader)
+	constexpr std::array<BinaryOperatorInfo, 256> BinaryOperatorTable = []()
 	{
-		ParseResultPtr<ASTExpr> left_expr = ParseAdditiveExpr(reader);
-		if (!left_expr)
+		std::array<BinaryOperatorInfo, 256> table{};
+		for (BinaryOperatorInfo& info : table)
 		{
-			return std::unexpected(left_expr.error());
+			info.precedence = NotABinaryOperator;
 		}
 
-		while (true)
+		const auto set = [&table](TokenType token, BinaryOperator op, uint8_t precedence, bool associative = true)
 		{
-			std::optional<BinaryOperator> operator_match;
+			table[static_cast<uint8_t>(token)] = { op, precedence, associative };
+		};
 
-			if (reader.MatchPeek(TokenType::Lt))
-			{
-				operator_match = BinaryOperator::Lt;
-			}
-			else if (reader.MatchPeek(TokenType::LtEq))
-			{
-				operator_match = BinaryOperator::LtEq;
-			}
-			else if (reader.MatchPeek(TokenType::Gt))
-			{
-				operator_match = BinaryOperator::Gt;
-			}
-			else if (reader.MatchPeek(TokenType::GtEq))
-			{
-				operator_match = BinaryOperator::GtEq;
-			}
+		set(TokenType::Or, BinaryOperator::Or, 1);
+		set(TokenType::And, BinaryOperator::And, 2);
+		set(TokenType::Equality, BinaryOperator::Equality, 3, false);
+		set(TokenType::NotEquality, BinaryOperator::NotEquality, 3, false);
+		set(TokenType::Lt, BinaryOperator::Lt, 4);
+		set(TokenType::LtEq, BinaryOperator::LtEq, 4);
+		set(TokenType::Gt, BinaryOperator::Gt, 4);
+		set(TokenType::GtEq, BinaryOperator::GtEq, 4);
+		set(TokenType::Plus, BinaryOperator::Plus, 5);
+		set(TokenType::Minus, BinaryOperator::Minus, 5);
+		set(TokenType::Asterisk, BinaryOperator::Asterisk, 6);
+		set(TokenType::Divide, BinaryOperator::Divide, 6);
+		set(TokenType::Percent, BinaryOperator::Percent, 6);
 
-			if (operator_match)
-			{
-				reader.Consume();
+		return table;
+	}();
 
-				ParseResultPtr<ASTExpr> right_expr = ParseMultiplicativeExpr(reader);
-				if (!right_expr)
-				{
-					return std::unexpected(right_expr.error());
-				}
-
-				left_expr = std::make_unique<ASTBinaryExpr>(*operator_match, std::move(*left_expr), std::move(*right_expr));
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		return left_expr;
-	}
-
-	// equality_expr := relational_expr ('==' relational_expr)*
-	//                | relational_expr ('!=' relational_expr)*
-	ParseResultPtr<ASTExpr> ParseEqualityExpr(TokenReader& reader)
+	// Parses operands joined by operators that bind at least as tightly as 'min_precedence',
+	// by precedence climbing: each operator's right operand takes the tighter operators after it
+	ParseResultPtr<ASTExpr> ParseBinaryExpr(TokenReader& reader, ASTArena& arena, uint8_t min_precedence)
 	{
-		ParseResultPtr<ASTExpr> left_expr = ParseRelationalExpr(reader);
+		ParseResultPtr<ASTExpr> left_expr = ParseUnaryExpr(reader, arena);
 		if (!left_expr)
 		{
 			return std::unexpected(left_expr.error());
 		}
 
-		std::optional<BinaryOperator> operator_match;
-
-		if (reader.MatchConsume(TokenType::Equality))
-		{
-			operator_match = BinaryOperator::Equality;
-		}
-		else if (reader.MatchConsume(TokenType::NotEquality))
-		{
-			operator_match = BinaryOperator::NotEquality;
-		}
-		else
-		{
-			return std::move(*left_expr);
-		}
-
-		ParseResultPtr<ASTExpr> right_expr = ParseRelationalExpr(reader);
-		if (!right_expr)
-		{
-			return std::unexpected(right_expr.error());
-		}
-
-		return std::make_unique<ASTBinaryExpr>(*operator_match, std::move(*left_expr), std::move(*right_expr));
-	}
-
-	// logical_and_expr := equality_expr ('&&' equality_expr)?
-	ParseResultPtr<ASTExpr> ParseLogicalAndExpr(TokenReader& reader)
-	{
-		ParseResultPtr<ASTExpr> left_expr = ParseEqualityExpr(reader);
-		if (!left_expr)
-		{
-			return std::unexpected(left_expr.error());
-		}
+		// Operators that bind tighter than the last one joined here were refused by the right
+		// operand, i.e. a second '==', so are not taken here either
+		uint8_t max_precedence = std::numeric_limits<uint8_t>::max();
 
-		if (reader.MatchConsume(TokenType::And))
+		while (const std::optional<Token> token = reader.Peek())
 		{
-			ParseResultPtr<ASTExpr> right_expr = ParseEqualityExpr(reader);
-			if (!right_expr)
+			const BinaryOperatorInfo& info = BinaryOperatorTable[static_cast<uint8_t>(token->type)];
+			if (info.precedence == NotABinaryOperator || info.precedence < min_precedence || info.precedence > max_precedence)
 			{
-				return std::unexpected(right_expr.error());
+				break;
 			}
 
-			return std::make_unique<ASTBinaryExpr>(BinaryOperator::And, std::move(*left_expr), std::move(*right_expr));
-		}
-
-		return left_expr;
-	}
+			reader.Consume();
 
-	// logical_or_expr := equality_expr ('||' equality_expr)?
-	ParseResultPtr<ASTExpr> ParseLogicalOrExpr(TokenReader& reader)
-	{
-		ParseResultPtr<ASTExpr> left_expr = ParseLogicalAndExpr(reader);
-		if (!left_expr)
-		{
-			return std::unexpected(left_expr.error());
-		}
-
-		if (reader.MatchConsume(TokenType::Or))
-		{
-			ParseResultPtr<ASTExpr> right_expr = ParseLogicalAndExpr(reader);
+			ParseResultPtr<ASTExpr> right_expr = ParseBinaryExpr(reader, arena, static_cast<uint8_t>(info.precedence + 1));
 			if (!right_expr)
 			{
 				return std::unexpected(right_expr.error());
 			}
 
-			return std::make_unique<ASTBinaryExpr>(BinaryOperator::And, std::move(*left_expr), std::move(*right_expr));
+			left_expr = arena.Make<ASTBinaryExpr>(info.op, *left_expr, *right_expr);
+			max_precedence = info.associative ? info.precedence : static_cast<uint8_t>(info.precedence - 1);
 		}
 
 		return left_expr;
-	};
+	}
 
 	// expr := logical_or_expr
-	ParseResultPtr<ASTExpr> ParseExpression(TokenReader& reader)
+	ParseResultPtr<ASTExpr> ParseExpression(TokenReader& reader, ASTArena& arena)
 	{
-		return ParseLogicalOrExpr(reader);
+		return ParseBinaryExpr(reader, arena, 1);
 	}
 
 	// return := "return" expr ";"
-	ParseResultPtr<ASTReturn> ParseReturnStatement(TokenReader& reader)
+	ParseResultPtr<ASTReturn> ParseReturnStatement(TokenReader& reader, ASTArena& arena)
 	{
 		if (!reader.MatchConsume(TokenType::Return))
 		{
 			return std::unexpected("Expected 'return' when parsing return statement");
 		}
 
-		ParseResultPtr<ASTExpr> expression = ParseExpression(reader);
+		ParseResultPtr<ASTExpr> expression = ParseExpression(reader, arena);
 		if (!expression)
 		{
 			return std::unexpected(expression.error());
@@ -469,7 +466,7 @@ namespace Osprey
 			return std::unexpected("Expected ';' when parsing return statement");
 		}
 
-		return std::make_unique<ASTReturn>(std::move(*expression));
+		return arena.Make<ASTReturn>(*expression);
 	}
 
 	// type := i32
@@ -484,9 +481,9 @@ namespace Osprey
 		{
 			return ParseFunctionType(reader);
 		}
-		else if (std::optional<Token> current = reader.Peek())
+		else if (const std::optional<Token> current = reader.Peek())
 		{
-			return std::unexpected(std::format("Unexpected '{}' when parsing type", current->lexeme));
+			return std::unexpected(std::format("Unexpected '{}' when parsing type", reader.GetLexeme(*current)));
 		}
 		else
 		{
@@ -508,14 +505,72 @@ namespace Osprey
 	}
 
 	// parameter_list := identifier ":" type ("," identifier ":" type)*
-	ParseResult<ParameterList> ParseParameterList(TokenReader& reader)
+	ParseResult<ParameterList> ParseParameterList(TokenReader& reader, ASTArena& arena)
+	{
+		std::vector<FunctionParameter> parameter_list;
+
+		do
+		{
+			const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
+			if (!identifier)
+			{
+				return std::unexpected("Expected identifier when parsing parameter list");
+			}
+
+			if (!reader.MatchConsume(TokenType::Colon))
+			{
+				return std::unexpected("Expected ':' when parsing parameter list");
+			}
+
+			ParseResult<Type> type = ParseType(reader);
+			if (!type)
+			{
+				return std::unexpected(type.error());
+			}
+
+			parameter_list.emplace_back(identifier->symbol, *type);
+		} while (reader.MatchConsume(TokenType::Comma));
+
+		return arena.MakeArray(parameter_list);
+	}
+
+	// Skips a block by matching its braces, leaving it to be parsed the first time it is used
+	ParseResultPtr<LazyFunctionBody> SkipFunctionBody(TokenReader& reader, LazyBodyContext& lazy)
 	{
-		return std::unexpected("Parsing parameter list is not implemented");
+		const size_t begin = lazy.first_index + reader.GetConsumedCount();
+
+		if (!reader.MatchConsume(TokenType::LeftCurly))
+		{
+			return std::unexpected("Expected '{' when parsing block");
+		}
+
+		size_t depth = 1;
+		while (depth > 0)
+		{
+			const std::optional<Token> token = reader.Consume();
+			if (!token)
+			{
+				return std::unexpected("Expected '}' when parsing block");
+			}
+
+			if (token->type == TokenType::LeftCurly)
+			{
+				++depth;
+			}
+			else if (token->type == TokenType::RightCurly)
+			{
+				--depth;
+			}
+		}
+
+		const size_t end = lazy.first_index + reader.GetConsumedCount();
+		lazy.bodies.push_back(std::make_unique<LazyFunctionBody>(lazy.tokens.subspan(begin, end - begin), lazy.source));
+		return lazy.bodies.back().get();
 	}
 
 	// function_expr := "(" ")" "->" type block
 	//                | "(" parameter_list? ")" "->" type block
-	ParseResultPtr<ASTFunctionExpr> ParseFunctionExpression(TokenReader& reader)
+	ParseResultPtr<ASTFunctionExpr> ParseFunctionExpression(TokenReader& reader, ASTArena& arena)
 	{
 		if (!reader.MatchConsume(TokenType::LeftParen))
 		{
@@ -526,7 +581,7 @@ namespace Osprey
 
 		if (!reader.MatchConsume(TokenType::RightParen))
 		{
-			ParseResult<ParameterList> parsed_parameter_list = ParseParameterList(reader);
+			ParseResult<ParameterList> parsed_parameter_list = ParseParameterList(reader, arena);
 			if (!parsed_parameter_list)
 			{
 				return std::unexpected(parsed_parameter_list.error());
@@ -551,19 +606,30 @@ namespace Osprey
 			return std::unexpected(return_type.error());
 		}
 
-		ParseResultPtr<ASTBlock> body = ParseBlock(reader);
+		if (LazyBodyContext* lazy = reader.GetLazyBodyContext())
+		{
+			ParseResultPtr<LazyFunctionBody> body = SkipFunctionBody(reader, *lazy);
+			if (!body)
+			{
+				return std::unexpected(body.error());
+			}
+
+			return arena.Make<ASTFunctionExpr>(parameter_list, *return_type, *body);
+		}
+
+		ParseResultPtr<ASTBlock> body = ParseBlock(reader, arena);
 		if (!body)
 		{
 			return std::unexpected(body.error());
 		}
 
-		return std::make_unique<ASTFunctionExpr>(std::move(parameter_list), *return_type, std::move(*body));
+		return arena.Make<ASTFunctionExpr>(parameter_list, *return_type, *body);
 	}
 
 	// function_declaration_statement := identifier ":" "=" function_expr
-	ParseResultPtr<ASTFunctionDeclarationStmt> ParseFunctionDeclarationStatement(TokenReader& reader)
+	ParseResultPtr<ASTFunctionDeclarationStmt> ParseFunctionDeclarationStatement(TokenReader& reader, ASTArena& arena)
 	{
-		std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
+		const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
 		if (!identifier)
 		{
 			return std::unexpected("Expected identifier when parsing function declaration statement");
@@ -579,19 +645,19 @@ namespace Osprey
 			return std::unexpected("Expected '=' when parsing function declaration statement");
 		}
 
-		ParseResultPtr<ASTFunctionExpr> function_expression = ParseFunctionExpression(reader);
+		ParseResultPtr<ASTFunctionExpr> function_expression = ParseFunctionExpression(reader, arena);
 		if (!function_expression)
 		{
 			return std::unexpected(function_expression.error());
 		}
 
-		return std::make_unique<ASTFunctionDeclarationStmt>(identifier->lexeme, std::move(*function_expression));
+		return arena.Make<ASTFunctionDeclarationStmt>(identifier->symbol, *function_expression);
 	}
 
 	// assignment_statement := identifier "=" expr ";"
-	ParseResultPtr<ASTAssignmentStmt> ParseAssignmentStatement(TokenReader& reader)
+	ParseResultPtr<ASTAssignmentStmt> ParseAssignmentStatement(TokenReader& reader, ASTArena& arena)
 	{
-		std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
+		const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
 		if (!identifier)
 		{
 			return std::unexpected("Expected identifier when parsing assignment statement");
@@ -602,7 +668,7 @@ namespace Osprey
 			return std::unexpected("Expected '=' when parsing assignment statement");
 		}
 
-		ParseResultPtr<ASTExpr> expr = ParseExpression(reader);
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
 		if (!expr)
 		{
 			return std::unexpected(expr.error());
@@ -613,13 +679,13 @@ namespace Osprey
 			return std::unexpected("Expected ';' when parsing assignment statement");
 		}
 
-		return std::make_unique<ASTAssignmentStmt>(identifier->lexeme, std::move(*expr));
+		return arena.Make<ASTAssignmentStmt>(identifier->symbol, *expr);
 	};
 
 	// variable_declaration_stmt := identifier ":" ("mut")? type "=" expr ";"
-	ParseResultPtr<ASTVariableDeclarationStmt> ParseVariableDeclarationStatement(TokenReader& reader)
+	ParseResultPtr<ASTVariableDeclarationStmt> ParseVariableDeclarationStatement(TokenReader& reader, ASTArena& arena)
 	{
-		std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
+		const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
 		if (!identifier)
 		{
 			return std::unexpected("Expected identifier when parsing assignment statement");
@@ -643,7 +709,7 @@ namespace Osprey
 			return std::unexpected("Expected '=' when parsing assignment statement");
 		}
 
-		ParseResultPtr<ASTExpr> expr = ParseExpression(reader);
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
 		if (!expr)
 		{
 			return std::unexpected(expr.error());
@@ -654,11 +720,13 @@ namespace Osprey
 			return std::unexpected("Expected ';' when parsing assignment statement");
 		}
 
-		return std::make_unique<ASTVariableDeclarationStmt>(identifier->lexeme, *type, std::move(*expr));
+		return arena.Make<ASTVariableDeclarationStmt>(identifier->symbol, *type, *expr);
 	}
 
-	// if_statement := if "(" expr ")" block
-	ParseResultPtr<ASTIfStmt> ParseIfStatement(TokenReader& reader)
+	// if_statement := "if" "(" expr ")" block
+	//               | "if" "(" expr ")" block "else" block
+	//               | "if" "(" expr ")" block "else" if_statement
+	ParseResultPtr<ASTIfStmt> ParseIfStatement(TokenReader& reader, ASTArena& arena)
 	{
 		if (!reader.MatchConsume(TokenType::If))
 		{
@@ -670,7 +738,7 @@ namespace Osprey
 			return std::unexpected("Expected '(' when parsing if statement");
 		}
 
-		ParseResultPtr<ASTExpr> expr = ParseExpression(reader);
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
 		if (!expr)
 		{
 			return std::unexpected(expr.error());
@@ -681,30 +749,277 @@ namespace Osprey
 			return std::unexpected("Expected ')' when parsing if statement");
 		}
 
-		ParseResultPtr<ASTBlock> block = ParseBlock(reader);
+		ParseResultPtr<ASTBlock> block = ParseBlock(reader, arena);
+		if (!block)
+		{
+			return std::unexpected(block.error());
+		}
+
+		if (!reader.MatchConsume(TokenType::Else))
+		{
+			return arena.Make<ASTIfStmt>(*expr, *block);
+		}
+
+		if (reader.MatchPeek(TokenType::If))
+		{
+			// 'else if' is sugar for an else block containing just the nested if statement
+			ParseResultPtr<ASTIfStmt> else_if = ParseIfStatement(reader, arena);
+			if (!else_if)
+			{
+				return std::unexpected(else_if.error());
+			}
+
+			const ASTStmt* const statements[] = { *else_if };
+
+			return arena.Make<ASTIfStmt>(*expr, *block, arena.Make<ASTBlock>(arena.MakeArray<const ASTStmt*>(statements)));
+		}
+
+		ParseResultPtr<ASTBlock> else_block = ParseBlock(reader, arena);
+		if (!else_block)
+		{
+			return std::unexpected(else_block.error());
+		}
+
+		return arena.Make<ASTIfStmt>(*expr, *block, *else_block);
+	}
+
+	// while_statement := "while" "(" expr ")" block
+	ParseResultPtr<ASTWhileStmt> ParseWhileStatement(TokenReader& reader, ASTArena& arena)
+	{
+		if (!reader.MatchConsume(TokenType::While))
+		{
+			return std::unexpected("Expected 'while' when parsing while statement");
+		}
+
+		if (!reader.MatchConsume(TokenType::LeftParen))
+		{
+			return std::unexpected("Expected '(' when parsing while statement");
+		}
+
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
+		if (!expr)
+		{
+			return std::unexpected(expr.error());
+		}
+
+		if (!reader.MatchConsume(TokenType::RightParen))
+		{
+			return std::unexpected("Expected ')' when parsing while statement");
+		}
+
+		ParseResultPtr<ASTBlock> block = ParseBlock(reader, arena);
 		if (!block)
 		{
 			return std::unexpected(block.error());
 		}
 
-		return std::make_unique<ASTIfStmt>(std::move(*expr), std::move(*block));
+		return arena.Make<ASTWhileStmt>(*expr, *block);
+	}
+
+	// for_statement := "for" "(" identifier "=" expr "," expr ")" block
+	ParseResultPtr<ASTForStmt> ParseForStatement(TokenReader& reader, ASTArena& arena)
+	{
+		if (!reader.MatchConsume(TokenType::For))
+		{
+			return std::unexpected("Expected 'for' when parsing for statement");
+		}
+
+		if (!reader.MatchConsume(TokenType::LeftParen))
+		{
+			return std::unexpected("Expected '(' when parsing for statement");
+		}
+
+		const std::optional<Token> identifier = reader.MatchConsume(TokenType::Identifier);
+		if (!identifier)
+		{
+			return std::unexpected("Expected identifier when parsing for statement");
+		}
+
+		if (!reader.MatchConsume(TokenType::Assign))
+		{
+			return std::unexpected("Expected '=' when parsing for statement");
+		}
+
+		ParseResultPtr<ASTExpr> start = ParseExpression(reader, arena);
+		if (!start)
+		{
+			return std::unexpected(start.error());
+		}
+
+		if (!reader.MatchConsume(TokenType::Comma))
+		{
+			return std::unexpected("Expected ',' when parsing for statement");
+		}
+
+		ParseResultPtr<ASTExpr> limit = ParseExpression(reader, arena);
+		if (!limit)
+		{
+			return std::unexpected(limit.error());
+		}
+
+		if (!reader.MatchConsume(TokenType::RightParen))
+		{
+			return std::unexpected("Expected ')' when parsing for statement");
+		}
+
+		ParseResultPtr<ASTBlock> block = ParseBlock(reader, arena);
+		if (!block)
+		{
+			return std::unexpected(block.error());
+		}
+
+		return arena.Make<ASTForStmt>(identifier->symbol, *start, *limit, *block);
+	}
+
+	// match_value := "-"? i32_literal
+	ParseResult<int32_t> ParseMatchValue(TokenReader& reader)
+	{
+		const bool negative = reader.MatchConsume(TokenType::Minus).has_value();
+
+		const std::optional<Token> literal = reader.MatchConsume(TokenType::I32);
+		if (!literal)
+		{
+			return std::unexpected("Expected integer when parsing match arm");
+		}
+
+		int64_t value = 0;
+		const std::string_view lexeme = reader.GetLexeme(*literal);
+		const auto [end, error] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+		value = negative ? -value : value;
+		if (error != std::errc() || end != lexeme.data() + lexeme.size() || value < INT32_MIN || value > INT32_MAX)
+		{
+			return std::unexpected(std::format("'{}' is not a valid i32 when parsing match arm", lexeme));
+		}
+
+		return static_cast<int32_t>(value);
+	}
+
+	// match_statement := "match" "(" expr ")" "{" match_arm* ("else" "=>" block)? "}"
+	// match_arm := match_value ("," match_value)* "=>" block
+	ParseResultPtr<ASTMatchStmt> ParseMatchStatement(TokenReader& reader, ASTArena& arena)
+	{
+		if (!reader.MatchConsume(TokenType::Match))
+		{
+			return std::unexpected("Expected 'match' when parsing match statement");
+		}
+
+		if (!reader.MatchConsume(TokenType::LeftParen))
+		{
+			return std::unexpected("Expected '(' when parsing match statement");
+		}
+
+		ParseResultPtr<ASTExpr> expr = ParseExpression(reader, arena);
+		if (!expr)
+		{
+			return std::unexpected(expr.error());
+		}
+
+		if (!reader.MatchConsume(TokenType::RightParen))
+		{
+			return std::unexpected("Expected ')' when parsing match statement");
+		}
+
+		if (!reader.MatchConsume(TokenType::LeftCurly))
+		{
+			return std::unexpected("Expected '{' when parsing match statement");
+		}
+
+		std::vector<MatchArm> arms;
+		std::vector<int32_t> arm_values;
+		std::unordered_set<int32_t> seen_values;
+
+		while (reader.Peek() && !reader.MatchPeek(TokenType::RightCurly) && !reader.MatchPeek(TokenType::Else))
+		{
+			arm_values.clear();
+
+			do
+			{
+				ParseResult<int32_t> value = ParseMatchValue(reader);
+				if (!value)
+				{
+					return std::unexpected(value.error());
+				}
+
+				if (!seen_values.insert(*value).second)
+				{
+					return std::unexpected(std::format("Value {} appears in more than one match arm", *value));
+				}
+
+				arm_values.push_back(*value);
+			} while (reader.MatchConsume(TokenType::Comma));
+
+			if (!reader.MatchConsume(TokenType::FatArrow))
+			{
+				return std::unexpected("Expected '=>' when parsing match arm");
+			}
+
+			ParseResultPtr<ASTBlock> block = ParseBlock(reader, arena);
+			if (!block)
+			{
+				return std::unexpected(block.error());
+			}
+
+			arms.push_back({ arena.MakeArray(arm_values), *block });
+		}
+
+		const ASTBlock* else_arm = nullptr;
+		if (reader.MatchConsume(TokenType::Else))
+		{
+			if (!reader.MatchConsume(TokenType::FatArrow))
+			{
+				return std::unexpected("Expected '=>' when parsing match arm");
+			}
+
+			ParseResultPtr<ASTBlock> block = ParseBlock(reader, arena);
+			if (!block)
+			{
+				return std::unexpected(block.error());
+			}
+
+			else_arm = *block;
+		}
+
+		if (!reader.MatchConsume(TokenType::RightCurly))
+		{
+			return std::unexpected("Expected '}' when parsing match statement");
+		}
+
+		return arena.Make<ASTMatchStmt>(*expr, arena.MakeArray(arms), else_arm);
 	}
 
 	// stmt := return_stmt
 	//		 | if_stmt
+	//		 | while_stmt
+	//		 | for_stmt
+	//		 | match_stmt
 	//       | variable_declaration_stmt
 	//       | assignment_stmt
 	//       | function_declaration_stmt
-	ParseResultPtr<ASTStmt> ParseStatement(TokenReader& reader)
+	ParseResultPtr<ASTStmt> ParseStatement(TokenReader& reader, ASTArena& arena)
 	{
 		if (reader.MatchPeek(TokenType::Return))
 		{
-			return ParseReturnStatement(reader);
+			return ParseReturnStatement(reader, arena);
 		}
 
 		if (reader.MatchPeek(TokenType::If))
 		{
-			return ParseIfStatement(reader);
+			return ParseIfStatement(reader, arena);
+		}
+
+		if (reader.MatchPeek(TokenType::While))
+		{
+			return ParseWhileStatement(reader, arena);
+		}
+
+		if (reader.MatchPeek(TokenType::For))
+		{
+			return ParseForStatement(reader, arena);
+		}
+
+		if (reader.MatchPeek(TokenType::Match))
+		{
+			return ParseMatchStatement(reader, arena);
 		}
 
 		if (reader.MatchPeek(TokenType::Identifier))
@@ -713,22 +1028,22 @@ namespace Osprey
 			{
 				if (reader.MatchPeek(TokenType::Assign, 2))
 				{
-					return ParseFunctionDeclarationStatement(reader);
+					return ParseFunctionDeclarationStatement(reader, arena);
 				}
 				else
 				{
-					return ParseVariableDeclarationStatement(reader);
+					return ParseVariableDeclarationStatement(reader, arena);
 				}
 			}
 			else
 			{
-				return ParseAssignmentStatement(reader);
+				return ParseAssignmentStatement(reader, arena);
 			}
 		}
 
 		if (reader.Peek())
 		{
-			return std::unexpected(std::format("Unexpected '{}' when parsing statement", reader.Peek()->lexeme));
+			return std::unexpected(std::format("Unexpected '{}' when parsing statement", reader.GetLexeme(*reader.Peek())));
 		}
 		else
 		{
@@ -736,24 +1051,24 @@ namespace Osprey
 		}
 	}
 
-	ParseResultPtr<ASTBlock> ParseBlock(TokenReader& reader)
+	ParseResultPtr<ASTBlock> ParseBlock(TokenReader& reader, ASTArena& arena)
 	{
 		if (!reader.MatchConsume(TokenType::LeftCurly))
 		{
 			return std::unexpected("Expected '{' when parsing block");
 		}
 
-		std::vector<std::unique_ptr<ASTStmt>> statements;
+		std::vector<const ASTStmt*> statements;
 
 		while (reader.Peek() && !reader.MatchPeek(TokenType::RightCurly))
 		{
-			ParseResultPtr<ASTStmt> statement = ParseStatement(reader);
+			ParseResultPtr<ASTStmt> statement = ParseStatement(reader, arena);
 			if (!statement)
 			{
 				return std::unexpected(statement.error());
 			}
 
-			statements.push_back(std::move(*statement));
+			statements.push_back(*statement);
 		}
 
 		if (!reader.MatchConsume(TokenType::RightCurly))
@@ -761,47 +1076,349 @@ namespace Osprey
 			return std::unexpected("Expected '}' when parsing block");
 		}
 
-		return std::make_unique<ASTBlock>(std::move(statements));
+		return arena.Make<ASTBlock>(arena.MakeArray(statements));
 	}
 
 	// program := statement*
-	ParseResultPtr<ASTProgram> ParseProgram(TokenReader& reader)
+	// Appends the index of each statement's first token, counting from the reader's, to 'statement_starts'
+	ParseResultPtr<ASTProgram> ParseProgram(TokenReader& reader, ASTArena& arena, std::vector<uint32_t>& statement_starts)
 	{
-		std::vector<std::unique_ptr<ASTStmt>> statements;
+		std::vector<const ASTStmt*> statements;
 
 		while (reader.HasMore())
 		{
-			ParseResultPtr<ASTStmt> statement = ParseStatement(reader);
+			statement_starts.push_back(static_cast<uint32_t>(reader.GetConsumedCount()));
+
+			ParseResultPtr<ASTStmt> statement = ParseStatement(reader, arena);
 			if (!statement)
 			{
 				return std::unexpected(statement.error());
 			}
 
-			statements.push_back(std::move(*statement));
+			statements.push_back(*statement);
 		}
 
-		return std::make_unique<ASTProgram>(std::move(statements));
+		return arena.Make<ASTProgram>(arena.MakeArray(statements));
 	}
 
-	std::expected<AST, ErrorMessage> Parse(const TokenBuffer& tokens)
+	// Adds where the reader had got to when the parser gave up
+	ErrorMessage LocateError(TokenReader& reader, std::string_view source, const ErrorMessage& error)
 	{
-		TokenReader reader(tokens);
+		const std::optional<Token> current_token = reader.Peek();
+		if (!current_token)
+		{
+			return error;
+		}
+
+		const SourceLocation location = SourceLineIndex(source).GetLocation(current_token->offset);
+		return std::format("{} (at line {}, column {})", error, location.line, location.column);
+	}
+
+	// Parses the whole of 'source', skipping function bodies if 'lazy' is given
+	std::expected<AST, ErrorMessage> ParseSource(TokenSource& source, LazyBodyContext* lazy)
+	{
+		TokenReader reader(source, lazy);
+		ASTArena arena;
+		std::vector<uint32_t> statement_starts;
+
+		ParseResultPtr<ASTProgram> program = ParseProgram(reader, arena, statement_starts);
+
+		// A tokeniser error cuts the token stream short, which is what the parser tripped over
+		if (const std::optional<ErrorMessage>& tokeniser_error = reader.GetTokeniserError())
+		{
+			return std::unexpected(*tokeniser_error);
+		}
 
-		ParseResultPtr<ASTProgram> program = ParseProgram(reader);
 		if (!program)
 		{
-			std::optional<Token> current_token = reader.Peek();
+			return std::unexpected(LocateError(reader, source.GetSource(), program.error()));
+		}
+
+		return AST(std::move(arena), *program, std::move(statement_starts), lazy ? std::move(lazy->bodies) : LazyFunctionBodies());
+	}
+
+	std::expected<AST, ErrorMessage> Parse(TokenSource& source)
+	{
+		return ParseSource(source, nullptr);
+	}
+
+	LazyFunctionBody::LazyFunctionBody(std::span<const Token> tokens, std::string_view source)
+		: m_tokens(tokens)
+		, m_source(source)
+	{
+	}
+
+	const ASTBlock* LazyFunctionBody::Get() const
+	{
+		std::call_once(m_parsed, [this]() { Parse(); });
+		return m_body;
+	}
+
+	const std::optional<ErrorMessage>& LazyFunctionBody::GetError() const
+	{
+		std::call_once(m_parsed, [this]() { Parse(); });
+		return m_error;
+	}
+
+	void LazyFunctionBody::Parse() const
+	{
+		TokenBufferSource source(m_tokens, m_source);
+		LazyBodyContext lazy = { m_tokens, m_source, 0, m_nested_bodies };
+		TokenReader reader(source, &lazy);
+
+		// The braces were matched when the body was skipped, so the block ends with the tokens
+		ParseResultPtr<ASTBlock> body = ParseBlock(reader, m_arena);
+		if (!body)
+		{
+			m_error = LocateError(reader, source.GetSource(), body.error());
+			return;
+		}
+
+		m_body = *body;
+	}
+
+	// Finds where to cut the tokens into runs of whole top-level statements, each at least
+	// 'min_tokens' long. A declaration 'name := ...' outside of any brackets can only start a
+	// top-level statement, so the cuts are made before those.
+	std::vector<size_t> FindChunkStarts(const TokenBuffer& tokens, size_t min_tokens)
+	{
+		std::vector<size_t> starts = { 0 };
+		int64_t depth = 0;
+
+		for (size_t index = 0; index + 2 < tokens.size(); ++index)
+		{
+			switch (tokens[index].type)
+			{
+			case TokenType::LeftCurly:
+			case TokenType::LeftParen:
+				++depth;
+				break;
+			case TokenType::RightCurly:
+			case TokenType::RightParen:
+				--depth;
+				break;
+			case TokenType::Identifier:
+				if (depth == 0
+					&& index - starts.back() >= min_tokens
+					&& tokens[index + 1].type == TokenType::Colon
+					&& tokens[index + 2].type == TokenType::Assign)
+				{
+					starts.push_back(index);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		return starts;
+	}
+
+	// Parses each chunk of top-level statements on its own thread into its own arena, then
+	// joins them in order. Returns nothing if any chunk fails to parse.
+	std::optional<AST> ParseChunks(const TokenBuffer& tokens, std::span<const size_t> starts, size_t thread_count, bool lazy_function_bodies)
+	{
+		struct Chunk
+		{
+			ASTArena arena;
+			const ASTProgram* program = nullptr;
+			std::vector<uint32_t> statement_starts;
+			LazyFunctionBodies lazy_bodies;
+		};
+
+		std::vector<Chunk> chunks(starts.size());
+
+		ParallelFor(chunks.size(), thread_count, [&](size_t index)
+			{
+				const size_t end = index + 1 < starts.size() ? starts[index + 1] : tokens.size();
+				TokenBufferSource source(tokens, starts[index], end);
+				LazyBodyContext lazy = { tokens.GetTokens(), tokens.GetSource(), starts[index], chunks[index].lazy_bodies };
+				TokenReader reader(source, lazy_function_bodies ? &lazy : nullptr);
+
+				if (ParseResultPtr<ASTProgram> program = ParseProgram(reader, chunks[index].arena, chunks[index].statement_starts))
+				{
+					chunks[index].program = *program;
+				}
+			});
+
+		ASTArena arena;
+		std::vector<const ASTStmt*> statements;
+		std::vector<uint32_t> statement_starts;
+		LazyFunctionBodies lazy_bodies;
+
+		for (size_t index = 0; index < chunks.size(); ++index)
+		{
+			Chunk& chunk = chunks[index];
+			if (!chunk.program)
+			{
+				return std::nullopt;
+			}
 
-			if (current_token)
+			statements.insert(statements.end(), chunk.program->GetStatements().begin(), chunk.program->GetStatements().end());
+			for (const uint32_t start : chunk.statement_starts)
 			{
-				return std::unexpected(std::format("{} (at line {}, column {})", program.error(), current_token->line, current_token->column));
+				statement_starts.push_back(static_cast<uint32_t>(starts[index] + start));
 			}
-			else
+			arena.Adopt(std::move(chunk.arena));
+			std::ranges::move(chunk.lazy_bodies, std::back_inserter(lazy_bodies));
+		}
+
+		const ASTProgram* program = arena.Make<ASTProgram>(arena.MakeArray(statements));
+		return AST(std::move(arena), program, std::move(statement_starts), std::move(lazy_bodies));
+	}
+
+	std::expected<AST, ErrorMessage> Parse(const TokenBuffer& tokens, const ParseOptions& options)
+	{
+		const size_t thread_count = options.thread_count > 0 ? options.thread_count : std::max(1u, std::thread::hardware_concurrency());
+
+		if (thread_count > 1)
+		{
+			// A few chunks per thread keeps the threads busy when the statements vary in size
+			const size_t chunk_tokens = std::max<size_t>({ options.min_chunk_tokens, tokens.size() / (thread_count * 4), 1 });
+
+			const std::vector<size_t> starts = FindChunkStarts(tokens, chunk_tokens);
+			if (starts.size() > 1)
+			{
+				if (std::optional<AST> ast = ParseChunks(tokens, starts, thread_count, options.lazy_function_bodies))
+				{
+					return std::move(*ast);
+				}
+
+				// Parse again in one go below, to report the error as it would be otherwise
+			}
+		}
+
+		TokenBufferSource source(tokens);
+		LazyFunctionBodies lazy_bodies;
+		LazyBodyContext lazy = { tokens.GetTokens(), tokens.GetSource(), 0, lazy_bodies };
+		return ParseSource(source, options.lazy_function_bodies ? &lazy : nullptr);
+	}
+
+	std::expected<ParsedScript, ErrorMessage> ParseFromScratch(std::string_view source)
+	{
+		std::expected<TokenBuffer, ErrorMessage> tokens = Tokenise(source);
+		if (!tokens)
+		{
+			return std::unexpected(tokens.error());
+		}
+
+		std::expected<AST, ErrorMessage> ast = Parse(*tokens);
+		if (!ast)
+		{
+			return std::unexpected(ast.error());
+		}
+
+		return ParsedScript{ std::move(*tokens), std::move(*ast) };
+	}
+
+	std::expected<ParsedScript, ErrorMessage> Reparse(AST previous, TokenBuffer previous_tokens, std::string_view source, const TextEdit& edit)
+	{
+		assert(edit.offset + edit.length <= previous_tokens.GetSource().size());
+		assert(previous_tokens.GetSource().size() - edit.length + edit.text.size() == source.size());
+
+		const std::span<const uint32_t> previous_starts = previous.GetStatementTokenStarts();
+		if (previous_starts.empty() || previous.HasLazyFunctionBodies())
+		{
+			return ParseFromScratch(source);
+		}
+
+		const size_t edit_end = edit.offset + edit.length;
+		const int64_t offset_shift = static_cast<int64_t>(edit.text.size()) - static_cast<int64_t>(edit.length);
+
+		// The first token the edit can change is the first to reach its start, as one that
+		// ends just before could run on into the new text. The statement to parse again is
+		// the one holding the token before that, which the edit could continue, e.g. with
+		// an 'else'.
+		const size_t first_changed = std::ranges::partition_point(previous_tokens, [&](const Token& token) { return token.offset + token.length < edit.offset; }) - previous_tokens.begin();
+		const size_t first_statement = std::ranges::upper_bound(previous_starts, static_cast<uint32_t>(first_changed > 0 ? first_changed - 1 : 0)) - previous_starts.begin() - 1;
+		const size_t begin = previous_starts[first_statement];
+
+		// Tokenise from the statement until a token starts where a previous token after the
+		// edit did, from where the tokens can only be the same as before
+		size_t resync = std::ranges::partition_point(previous_tokens, [&](const Token& token) { return token.offset < edit_end; }) - previous_tokens.begin();
+		TokenStream stream(source, begin > 0 ? previous_tokens[begin].offset : 0);
+		std::vector<Token> relexed;
+
+		while (true)
+		{
+			std::expected<std::optional<Token>, ErrorMessage> token = stream.Next();
+			if (!token)
 			{
-				return std::unexpected(program.error());
+				return std::unexpected(token.error());
 			}
+
+			if (!*token)
+			{
+				resync = previous_tokens.size();
+				break;
+			}
+
+			if ((*token)->offset >= edit.offset + edit.text.size())
+			{
+				while (resync < previous_tokens.size() && previous_tokens[resync].offset + offset_shift < (*token)->offset)
+				{
+					++resync;
+				}
+
+				if (resync < previous_tokens.size() && previous_tokens[resync].offset + offset_shift == (*token)->offset)
+				{
+					break;
+				}
+			}
+
+			relexed.push_back(**token);
+		}
+
+		const int64_t token_shift = static_cast<int64_t>(begin + relexed.size()) - static_cast<int64_t>(resync);
+		TokenBuffer tokens = std::move(previous_tokens);
+		tokens.Replace(begin, resync, relexed, offset_shift, source);
+
+		// The statements from the first one that starts at or after the point the tokens
+		// line up again are unchanged
+		const size_t end_statement = std::max(first_statement + 1, static_cast<size_t>(std::ranges::lower_bound(previous_starts, static_cast<uint32_t>(resync)) - previous_starts.begin()));
+		const size_t end = end_statement < previous_starts.size() ? previous_starts[end_statement] + token_shift : tokens.size();
+
+		TokenBufferSource range_source(tokens, begin, end);
+		TokenReader reader(range_source);
+		ASTArena range_arena;
+		std::vector<uint32_t> range_starts;
+
+		ParseResultPtr<ASTProgram> range_program = ParseProgram(reader, range_arena, range_starts);
+		if (!range_program)
+		{
+			// Either the script does not parse, which parsing it in full reports as it would
+			// otherwise, or the edit moved where statements start
+			return ParseFromScratch(source);
 		}
 
-		return AST(std::move(*program));
+		const std::span<const ASTStmt* const> previous_statements = previous.GetRoot()->GetStatements();
+
+		std::vector<const ASTStmt*> statements(previous_statements.begin(), previous_statements.begin() + first_statement);
+		statements.insert(statements.end(), (*range_program)->GetStatements().begin(), (*range_program)->GetStatements().end());
+		statements.insert(statements.end(), previous_statements.begin() + end_statement, previous_statements.end());
+
+		std::vector<uint32_t> statement_starts(previous_starts.begin(), previous_starts.begin() + first_statement);
+		for (const uint32_t start : range_starts)
+		{
+			statement_starts.push_back(static_cast<uint32_t>(begin + start));
+		}
+		for (size_t index = end_statement; index < previous_starts.size(); ++index)
+		{
+			statement_starts.push_back(static_cast<uint32_t>(previous_starts[index] + token_shift));
+		}
+
+		// Replaced statements stay in the arena, so once they take up as much of it as
+		// the rest, parse the script afresh to let them go
+		const size_t replaced_bytes = previous.GetReplacedBytes() + range_arena.GetBytesAllocated() + statements.size() * sizeof(const ASTStmt*);
+		ASTArena arena = std::move(previous).TakeArena();
+		if (2 * replaced_bytes > arena.GetBytesAllocated())
+		{
+			return ParseFromScratch(source);
+		}
+
+		arena.Adopt(std::move(range_arena));
+		const ASTProgram* program = arena.Make<ASTProgram>(arena.MakeArray(statements));
+
+		return ParsedScript{ std::move(tokens), AST(std::move(arena), program, std::move(statement_starts), {}, replaced_bytes) };
 	}
 }
\ No newline at end of file
@@ -4,9 +4,10 @@
 
 namespace Osprey
 {
-	ASTAssignmentStmt::ASTAssignmentStmt(std::string identifier, std::unique_ptr<ASTExpr> expression)
-		: m_identifier(identifier)
-		, m_expr(std::move(expression))
+	ASTAssignmentStmt::ASTAssignmentStmt(SymbolId symbol, const ASTExpr* expression)
+		: ASTStmt(ASTNodeKind::Assignment)
+		, m_symbol(symbol)
+		, m_expr(expression)
 	{
 	}
 
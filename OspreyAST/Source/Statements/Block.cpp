@@ -4,8 +4,9 @@
 
 namespace Osprey
 {
-	ASTBlock::ASTBlock(std::vector<std::unique_ptr<ASTStmt>> statements)
-		: m_statements(std::move(statements))
+	ASTBlock::ASTBlock(std::span<const ASTStmt* const> statements)
+		: ASTStmt(ASTNodeKind::Block)
+		, m_statements(statements)
 	{
 	}
 
@@ -14,7 +15,7 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	const std::vector<std::unique_ptr<ASTStmt>>& ASTBlock::GetStatements() const
+	std::span<const ASTStmt* const> ASTBlock::GetStatements() const
 	{
 		return m_statements;
 	}
@@ -0,0 +1,36 @@
+#include "OspreyAST/Statements/For.h"
+
+#include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/Statements/Block.h"
+
+namespace Osprey
+{
+	ASTForStmt::ASTForStmt(SymbolId symbol, const ASTExpr* start, const ASTExpr* limit, const ASTBlock* body)
+		: ASTStmt(ASTNodeKind::For)
+		, m_symbol(symbol)
+		, m_start(start)
+		, m_limit(limit)
+		, m_body(body)
+	{
+	}
+
+	ASTVisitorTraversal ASTForStmt::Accept(ASTVisitor& visitor) const
+	{
+		return visitor.Visit(*this);
+	}
+
+	const ASTExpr* ASTForStmt::GetStart() const
+	{
+		return m_start;
+	}
+
+	const ASTExpr* ASTForStmt::GetLimit() const
+	{
+		return m_limit;
+	}
+
+	const ASTBlock* ASTForStmt::GetBody() const
+	{
+		return m_body;
+	}
+}
\ No newline at end of file
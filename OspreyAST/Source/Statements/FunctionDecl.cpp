@@ -1,13 +1,15 @@
 #include "OspreyAST/Statements/FunctionDecl.h"
 
 #include "OspreyAST/Expressions/FunctionExpression.h"
+#include "OspreyAST/Statements/Block.h"
 #include "OspreyAST/ASTVisitor.h"
 
 namespace Osprey
 {
-	ASTFunctionDeclarationStmt::ASTFunctionDeclarationStmt(std::string identifier, std::unique_ptr<ASTFunctionExpr> function_expr)
-		: m_identifier(std::move(identifier))
-		, m_function_expr(std::move(function_expr))
+	ASTFunctionDeclarationStmt::ASTFunctionDeclarationStmt(SymbolId symbol, const ASTFunctionExpr* function_expr)
+		: ASTStmt(ASTNodeKind::FunctionDeclaration)
+		, m_symbol(symbol)
+		, m_function_expr(function_expr)
 	{
 	}
 
@@ -5,9 +5,11 @@
 
 namespace Osprey
 {
-	ASTIfStmt::ASTIfStmt(std::unique_ptr<ASTExpr> predicate, std::unique_ptr<ASTBlock> true_block)
-		: m_predicate(std::move(predicate))
-		, m_true_block(std::move(true_block))
+	ASTIfStmt::ASTIfStmt(const ASTExpr* predicate, const ASTBlock* true_block, const ASTBlock* false_block)
+		: ASTStmt(ASTNodeKind::If)
+		, m_predicate(predicate)
+		, m_true_block(true_block)
+		, m_false_block(false_block)
 	{
 	}
 
@@ -16,13 +18,18 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	const std::unique_ptr<ASTExpr>& ASTIfStmt::GetPredicate() const
+	const ASTExpr* ASTIfStmt::GetPredicate() const
 	{
 		return m_predicate;
 	}
 
-	const std::unique_ptr<ASTBlock>& ASTIfStmt::GetTrueBlock() const
+	const ASTBlock* ASTIfStmt::GetTrueBlock() const
 	{
 		return m_true_block;
 	}
+
+	const ASTBlock* ASTIfStmt::GetFalseBlock() const
+	{
+		return m_false_block;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "OspreyAST/Statements/Match.h"
+
+#include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/Statements/Block.h"
+
+namespace Osprey
+{
+	ASTMatchStmt::ASTMatchStmt(const ASTExpr* value, std::span<const MatchArm> arms, const ASTBlock* else_arm)
+		: ASTStmt(ASTNodeKind::Match)
+		, m_value(value)
+		, m_arms(arms)
+		, m_else_arm(else_arm)
+	{
+	}
+
+	ASTVisitorTraversal ASTMatchStmt::Accept(ASTVisitor& visitor) const
+	{
+		return visitor.Visit(*this);
+	}
+
+	const ASTExpr* ASTMatchStmt::GetValue() const
+	{
+		return m_value;
+	}
+
+	std::span<const MatchArm> ASTMatchStmt::GetArms() const
+	{
+		return m_arms;
+	}
+
+	const ASTBlock* ASTMatchStmt::GetElseArm() const
+	{
+		return m_else_arm;
+	}
+}
\ No newline at end of file
@@ -4,8 +4,9 @@
 
 namespace Osprey
 {
-	ASTReturn::ASTReturn(std::unique_ptr<ASTExpr> expression)
-		: m_expression_node(std::move(expression))
+	ASTReturn::ASTReturn(const ASTExpr* expression)
+		: ASTStmt(ASTNodeKind::Return)
+		, m_expression_node(expression)
 	{
 	}
 
@@ -14,7 +15,7 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	const std::unique_ptr<ASTExpr>& ASTReturn::GetExpressionNode() const
+	const ASTExpr* ASTReturn::GetExpressionNode() const
 	{
 		return m_expression_node;
 	}
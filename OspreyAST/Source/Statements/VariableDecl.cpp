@@ -4,10 +4,11 @@
 
 namespace Osprey
 {
-	ASTVariableDeclarationStmt::ASTVariableDeclarationStmt(std::string identifier, Type type, std::unique_ptr<ASTExpr> expression)
-		: m_identifier(std::move(identifier))
+	ASTVariableDeclarationStmt::ASTVariableDeclarationStmt(SymbolId symbol, Type type, const ASTExpr* expression)
+		: ASTStmt(ASTNodeKind::VariableDeclaration)
+		, m_symbol(symbol)
 		, m_type(type)
-		, m_expression_node(std::move(expression))
+		, m_expression_node(expression)
 	{
 	}
 
@@ -16,12 +17,7 @@ namespace Osprey
 		return visitor.Visit(*this);
 	}
 
-	const std::string& ASTVariableDeclarationStmt::GetIdentifier() const
-	{
-		return m_identifier;
-	}
-
-	const std::unique_ptr<ASTExpr>& ASTVariableDeclarationStmt::GetExpressionNode() const
+	const ASTExpr* ASTVariableDeclarationStmt::GetExpressionNode() const
 	{
 		return m_expression_node;
 	}
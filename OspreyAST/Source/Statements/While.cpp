@@ -0,0 +1,29 @@
+#include "OspreyAST/Statements/While.h"
+
+#include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/Statements/Block.h"
+
+namespace Osprey
+{
+	ASTWhileStmt::ASTWhileStmt(const ASTExpr* predicate, const ASTBlock* body)
+		: ASTStmt(ASTNodeKind::While)
+		, m_predicate(predicate)
+		, m_body(body)
+	{
+	}
+
+	ASTVisitorTraversal ASTWhileStmt::Accept(ASTVisitor& visitor) const
+	{
+		return visitor.Visit(*this);
+	}
+
+	const ASTExpr* ASTWhileStmt::GetPredicate() const
+	{
+		return m_predicate;
+	}
+
+	const ASTBlock* ASTWhileStmt::GetBody() const
+	{
+		return m_body;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "OspreyAST/Symbol.h"
+
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace Osprey
+{
+	namespace
+	{
+		struct SymbolStorage
+		{
+			std::shared_mutex mutex;
+			// Deque so the names that the map's keys view never move
+			std::deque<std::string> names = { std::string() };
+			std::unordered_map<std::string_view, SymbolId> symbols;
+		};
+
+		SymbolStorage& GetStorage()
+		{
+			static SymbolStorage storage;
+			return storage;
+		}
+	}
+
+	SymbolId SymbolTable::Intern(std::string_view name)
+	{
+		SymbolStorage& storage = GetStorage();
+
+		{
+			std::shared_lock lock(storage.mutex);
+			if (const auto it = storage.symbols.find(name); it != storage.symbols.end())
+			{
+				return it->second;
+			}
+		}
+
+		std::unique_lock lock(storage.mutex);
+		if (const auto it = storage.symbols.find(name); it != storage.symbols.end())
+		{
+			return it->second;
+		}
+
+		const SymbolId symbol = static_cast<SymbolId>(storage.names.size());
+		const std::string& stored_name = storage.names.emplace_back(name);
+		storage.symbols.emplace(stored_name, symbol);
+		return symbol;
+	}
+
+	const std::string& SymbolTable::GetName(SymbolId symbol)
+	{
+		SymbolStorage& storage = GetStorage();
+
+		std::shared_lock lock(storage.mutex);
+		assert(symbol < storage.names.size());
+		return storage.names[symbol];
+	}
+}
\ No newline at end of file
@@ -1,28 +1,208 @@
 #include "OspreyAST/Tokeniser.h"
 
-#include <print>
+#include <algorithm>
+#include <array>
+#include <format>
+#include <limits>
 #include <optional>
 
 namespace Osprey
 {
-	std::expected<TokenBuffer, ErrorMessage> Tokenise(const std::string script)
+	namespace
 	{
-		TokenBuffer tokens;
-		size_t cursor = 0;
+		enum class CharClass
+		{
+			Whitespace,
+			Number,
+			Identifier,
+		};
+
+		constexpr bool IsDigit(uint8_t c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		constexpr bool IsAlpha(uint8_t c)
+		{
+			return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+		}
+
+		template<CharClass Class>
+		constexpr bool InClass(uint8_t c)
+		{
+			switch (Class)
+			{
+				case CharClass::Whitespace: return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+				case CharClass::Number: return IsDigit(c) || c == '.';
+				case CharClass::Identifier: return IsAlpha(c) || IsDigit(c);
+			}
+			return false;
+		}
+
+		// Advances the cursor past every character in the class
+		template<CharClass Class>
+		size_t SkipWhile(std::string_view script, size_t cursor)
+		{
+			while (cursor < script.size() && InClass<Class>(static_cast<uint8_t>(script[cursor])))
+			{
+				++cursor;
+			}
+			return cursor;
+		}
+
+		struct Keyword
+		{
+			std::string_view spelling;
+			TokenType type;
+		};
+
+		constexpr std::array<Keyword, 8> Keywords = { {
+			{ "return", TokenType::Return },
+			{ "if", TokenType::If },
+			{ "else", TokenType::Else },
+			{ "while", TokenType::While },
+			{ "for", TokenType::For },
+			{ "match", TokenType::Match },
+			{ "i32", TokenType::I32 },
+			// { "f32", TokenType::F32 },
+			{ "mut", TokenType::Mutable },
+		} };
+
+		// Perfect hash over the keyword set, only the length and the first and last characters are read
+		constexpr size_t KeywordTableSize = 16;
+
+		constexpr size_t HashKeyword(std::string_view word)
+		{
+			return (word.size() + static_cast<uint8_t>(word.front()) + static_cast<uint8_t>(word.back()) * 2) % KeywordTableSize;
+		}
+
+		constexpr std::array<std::optional<Keyword>, KeywordTableSize> BuildKeywordTable()
+		{
+			std::array<std::optional<Keyword>, KeywordTableSize> table{};
+			for (const Keyword& keyword : Keywords)
+			{
+				table[HashKeyword(keyword.spelling)] = keyword;
+			}
+			return table;
+		}
+
+		constexpr std::array<std::optional<Keyword>, KeywordTableSize> KeywordTable = BuildKeywordTable();
+
+		constexpr bool IsKeywordTablePerfect()
+		{
+			return std::ranges::all_of(Keywords, [](const Keyword& keyword)
+				{
+					return KeywordTable[HashKeyword(keyword.spelling)]->spelling == keyword.spelling;
+				});
+		}
+
+		static_assert(IsKeywordTablePerfect(), "Keywords collide in the perfect hash, adjust HashKeyword");
+
+		std::optional<TokenType> LookupKeyword(std::string_view word)
+		{
+			const std::optional<Keyword>& candidate = KeywordTable[HashKeyword(word)];
+			if (candidate && candidate->spelling == word)
+			{
+				return candidate->type;
+			}
+			return std::nullopt;
+		}
+	}
+
+	TokenBuffer::TokenBuffer(std::string_view source)
+		: m_source(source)
+	{
+	}
+
+	void TokenBuffer::Replace(size_t begin, size_t end, std::span<const Token> tokens, int64_t offset_shift, std::string_view source)
+	{
+		// Only the tokens after the replaced ones move, and only if their number changes
+		if (tokens.size() > end - begin)
+		{
+			m_tokens.insert(m_tokens.begin() + end, tokens.size() - (end - begin), Token{});
+		}
+		else
+		{
+			m_tokens.erase(m_tokens.begin() + begin + tokens.size(), m_tokens.begin() + end);
+		}
+		std::ranges::copy(tokens, m_tokens.begin() + begin);
+
+		if (offset_shift != 0)
+		{
+			for (size_t index = begin + tokens.size(); index < m_tokens.size(); ++index)
+			{
+				m_tokens[index].offset = static_cast<uint32_t>(m_tokens[index].offset + offset_shift);
+			}
+		}
+
+		m_source = source;
+	}
+
+	SourceLocation TokenBuffer::GetLocation(const Token& token) const
+	{
+		return SourceLineIndex(m_source).GetLocation(token.offset);
+	}
+
+	SourceLineIndex::SourceLineIndex(std::string_view source)
+		: m_source(source)
+		, m_line_offsets({ 0 })
+	{
+		for (size_t offset = 0; offset < source.size(); ++offset)
+		{
+			if (source[offset] == '\n')
+			{
+				m_line_offsets.push_back(offset + 1);
+			}
+		}
+	}
+
+	SourceLocation SourceLineIndex::GetLocation(size_t offset) const
+	{
+		const auto next_line = std::ranges::upper_bound(m_line_offsets, offset);
+		const size_t line_offset = *std::prev(next_line);
+
+		size_t column = 1;
+		for (size_t cursor = line_offset; cursor < offset && cursor < m_source.size(); ++cursor)
+		{
+			column += m_source[cursor] == '\t' ? 4 : 1;
+		}
+
+		return { static_cast<size_t>(next_line - m_line_offsets.begin()), column };
+	}
+
+	TokenStream::TokenStream(std::string_view source)
+		: TokenStream(source, 0)
+	{
+	}
+
+	TokenStream::TokenStream(std::string_view source, size_t offset)
+		: m_source(source)
+		, m_cursor(offset)
+	{
+	}
+
+	std::expected<std::optional<Token>, ErrorMessage> TokenStream::Next()
+	{
+		// Tokens hold 32-bit offsets into the script
+		if (m_source.size() > std::numeric_limits<uint32_t>::max())
+		{
+			return std::unexpected("Script is too large to tokenise");
+		}
+
+		const std::string_view script = m_source;
+		size_t& cursor = m_cursor;
+		size_t token_start = 0;
 		const size_t script_size = script.size();
-		size_t column = 0;
-		size_t line = 1;
 
 		const auto Consume = [&]() -> uint8_t
 			{
-				uint8_t curr_char = script[cursor++];
-				column++;
-				return curr_char;
+				return script[cursor++];
 			};
 
-		const auto MakeToken = [&](TokenType token_type, std::string lexeme) -> Token
+		// The token runs from 'token_start' up to the cursor
+		const auto MakeToken = [&](TokenType token_type) -> Token
 			{
-				return { token_type, std::move(lexeme), line, column };
+				return { token_type, static_cast<uint32_t>(token_start), static_cast<uint32_t>(cursor - token_start) };
 			};
 
 		const auto Peek = [&]() -> std::optional<uint8_t>
@@ -30,197 +210,224 @@ namespace Osprey
 				return (cursor < script_size) ? std::optional<uint8_t>(script[cursor]) : std::nullopt;
 			};
 
-		while (cursor < script_size)
+		cursor = SkipWhile<CharClass::Whitespace>(script, cursor);
+		if (cursor >= script_size)
 		{
-			uint8_t curr_char = Consume();
+			return std::nullopt;
+		}
+
+		token_start = cursor;
+		uint8_t curr_char = Consume();
 
-			switch (curr_char)
+		switch (curr_char)
+		{
+			case ':':
+			{
+				return MakeToken(TokenType::Colon);
+			}
+			case ';':
 			{
-				case ' ':
+				return MakeToken(TokenType::Semicolon);
+			}
+			case '(':
+			{
+				return MakeToken(TokenType::LeftParen);
+			}
+			case ')':
+			{
+				return MakeToken(TokenType::RightParen);
+			}
+			case '{':
+			{
+				return MakeToken(TokenType::LeftCurly);
+			}
+			case '}':
+			{
+				return MakeToken(TokenType::RightCurly);
+			}
+			case ',':
+			{
+				return MakeToken(TokenType::Comma);
+			}
+			case '+':
+			{
+				return MakeToken(TokenType::Plus);
+			}
+			case '-':
+			{
+				if (Peek() && *Peek() == '>')
 				{
-					break;
+					Consume();
+					return MakeToken(TokenType::RightArrow);
 				}
-				case '\r':
+				else
 				{
-					break;
+					return MakeToken(TokenType::Minus);
 				}
-				case '\n':
+			}
+			case '*':
+			{
+				return MakeToken(TokenType::Asterisk);
+			}
+			case '/':
+			{
+				return MakeToken(TokenType::Divide);
+			}
+			case '%':
+			{
+				return MakeToken(TokenType::Percent);
+			}
+			case '&':
+			{
+				if (Peek() && *Peek() == '&')
 				{
-					++line;
-					column = 0;
-					break;
+					Consume();
+					return MakeToken(TokenType::And);
 				}
-				case '\t':
+				return std::unexpected("Unexpected character '&'");
+			}
+			case '|':
+			{
+				if (Peek() && *Peek() == '|')
 				{
-					column += 4;
-					break;
+					Consume();
+					return MakeToken(TokenType::Or);
 				}
-				case ':':
+				return std::unexpected("Unexpected character '|'");
+			}
+			case '!':
+			{
+				if (Peek() && *Peek() == '=')
 				{
-					tokens.push_back(MakeToken(TokenType::Colon, ":"));
-					break;
+					Consume();
+					return MakeToken(TokenType::NotEquality);
 				}
-				case ';':
+				else
 				{
-					tokens.push_back(MakeToken(TokenType::Semicolon, ";"));
-					break;
+					return MakeToken(TokenType::Exclamation);
 				}
-				case '(':
+			}
+			case '<':
+			{
+				if (Peek() && *Peek() == '=')
 				{
-					tokens.push_back(MakeToken(TokenType::LeftParen, "("));
-					break;
+					Consume();
+					return MakeToken(TokenType::LtEq);
 				}
-				case ')':
+				else
 				{
-					tokens.push_back(MakeToken(TokenType::RightParen, ")"));
-					break;
+					return MakeToken(TokenType::Lt);
 				}
-				case '{':
+			}
+			case '>':
+			{
+				if (Peek() && *Peek() == '=')
 				{
-					tokens.push_back(MakeToken(TokenType::LeftCurly, "{"));
-					break;
+					Consume();
+					return MakeToken(TokenType::GtEq);
 				}
-				case '}':
+				else
 				{
-					tokens.push_back(MakeToken(TokenType::RightCurly, "}"));
-					break;
+					return MakeToken(TokenType::Gt);
 				}
-				case ',':
+			}
+			case '=':
+			{
+				if (Peek() && *Peek() == '=')
 				{
-					tokens.push_back(MakeToken(TokenType::Comma, ","));
-					break;
+					Consume();
+					return MakeToken(TokenType::Equality);
 				}
-				case '+':
+				else if (Peek() && *Peek() == '>')
 				{
-					tokens.push_back(MakeToken(TokenType::Plus, "+"));
-					break;
+					Consume();
+					return MakeToken(TokenType::FatArrow);
 				}
-				case '-':
+				else
 				{
-					if (Peek() && *Peek() == '>')
-					{
-						tokens.push_back(MakeToken(TokenType::RightArrow, "->"));
-						Consume();
-					}
-					else
-					{
-						tokens.push_back(MakeToken(TokenType::Plus, "+"));
-					}
-					break;
+					return MakeToken(TokenType::Assign);
 				}
-				case '*':
+			}
+			default:
+			{
+				if (IsDigit(curr_char))
 				{
-					tokens.push_back(MakeToken(TokenType::Asterisk, "*"));
-					break;
+					// Only support basic positive integers!
+
+					// TODO: use regex instead, as '0.0.0f' is passes as a valid float
+					cursor = SkipWhile<CharClass::Number>(script, cursor);
+
+					return MakeToken(TokenType::I32);
 				}
-				case '=':
+				else if (IsAlpha(curr_char))
 				{
-					if (Peek() && *Peek() == '=')
+					cursor = SkipWhile<CharClass::Identifier>(script, cursor);
+
+					const std::string_view identifier_or_keyword = script.substr(token_start, cursor - token_start);
+
+					if (const std::optional<TokenType> keyword = LookupKeyword(identifier_or_keyword))
 					{
-						tokens.push_back(MakeToken(TokenType::Equality, "=="));
-						Consume();
+						return MakeToken(*keyword);
 					}
 					else
 					{
-						tokens.push_back(MakeToken(TokenType::Assign, "="));
+						Token identifier = MakeToken(TokenType::Identifier);
+						identifier.symbol = SymbolTable::Intern(identifier_or_keyword);
+						return identifier;
 					}
-					break;
 				}
-				default:
+				else
 				{
-					if (std::isdigit(curr_char))
-					{
-						// Only support basic positive integers!
-
-						std::string number_string(1, static_cast<char>(curr_char));
-
-						// TODO: use regex instead, as '0.0.0f' is passes as a valid float
-						while (Peek() && (std::isdigit(*Peek()) || *Peek() == '.'))
-						{
-							number_string += static_cast<unsigned char>(Consume());
-						}
-
-						/*
-						if (Peek() && *Peek() == 'f')
-						{
-							Consume(); // eat the 'f'
-							tokens.push_back(MakeToken(TokenType::F32, number_string));
-						}
-						else
-						{
-						*/
-						tokens.push_back(MakeToken(TokenType::I32, number_string));
-						//}
-					}
-					else if (std::isalpha(curr_char))
-					{
-						std::string identifier_or_keyword(1, static_cast<char>(curr_char));
-
-						while (Peek() && (std::isalpha(*Peek()) || std::isdigit(*Peek())))
-						{
-							identifier_or_keyword += static_cast<unsigned char>(Consume());
-						}
-
-						if (identifier_or_keyword == "return")
-						{
-							tokens.push_back(MakeToken(TokenType::Return, "return"));
-						}
-						else if (identifier_or_keyword == "if")
-						{
-							tokens.push_back(MakeToken(TokenType::If, "if"));
-						}
-						else if (identifier_or_keyword == "i32")
+					const auto EscapeChar = [](char c) -> std::string
 						{
-							tokens.push_back(MakeToken(TokenType::I32, "i32"));
-						}
-						/*
-						else if (identifier_or_keyword == "f32")
-						{
-							tokens.push_back(MakeToken(TokenType::F32, "f32"));
-						}
-						*/
-						else if (identifier_or_keyword == "mut")
-						{
-							tokens.push_back(MakeToken(TokenType::Mutable, "mut"));
-						}
-						else
-						{
-							tokens.push_back(MakeToken(TokenType::Identifier, std::move(identifier_or_keyword)));
-						}
-					}
-					else
-					{
-						const auto EscapeChar = [](char c) -> std::string
+							switch (c)
 							{
-								switch (c)
+								case '\n': return "\\n";
+								case '\r': return "\\r";
+								case '\t': return "\\t";
+								case '\0': return "\\0";
+								case '\'': return "\\'";
+								case '\"': return "\\\"";
+								case '\\': return "\\\\";
+								default:
 								{
-									case '\n': return "\\n";
-									case '\r': return "\\r";
-									case '\t': return "\\t";
-									case '\0': return "\\0";
-									case '\'': return "\\'";
-									case '\"': return "\\\"";
-									case '\\': return "\\\\";
-									default:
+									if (std::isprint(static_cast<unsigned char>(c)))
+									{
+										return std::string(1, c);
+									}
+									else
 									{
-										if (std::isprint(static_cast<unsigned char>(c)))
-										{
-											return std::string(1, c);
-										}
-										else
-										{
-											return std::format("\\x{:02x}", static_cast<unsigned char>(c)); // hex for other control chars
-										}
+										return std::format("\\x{:02x}", static_cast<unsigned char>(c)); // hex for other control chars
 									}
 								}
-							};
+							}
+						};
 
-						return std::unexpected(std::format("Unexpected character '{}'", EscapeChar(static_cast<char>(curr_char)), line, column));
-					}
+					return std::unexpected(std::format("Unexpected character '{}'", EscapeChar(static_cast<char>(curr_char))));
 				}
 			}
 		}
+	}
 
-		return tokens;
+	std::expected<TokenBuffer, ErrorMessage> Tokenise(std::string_view script)
+	{
+		TokenStream stream(script);
+		TokenBuffer tokens(script);
+
+		while (true)
+		{
+			std::expected<std::optional<Token>, ErrorMessage> token = stream.Next();
+			if (!token)
+			{
+				return std::unexpected(token.error());
+			}
+
+			if (!*token)
+			{
+				return tokens;
+			}
+
+			tokens.Push(**token);
+		}
 	}
 }
\ No newline at end of file
@@ -12,6 +12,15 @@ namespace Osprey
 		return "Type"; // TODO
 	}
 
+	std::optional<DataType> Type::GetDataType() const
+	{
+		if (const DataType* data_type = std::get_if<DataType>(&m_type))
+		{
+			return *data_type;
+		}
+		return std::nullopt;
+	}
+
 	std::optional<LabeledFunctionType> LabeledFunctionType::Create(std::vector<std::string> parameter_identifiers, FunctionType function_type)
 	{
 		if (parameter_identifiers.size() != function_type.GetParameters().size())
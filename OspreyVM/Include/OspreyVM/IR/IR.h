@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+namespace Osprey
+{
+	/*
+		OspreyIR is a typed, SSA-based intermediate representation that sits
+		between the AST and the bytecode. Every instruction that produces a
+		value is itself the SSA value, identified by its index in the owning
+		function (IRValueId). Basic blocks hold an ordered list of those ids,
+		with phi nodes first and exactly one terminator last.
+	*/
+
+	using IRValueId = uint32_t;
+	using IRBlockId = uint32_t;
+	using IRFunctionId = uint32_t;
+
+	enum class IRType : uint8_t
+	{
+		Void,
+		Bool,
+		I32,
+	};
+
+	enum class IROpCode : uint8_t
+	{
+		Const,		// immediate
+		Param,		// immediate = parameter index
+		Phi,		// operands[i] flows in from targets[i]
+		Call,		// immediate = callee function id, operands = arguments
+
+		Neg,
+		Not,
+
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Mod,
+
+		CmpLt,
+		CmpLe,
+		CmpGt,
+		CmpGe,
+		CmpEq,
+		CmpNe,
+
+		// Terminators
+		Branch,		// targets = [destination]
+		CondBranch,	// operands = [condition], targets = [if true, if false]
+		Return,		// operands = [value]
+	};
+
+	struct IRInstruction
+	{
+		IROpCode opcode = IROpCode::Const;
+		IRType type = IRType::Void;
+		IRBlockId block = 0;
+		int32_t immediate = 0;
+		std::vector<IRValueId> operands;
+		std::vector<IRBlockId> targets;
+		bool removed = false;
+	};
+
+	struct IRBasicBlock
+	{
+		std::vector<IRValueId> instructions;
+		std::vector<IRBlockId> predecessors;
+		bool removed = false;
+	};
+
+	std::string_view IROpCodeToString(IROpCode opcode);
+	std::string_view IRTypeToString(IRType type);
+
+	bool IsTerminator(IROpCode opcode);
+	bool IsUnaryOp(IROpCode opcode);
+	bool IsBinaryOp(IROpCode opcode);
+	bool IsComparison(IROpCode opcode);
+
+	// Returns whether the instruction can be removed when its value is unused
+	bool HasSideEffects(IROpCode opcode);
+
+	// Evaluates a unary or binary operation with the same semantics as the VM.
+	// Returns std::nullopt if the operation would trap at runtime (e.g. divide by zero).
+	std::optional<int32_t> EvaluateIROp(IROpCode opcode, std::span<const int32_t> operands);
+
+	class IRFunction
+	{
+	public:
+		IRFunction(std::string name, std::vector<IRType> parameter_types, IRType return_type);
+
+		const std::string& GetName() const { return m_name; }
+		const std::vector<IRType>& GetParameterTypes() const { return m_parameter_types; }
+		IRType GetReturnType() const { return m_return_type; }
+
+		IRBlockId GetEntryBlock() const { return 0; }
+		IRBlockId CreateBlock();
+
+		// Appends an instruction to the end of a block, recording CFG edges for terminators
+		IRValueId Append(IRBlockId block, IRInstruction instruction);
+		// Inserts an empty phi after any existing phis of the block
+		IRValueId InsertPhi(IRBlockId block, IRType type);
+		// Unlinks an instruction from its block. Its id stays valid but must no longer be used.
+		void Erase(IRValueId value);
+		// Moves an instruction that is neither a phi nor a terminator to the end of 'block', before its terminator
+		void MoveBeforeTerminator(IRValueId value, IRBlockId block);
+
+		void ReplaceAllUsesWith(IRValueId from, IRValueId to);
+		// Rewrites every operand through 'replacements' in a single sweep, following chains (a -> b -> c)
+		void ReplaceAllUsesWith(const std::unordered_map<IRValueId, IRValueId>& replacements);
+		// Rewrites a terminator so that it no longer targets 'target', keeping predecessor lists and phis consistent
+		void RemoveEdge(IRBlockId from, IRBlockId to);
+		// Retargets the edge 'from' -> 'through' to go to 'to' instead, which must be a successor of 'through'
+		// that 'from' does not already branch to. The phis of 'to' receive whatever would have flowed in
+		// along 'from' -> 'through' -> 'to'.
+		void RedirectEdge(IRBlockId from, IRBlockId through, IRBlockId to);
+		// Appends the instructions of 'block' to 'predecessor', which must be its only predecessor and
+		// must branch to it unconditionally. Any phis in 'block' must already have been removed.
+		void MergeIntoPredecessor(IRBlockId block);
+		// Removes blocks that cannot be reached from the entry block. Returns whether anything was removed.
+		bool RemoveUnreachableBlocks();
+
+		IRInstruction& GetInstruction(IRValueId value) { return m_instructions[value]; }
+		const IRInstruction& GetInstruction(IRValueId value) const { return m_instructions[value]; }
+		size_t GetInstructionCount() const { return m_instructions.size(); }
+
+		IRBasicBlock& GetBlock(IRBlockId block) { return m_blocks[block]; }
+		const IRBasicBlock& GetBlock(IRBlockId block) const { return m_blocks[block]; }
+		size_t GetBlockCount() const { return m_blocks.size(); }
+
+		std::optional<IRValueId> GetTerminator(IRBlockId block) const;
+		std::vector<IRBlockId> GetSuccessors(IRBlockId block) const;
+
+		// Live blocks ordered so that every block comes after its dominators
+		std::vector<IRBlockId> ComputeReversePostOrder() const;
+		// Immediate dominator of each live block, indexed by block id. The entry block
+		// is its own immediate dominator and removed or unreachable blocks map to std::nullopt.
+		std::vector<std::optional<IRBlockId>> ComputeImmediateDominators() const;
+		// Number of operand references to each value
+		std::vector<uint32_t> ComputeUseCounts() const;
+
+		bool Verify() const;
+		void Dump() const;
+
+	private:
+		std::string m_name;
+		std::vector<IRType> m_parameter_types;
+		IRType m_return_type;
+
+		std::vector<IRInstruction> m_instructions;
+		std::vector<IRBasicBlock> m_blocks;
+	};
+
+	// As above, but division by a non-zero constant cannot trap, so it is removable too
+	bool HasSideEffects(const IRFunction& function, const IRInstruction& instruction);
+
+	class IRModule
+	{
+	public:
+		IRFunctionId AddFunction(IRFunction function);
+		std::optional<IRFunctionId> FindFunction(std::string_view name) const;
+		// Removes every function whose entry in 'keep' is false, renumbering the
+		// callees of the remaining call instructions
+		void RemoveFunctions(const std::vector<bool>& keep);
+
+		IRFunction& GetFunction(IRFunctionId function) { return m_functions[function]; }
+		const IRFunction& GetFunction(IRFunctionId function) const { return m_functions[function]; }
+
+		std::vector<IRFunction>& GetFunctions() { return m_functions; }
+		const std::vector<IRFunction>& GetFunctions() const { return m_functions; }
+
+		bool Verify() const;
+		void Dump() const;
+
+	private:
+		std::vector<IRFunction> m_functions;
+	};
+}
\ No newline at end of file
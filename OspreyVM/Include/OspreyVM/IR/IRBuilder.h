@@ -0,0 +1,13 @@
+#pragma once
+
+#include "OspreyVM/IR/IR.h"
+
+#include <optional>
+
+namespace Osprey
+{
+	class AST;
+
+	// Lowers the AST into SSA form. Errors are reported in the same way as Compile.
+	std::optional<IRModule> BuildIR(const AST& ast);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "OspreyVM/IR/IR.h"
+
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace Osprey
+{
+	class VMProgram;
+	class VMProfile;
+
+	// Lowers an IRModule to bytecode for the stack VM
+	std::optional<VMProgram> GenerateProgram(const IRModule& module);
+
+	// As above, but lays the program out using 'profile', collected by running the program
+	// generated from the same module without one. Functions are ordered by call affinity,
+	// each block falls through to its hottest successor, and blocks that never ran are
+	// moved to the end of the program.
+	std::optional<VMProgram> GenerateProgram(const IRModule& module, const VMProfile& profile);
+
+	class IRCodeGen;
+
+	/*
+		Runs functions of a module at compile time. A function is generated the first time
+		a call can reach it and kept for later calls, each of which runs from an entry stub
+		that is appended to the bytecode and removed again afterwards.
+	*/
+	class IREvaluator
+	{
+	public:
+		explicit IREvaluator(const IRModule& module);
+		~IREvaluator();
+
+		// Calls 'function' with 'arguments' for at most 'fuel' backward jumps, returning its
+		// result if it halts. 'fuel' is left holding what the call did not use.
+		std::optional<int32_t> Evaluate(IRFunctionId function, std::span<const int32_t> arguments, size_t& fuel);
+
+	private:
+		std::unique_ptr<IRCodeGen> m_codegen;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "OspreyVM/IR/IR.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace Osprey
+{
+	struct VMCompileOptions;
+
+	/*
+		A transformation over an IRModule. Most passes work on one function
+		at a time and only need to override RunOnFunction, passes that look
+		across functions (e.g. call graph analysis) override Run instead.
+	*/
+	class IRPass
+	{
+	public:
+		virtual ~IRPass() = default;
+
+		virtual std::string_view GetName() const = 0;
+
+		// Returns whether the module was modified
+		virtual bool Run(IRModule& module);
+
+	protected:
+		virtual bool RunOnFunction(IRFunction&) { return false; }
+	};
+
+	class IRPassManager
+	{
+	public:
+		void AddPass(std::unique_ptr<IRPass> pass);
+
+		// Runs the passes in order, repeating the whole pipeline until
+		// no pass reports a change or the iteration limit is reached.
+		void Run(IRModule& module) const;
+
+		void SetMaxIterations(size_t max_iterations) { m_max_iterations = max_iterations; }
+		void SetVerbose(bool verbose) { m_verbose = verbose; }
+
+		// The pipeline used by Compile when optimisations are enabled
+		static IRPassManager CreateDefaultPipeline(const VMCompileOptions& options);
+
+	private:
+		std::vector<std::unique_ptr<IRPass>> m_passes;
+		size_t m_max_iterations = 4;
+		bool m_verbose = false;
+	};
+}
\ No newline at end of file
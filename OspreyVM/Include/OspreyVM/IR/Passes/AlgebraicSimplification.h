@@ -0,0 +1,21 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Rewrites operations using algebraic identities, e.g. 'x + 0' and 'x * 1'
+		become 'x', 'x * 0' and 'x - x' become '0', and 'x * -1' becomes '-x'.
+		Only applies where the result is the same for every input, including
+		wrapping on overflow and division by zero.
+	*/
+	class AlgebraicSimplificationPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "algebraic-simplification"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+#include <map>
+#include <string>
+#include <utility>
+
+namespace Osprey
+{
+	/*
+		Replaces calls whose arguments are all constants with the callee's result,
+		found by running the callee in a VM limited to 'fuel' backward jumps, and to
+		'budget' for every call the pass evaluates across all of its runs.
+
+		IR functions cannot read or write anything outside of their own frame, so
+		every function is pure and only the arguments affect the result. Calls that
+		trap or run out of fuel are kept for the VM to report, or loop, at runtime.
+	*/
+	class CallEvaluationPass : public IRPass
+	{
+	public:
+		CallEvaluationPass(size_t fuel, size_t budget)
+			: m_fuel(fuel)
+			, m_budget(budget)
+		{
+		}
+
+		std::string_view GetName() const override { return "call-evaluation"; }
+
+		bool Run(IRModule& module) override;
+
+	private:
+		size_t m_fuel;
+		size_t m_budget;
+
+		// Results by callee and arguments, including failed evaluations, so that
+		// later iterations of the pipeline do not evaluate the same call again
+		std::map<std::pair<std::string, std::vector<int32_t>>, std::optional<int32_t>> m_results;
+	};
+}
\ No newline at end of file
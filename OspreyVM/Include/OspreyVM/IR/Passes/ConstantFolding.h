@@ -0,0 +1,20 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Evaluates operations whose operands are all constants, collapses phis
+		whose inputs are all the same value, and turns conditional branches on
+		a constant into unconditional ones (removing blocks that become unreachable).
+	*/
+	class ConstantFoldingPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "constant-folding"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+}
\ No newline at end of file
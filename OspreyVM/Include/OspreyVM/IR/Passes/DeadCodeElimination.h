@@ -0,0 +1,31 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Removes instructions whose values never reach a side effect (a call,
+		a division that may trap, or a terminator), including cycles of phis
+		that only feed each other.
+	*/
+	class DeadCodeEliminationPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "dead-code-elimination"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+
+	/*
+		Removes functions that cannot be reached through the call graph from 'main'.
+	*/
+	class DeadFunctionEliminationPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "dead-function-elimination"; }
+
+		bool Run(IRModule& module) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Walks the dominator tree and replaces an instruction with an earlier,
+		equivalent one that dominates it, so each distinct pure computation is
+		evaluated once per path (e.g. the second 'a * b' in '(a * b) + (a * b)').
+		Operands of commutative operations are put in a canonical order first.
+	*/
+	class GlobalValueNumberingPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "global-value-numbering"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Simplifies the control flow graph:
+		- Edges into a block that only forwards control (phis and a branch) are
+		  retargeted past it. When the block branches on one of its own phis and
+		  that phi is a constant along an incoming edge, the edge goes straight to
+		  the side the constant selects. This is what removes the boolean that
+		  '&&' and '||' would otherwise materialise when used as a condition.
+		- A block whose only predecessor unconditionally branches to it is merged
+		  into that predecessor.
+	*/
+	class JumpThreadingPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "jump-threading"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "OspreyVM/IR/IRPass.h"
+
+namespace Osprey
+{
+	/*
+		Finds natural loops from the back edges of the dominator tree and moves
+		instructions whose operands are all defined outside a loop into its
+		preheader, so they are evaluated once rather than on every iteration.
+		Only operations that cannot trap are hoisted, as the loop may not run.
+	*/
+	class LoopInvariantCodeMotionPass : public IRPass
+	{
+	public:
+		std::string_view GetName() const override { return "loop-invariant-code-motion"; }
+
+	protected:
+		bool RunOnFunction(IRFunction& function) override;
+	};
+}
\ No newline at end of file
@@ -3,31 +3,69 @@
 #include "OspreyVM/VMProgram.h"
 #include "OspreyVM/VMStack.h"
 #include "OspreyVM/VMMemory.h"
+#include "OspreyVM/VMProfile.h"
 
 #include <optional>
 #include <memory>
+#include <string>
 
 namespace Osprey
 {
+	enum class VMStatus
+	{
+		Running,
+		Halted,
+		Trapped,
+		// Ran out of fuel, Execute resumes from where it stopped
+		Suspended,
+	};
+
 	class VM
 	{
 	public:
-		static std::optional<VM> Load(VMProgram program);
+		// Execution begins at 'entry_offset', the start of the program unless
+		// the caller has appended its own entry point
+		static std::optional<VM> Load(VMProgram program, size_t entry_offset = 0);
 
+		// Runs until the program halts or traps
 		void Execute();
+		// Runs until at most 'fuel' backward jumps have been taken, for code that may never
+		// halt. Every loop iteration and recursive call jumps backwards, so only those edges
+		// pay for the check. Returns VMStatus::Suspended if the fuel ran out first, and traps
+		// if execution leaves the program.
+		VMStatus Execute(size_t fuel);
 		void Step();
 
+		// Backward jumps left of the fuel given to the last bounded Execute
+		size_t GetRemainingFuel() const;
+
+		VMStatus GetStatus() const;
+
+		// Records how often each branch is taken, and each jump runs, into 'profile'
+		// until it is reset to null. The profile must outlive its use by the VM.
+		void SetProfile(VMProfile* profile);
+
 		const VMProgram& GetProgram() const;
+		// Hands the program back, e.g. to append another entry point and load it again
+		VMProgram TakeProgram();
 		const VMStack& GetStack() const;
 		const VMMemory& GetMemory() const;
 
 	private:
-		VM(VMProgram program);
+		VM(VMProgram program, size_t entry_offset);
+
+		void Trap(std::string message);
+		void JumpIf(size_t instruction_offset, int32_t target_offset, bool condition);
+		void ConsumeFuel();
 
 		VMProgram m_program;
 		VMStack m_stack;
 		VMMemory m_memory;
 		size_t m_instruction_offset;
-		bool is_running = true;
+		VMStatus m_status = VMStatus::Running;
+		std::string m_trap_message;
+		VMProfile* m_profile = nullptr;
+		// Backward jumps left before suspending, or empty when running unbounded
+		std::optional<size_t> m_fuel;
 	};
 }
\ No newline at end of file
@@ -1,11 +1,62 @@
 #pragma once
 
 #include <optional>
+#include <cstddef>
+#include <memory>
 
 namespace Osprey
 {
 	class VMProgram;
+	class VMProfile;
 	class AST;
 
-	std::optional<VMProgram> Compile(const AST& ast);
+	struct VMCompileOptions
+	{
+		// Compile through the SSA IR and run the optimisation passes over it,
+		// rather than emitting bytecode directly from the AST
+		bool optimise = false;
+
+		// Calls to pure functions with constant arguments are evaluated at compile time by
+		// running them for at most this many backward jumps (loop iterations and recursive
+		// calls), or never if it is zero
+		size_t evaluation_fuel = 100'000;
+
+		// The backward jumps that every evaluation of a compile may take together. Calls
+		// still to be evaluated once it is spent are left to run at runtime.
+		size_t evaluation_budget = 10'000'000;
+
+		// Threads to compile function bodies on when not optimising, or 0 for one per hardware thread
+		size_t thread_count = 0;
+
+		// Counts from running the program compiled with the same options but no profile, used
+		// to lay out the optimised program for locality. Ignored when not optimising.
+		const VMProfile* profile = nullptr;
+	};
+
+	std::optional<VMProgram> Compile(const AST& ast, const VMCompileOptions& options = {});
+
+	class VMFunctionCache;
+
+	/*
+		Compiles successive versions of a program, keeping the relocatable bytecode of
+		each function between compiles. Only functions whose AST, or whose folded calls,
+		have changed are compiled again before the program is relinked. The IR pipeline
+		is not incremental, so with 'optimise' set every compile starts from scratch.
+	*/
+	class VMIncrementalCompiler
+	{
+	public:
+		VMIncrementalCompiler(const VMCompileOptions& options = {});
+		~VMIncrementalCompiler();
+
+		std::optional<VMProgram> Compile(const AST& ast);
+
+		// How many function bodies the last Compile compiled, and how many it reused
+		size_t GetCompiledFunctionCount() const;
+		size_t GetReusedFunctionCount() const;
+
+	private:
+		VMCompileOptions m_options;
+		std::unique_ptr<VMFunctionCache> m_cache;
+	};
 }
\ No newline at end of file
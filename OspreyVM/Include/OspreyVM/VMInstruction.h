@@ -0,0 +1,217 @@
+#pragma once
+
+#include "OspreyVM/VMOpCode.h"
+
+#include <cstdint>
+#include <optional>
+
+namespace Osprey
+{
+	struct VMInstructionHandle
+	{
+		int32_t opcode_offset = 0;
+		std::optional<int32_t> operand_offset;
+	};
+
+	/*
+		A single bytecode instruction together with the effect it has on
+		the size of the data stack. Shared by every code generator that
+		emits OspreyVM bytecode.
+	*/
+	class VMInstruction
+	{
+	public:
+		static VMInstruction PUSH(int32_t value)
+		{
+			return VMInstruction(VMOpCode::PUSH, value, 1);
+		}
+
+		static VMInstruction DUP(int32_t offset)
+		{
+			return VMInstruction(VMOpCode::DUP, offset, 1);
+		}
+
+		static VMInstruction NOT()
+		{
+			return VMInstruction(VMOpCode::NOT, std::nullopt, 0);
+		}
+
+		static VMInstruction NEGATE()
+		{
+			return VMInstruction(VMOpCode::NEGATE, std::nullopt, 0);
+		}
+
+		static VMInstruction ADD()
+		{
+			return VMInstruction(VMOpCode::ADD, std::nullopt, -1);
+		}
+
+		static VMInstruction SUB()
+		{
+			return VMInstruction(VMOpCode::SUB, std::nullopt, -1);
+		}
+
+		static VMInstruction MUL()
+		{
+			return VMInstruction(VMOpCode::MUL, std::nullopt, -1);
+		}
+
+		static VMInstruction DIV()
+		{
+			return VMInstruction(VMOpCode::DIV, std::nullopt, -1);
+		}
+
+		static VMInstruction MOD()
+		{
+			return VMInstruction(VMOpCode::MOD, std::nullopt, -1);
+		}
+
+		static VMInstruction LT()
+		{
+			return VMInstruction(VMOpCode::LT, std::nullopt, -1);
+		}
+
+		static VMInstruction LE()
+		{
+			return VMInstruction(VMOpCode::LE, std::nullopt, -1);
+		}
+
+		static VMInstruction GT()
+		{
+			return VMInstruction(VMOpCode::GT, std::nullopt, -1);
+		}
+
+		static VMInstruction GE()
+		{
+			return VMInstruction(VMOpCode::GE, std::nullopt, -1);
+		}
+
+		static VMInstruction EQ()
+		{
+			return VMInstruction(VMOpCode::EQ, std::nullopt, -1);
+		}
+
+		static VMInstruction NE()
+		{
+			return VMInstruction(VMOpCode::NE, std::nullopt, -1);
+		}
+
+		static VMInstruction SWAP(int32_t offset)
+		{
+			return VMInstruction(VMOpCode::SWAP, offset, 0);
+		}
+
+		static VMInstruction POP(int32_t count)
+		{
+			return VMInstruction(VMOpCode::POP, count, -count);
+		}
+
+		static VMInstruction JZ(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JZ, address, -1);
+		}
+
+		static VMInstruction JMP()
+		{
+			return VMInstruction(VMOpCode::JMP, std::nullopt, -1);
+		}
+
+		static VMInstruction JLT(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JLT, address, -2);
+		}
+
+		static VMInstruction JLE(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JLE, address, -2);
+		}
+
+		static VMInstruction JGT(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JGT, address, -2);
+		}
+
+		static VMInstruction JGE(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JGE, address, -2);
+		}
+
+		static VMInstruction JEQ(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JEQ, address, -2);
+		}
+
+		static VMInstruction JNE(int32_t address)
+		{
+			return VMInstruction(VMOpCode::JNE, address, -2);
+		}
+
+		static VMInstruction FORPREP(int32_t address)
+		{
+			return VMInstruction(VMOpCode::FORPREP, address, 0);
+		}
+
+		static VMInstruction FORLOOP(int32_t address)
+		{
+			return VMInstruction(VMOpCode::FORLOOP, address, 0);
+		}
+
+		// Must be followed by the table itself, see VMOpCode::JTABLE
+		static VMInstruction JTABLE(int32_t entry_count)
+		{
+			return VMInstruction(VMOpCode::JTABLE, entry_count, 0);
+		}
+
+		// The fused compare-and-branch equivalent of a comparison opcode (e.g. LT => JLT),
+		// jumping when the comparison holds
+		static std::optional<VMInstruction> JumpIf(VMOpCode comparison, int32_t address)
+		{
+			switch (comparison)
+			{
+				case VMOpCode::LT: return JLT(address);
+				case VMOpCode::LE: return JLE(address);
+				case VMOpCode::GT: return JGT(address);
+				case VMOpCode::GE: return JGE(address);
+				case VMOpCode::EQ: return JEQ(address);
+				case VMOpCode::NE: return JNE(address);
+				default: return std::nullopt;
+			}
+		}
+
+		// As JumpIf, but jumping when the comparison does not hold (e.g. LT => JGE)
+		static std::optional<VMInstruction> JumpIfNot(VMOpCode comparison, int32_t address)
+		{
+			switch (comparison)
+			{
+				case VMOpCode::LT: return JGE(address);
+				case VMOpCode::LE: return JGT(address);
+				case VMOpCode::GT: return JLE(address);
+				case VMOpCode::GE: return JLT(address);
+				case VMOpCode::EQ: return JNE(address);
+				case VMOpCode::NE: return JEQ(address);
+				default: return std::nullopt;
+			}
+		}
+
+		static VMInstruction HALT()
+		{
+			return VMInstruction(VMOpCode::HALT, std::nullopt, 0);
+		}
+
+		VMOpCode GetOpcode() const { return m_opcode; }
+		std::optional<int32_t> GetOperand() const { return m_operand; }
+		int32_t GetScopeSizeDelta() const { return m_scope_size_delta; }
+
+	private:
+		VMInstruction(VMOpCode opcode, std::optional<int32_t> operand, int32_t scope_size_delta)
+			: m_opcode(opcode)
+			, m_operand(operand)
+			, m_scope_size_delta(scope_size_delta)
+		{
+		}
+
+		VMOpCode m_opcode;
+		std::optional<int32_t> m_operand;
+		int32_t m_scope_size_delta;
+	};
+}
\ No newline at end of file
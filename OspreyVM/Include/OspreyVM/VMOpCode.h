@@ -21,6 +21,30 @@ namespace Osprey
 		HALT,
 		SWAP,
 		DUP,
+		SUB,
+		DIV,
+		MOD,
+		LE,
+		GT,
+		GE,
+		EQ,
+		NE,
+		// Pop right then left and jump to the operand if 'left <op> right'
+		JLT,
+		JLE,
+		JGT,
+		JGE,
+		JEQ,
+		JNE,
+		// Counted loops over [..., counter, limit] on top of the stack. FORPREP jumps to the
+		// operand unless 'counter < limit'. FORLOOP increments the counter and jumps to the
+		// operand if it is still less than the limit. Neither pops anything.
+		FORPREP,
+		FORLOOP,
+		// Jump table on the value on top of the stack, which is left in place. The operand is
+		// the number of entries, followed inline by the lowest value, the default target and
+		// the target of each value from the lowest upwards.
+		JTABLE,
 	};
 
 	inline static std::string OpCodeToString(VMOpCode opcode)
@@ -55,7 +79,69 @@ namespace Osprey
 			return "SWAP";
 		case VMOpCode::DUP:
 			return "DUP";
+		case VMOpCode::SUB:
+			return "SUB";
+		case VMOpCode::DIV:
+			return "DIV";
+		case VMOpCode::MOD:
+			return "MOD";
+		case VMOpCode::LE:
+			return "LE";
+		case VMOpCode::GT:
+			return "GT";
+		case VMOpCode::GE:
+			return "GE";
+		case VMOpCode::EQ:
+			return "EQ";
+		case VMOpCode::NE:
+			return "NE";
+		case VMOpCode::JLT:
+			return "JLT";
+		case VMOpCode::JLE:
+			return "JLE";
+		case VMOpCode::JGT:
+			return "JGT";
+		case VMOpCode::JGE:
+			return "JGE";
+		case VMOpCode::JEQ:
+			return "JEQ";
+		case VMOpCode::JNE:
+			return "JNE";
+		case VMOpCode::FORPREP:
+			return "FORPREP";
+		case VMOpCode::FORLOOP:
+			return "FORLOOP";
+		case VMOpCode::JTABLE:
+			return "JTABLE";
 		}
 		return "<Unknown OpCode>";
 	}
+
+	// Returns the number of operands that follow the opcode in the bytecode, not counting
+	// the inline table of a JTABLE
+	inline static int32_t OpCodeOperandCount(VMOpCode opcode)
+	{
+		switch (opcode)
+		{
+		case VMOpCode::PUSH:
+		case VMOpCode::POP:
+		case VMOpCode::LOAD:
+		case VMOpCode::STORE:
+		case VMOpCode::JZ:
+		case VMOpCode::SWAP:
+		case VMOpCode::DUP:
+		case VMOpCode::JLT:
+		case VMOpCode::JLE:
+		case VMOpCode::JGT:
+		case VMOpCode::JGE:
+		case VMOpCode::JEQ:
+		case VMOpCode::JNE:
+		case VMOpCode::FORPREP:
+		case VMOpCode::FORLOOP:
+		case VMOpCode::JTABLE:
+			return 1;
+		default:
+			return 0;
+		}
+	}
 }
\ No newline at end of file
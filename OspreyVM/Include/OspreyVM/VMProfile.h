@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+namespace Osprey
+{
+	struct VMBranchCounts
+	{
+		uint64_t taken = 0;
+		uint64_t not_taken = 0;
+	};
+
+	/*
+		Execution counts recorded by a VM with profiling enabled, keyed by the offset of
+		the instruction that ran. Conditional jumps record how often they were taken, and
+		JMPs, which make calls and returns, how often they ran.
+	*/
+	class VMProfile
+	{
+	public:
+		void RecordBranch(size_t instruction_offset, bool taken);
+		void RecordJump(size_t instruction_offset);
+
+		VMBranchCounts GetBranchCounts(size_t instruction_offset) const;
+		uint64_t GetJumpCount(size_t instruction_offset) const;
+
+	private:
+		std::unordered_map<size_t, VMBranchCounts> m_branches;
+		std::unordered_map<size_t, uint64_t> m_jumps;
+	};
+}
\ No newline at end of file
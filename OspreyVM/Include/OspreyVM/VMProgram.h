@@ -1,15 +1,29 @@
 #pragma once
 
 #include <vector>
+#include <span>
+#include <cstdint>
 
 namespace Osprey
 {
+	/*
+	* Owns the bytecode of a compiled program. It can only be moved, so the
+	* instructions are allocated once by the compiler and handed on to the VM.
+	*/
 	class VMProgram
 	{
 	public:
-		VMProgram(std::vector<int32_t> in_program);
+		explicit VMProgram(std::vector<int32_t> in_program);
 
-		int32_t GetInstruction(size_t offset);
+		VMProgram(const VMProgram&) = delete;
+		VMProgram& operator=(const VMProgram&) = delete;
+		VMProgram(VMProgram&&) = default;
+		VMProgram& operator=(VMProgram&&) = default;
+
+		int32_t GetInstruction(size_t offset) const { return m_program[offset]; }
+		std::span<const int32_t> GetInstructions() const { return m_program; }
+		// Hands the instructions back, leaving the program empty
+		std::vector<int32_t> TakeInstructions() { return std::move(m_program); }
 
 		void Dump() const;
 
@@ -1,11 +1,19 @@
 #pragma once
 
-#include <string>
+#include "OspreyAST/Symbol.h"
+
 #include <vector>
 #include <optional>
+#include <unordered_map>
 
 namespace Osprey
 {
+	/*
+	* Tracks which stack slot each variable lives in while compiling. Bindings are
+	* keyed by interned symbol and the stack size is kept as a running total, so
+	* lookups and binds are constant time and exiting a block only touches the
+	* variables it declared.
+	*/
 	class VMStackBindings
 	{
 	public:
@@ -14,29 +22,50 @@ namespace Osprey
 
 		void ApplyOffset(int32_t delta);
 
-		bool BindToVariable(std::string variable);
+		// Binds the variable to the value 'offset_from_top' entries below the top of the stack,
+		// which is either the value just pushed or a slot returned by TakeFreeSlot
+		bool BindToVariable(SymbolId variable, int32_t offset_from_top = 0);
+
+		// Releases the slot of a variable that will not be used again. The name stays
+		// declared until its block exits, but the slot can be reused or popped.
+		bool ReleaseVariable(SymbolId variable);
+
+		// Takes the released slot nearest the top of the stack, returning its offset from the top
+		std::optional<int32_t> TakeFreeSlot();
+
+		// Takes the released slots of the current block that sit on top of the stack,
+		// returning how many there are for the caller to pop
+		int32_t TakeFreeSlotsAtTop();
 
 		int32_t GetStackSize() const;
 		int32_t GetTopStackSize() const;
 
-		std::optional<int32_t> GetBindingOffsetFromTop(std::string_view variable) const;
+		std::optional<int32_t> GetBindingOffsetFromTop(SymbolId variable) const;
 
 	private:
 		struct Binding
 		{
-			Binding(std::string in_identifier, int32_t in_bottom_offset, int32_t in_owning_block)
-				: identifier(in_identifier)
-				, bottom_offset(in_bottom_offset)
-				, owning_block(in_owning_block)
-			{
-			}
-
-			std::string identifier;
 			int32_t bottom_offset = 0;
+			// The block that declared the variable, and the block whose stack region holds its slot
 			int32_t owning_block = 0;
+			int32_t slot_block = 0;
+			bool released = false;
 		};
 
-		std::vector<int32_t> m_block_sizes;
-		std::vector<Binding> m_bindings;
+		struct Block
+		{
+			int32_t bottom_offset = 0;
+			int32_t size = 0;
+			std::vector<SymbolId> variables;
+			// Max-heap of the bottom offsets of released slots in this block's region
+			std::vector<int32_t> free_slots;
+		};
+
+		int32_t FindSlotBlock(int32_t bottom_offset) const;
+		void FreeSlot(int32_t block, int32_t bottom_offset);
+
+		std::vector<Block> m_blocks;
+		std::unordered_map<SymbolId, Binding> m_bindings;
+		int32_t m_stack_size = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,865 @@
+#include "OspreyVM/IR/IR.h"
+
+#include <algorithm>
+#include <cassert>
+#include <print>
+
+namespace Osprey
+{
+	std::string_view IROpCodeToString(IROpCode opcode)
+	{
+		switch (opcode)
+		{
+			case IROpCode::Const: return "const";
+			case IROpCode::Param: return "param";
+			case IROpCode::Phi: return "phi";
+			case IROpCode::Call: return "call";
+			case IROpCode::Neg: return "neg";
+			case IROpCode::Not: return "not";
+			case IROpCode::Add: return "add";
+			case IROpCode::Sub: return "sub";
+			case IROpCode::Mul: return "mul";
+			case IROpCode::Div: return "div";
+			case IROpCode::Mod: return "mod";
+			case IROpCode::CmpLt: return "cmp.lt";
+			case IROpCode::CmpLe: return "cmp.le";
+			case IROpCode::CmpGt: return "cmp.gt";
+			case IROpCode::CmpGe: return "cmp.ge";
+			case IROpCode::CmpEq: return "cmp.eq";
+			case IROpCode::CmpNe: return "cmp.ne";
+			case IROpCode::Branch: return "br";
+			case IROpCode::CondBranch: return "condbr";
+			case IROpCode::Return: return "ret";
+		}
+		return "<unknown>";
+	}
+
+	std::string_view IRTypeToString(IRType type)
+	{
+		switch (type)
+		{
+			case IRType::Void: return "void";
+			case IRType::Bool: return "bool";
+			case IRType::I32: return "i32";
+		}
+		return "<unknown>";
+	}
+
+	bool IsTerminator(IROpCode opcode)
+	{
+		return opcode == IROpCode::Branch || opcode == IROpCode::CondBranch || opcode == IROpCode::Return;
+	}
+
+	bool IsUnaryOp(IROpCode opcode)
+	{
+		return opcode == IROpCode::Neg || opcode == IROpCode::Not;
+	}
+
+	bool IsBinaryOp(IROpCode opcode)
+	{
+		return opcode >= IROpCode::Add && opcode <= IROpCode::CmpNe;
+	}
+
+	bool IsComparison(IROpCode opcode)
+	{
+		return opcode >= IROpCode::CmpLt && opcode <= IROpCode::CmpNe;
+	}
+
+	bool HasSideEffects(IROpCode opcode)
+	{
+		// Calls may not terminate, and division may trap, so neither can be
+		// dropped just because the result is unused.
+		return opcode == IROpCode::Call
+			|| opcode == IROpCode::Div
+			|| opcode == IROpCode::Mod
+			|| IsTerminator(opcode);
+	}
+
+	bool HasSideEffects(const IRFunction& function, const IRInstruction& instruction)
+	{
+		if (instruction.opcode == IROpCode::Div || instruction.opcode == IROpCode::Mod)
+		{
+			const IRInstruction& divisor = function.GetInstruction(instruction.operands[1]);
+			return divisor.opcode != IROpCode::Const || divisor.immediate == 0;
+		}
+
+		return HasSideEffects(instruction.opcode);
+	}
+
+	std::optional<int32_t> EvaluateIROp(IROpCode opcode, std::span<const int32_t> operands)
+	{
+		if (IsUnaryOp(opcode))
+		{
+			assert(operands.size() == 1);
+			const int32_t value = operands[0];
+
+			switch (opcode)
+			{
+				case IROpCode::Neg: return static_cast<int32_t>(0u - static_cast<uint32_t>(value));
+				case IROpCode::Not: return value == 0 ? 1 : 0;
+				default: return std::nullopt;
+			}
+		}
+
+		if (!IsBinaryOp(opcode))
+		{
+			return std::nullopt;
+		}
+
+		assert(operands.size() == 2);
+		const int32_t left = operands[0];
+		const int32_t right = operands[1];
+
+		// Arithmetic wraps on overflow, matching the VM
+		const uint32_t uleft = static_cast<uint32_t>(left);
+		const uint32_t uright = static_cast<uint32_t>(right);
+
+		switch (opcode)
+		{
+			case IROpCode::Add: return static_cast<int32_t>(uleft + uright);
+			case IROpCode::Sub: return static_cast<int32_t>(uleft - uright);
+			case IROpCode::Mul: return static_cast<int32_t>(uleft * uright);
+			case IROpCode::Div:
+			{
+				if (right == 0)
+				{
+					return std::nullopt;
+				}
+				return static_cast<int32_t>(static_cast<int64_t>(left) / right);
+			}
+			case IROpCode::Mod:
+			{
+				if (right == 0)
+				{
+					return std::nullopt;
+				}
+				return static_cast<int32_t>(static_cast<int64_t>(left) % right);
+			}
+			case IROpCode::CmpLt: return left < right ? 1 : 0;
+			case IROpCode::CmpLe: return left <= right ? 1 : 0;
+			case IROpCode::CmpGt: return left > right ? 1 : 0;
+			case IROpCode::CmpGe: return left >= right ? 1 : 0;
+			case IROpCode::CmpEq: return left == right ? 1 : 0;
+			case IROpCode::CmpNe: return left != right ? 1 : 0;
+			default: return std::nullopt;
+		}
+	}
+
+	IRFunction::IRFunction(std::string name, std::vector<IRType> parameter_types, IRType return_type)
+		: m_name(std::move(name))
+		, m_parameter_types(std::move(parameter_types))
+		, m_return_type(return_type)
+	{
+		CreateBlock(); // entry
+	}
+
+	IRBlockId IRFunction::CreateBlock()
+	{
+		m_blocks.emplace_back();
+		return static_cast<IRBlockId>(m_blocks.size() - 1);
+	}
+
+	IRValueId IRFunction::Append(IRBlockId block, IRInstruction instruction)
+	{
+		assert(!m_blocks[block].removed);
+		assert(!GetTerminator(block).has_value());
+
+		instruction.block = block;
+
+		const IRValueId value = static_cast<IRValueId>(m_instructions.size());
+
+		if (IsTerminator(instruction.opcode))
+		{
+			for (const IRBlockId target : instruction.targets)
+			{
+				std::vector<IRBlockId>& predecessors = m_blocks[target].predecessors;
+				if (std::ranges::find(predecessors, block) == predecessors.end())
+				{
+					predecessors.push_back(block);
+				}
+			}
+		}
+
+		m_instructions.push_back(std::move(instruction));
+		m_blocks[block].instructions.push_back(value);
+
+		return value;
+	}
+
+	IRValueId IRFunction::InsertPhi(IRBlockId block, IRType type)
+	{
+		IRInstruction phi;
+		phi.opcode = IROpCode::Phi;
+		phi.type = type;
+		phi.block = block;
+
+		const IRValueId value = static_cast<IRValueId>(m_instructions.size());
+		m_instructions.push_back(std::move(phi));
+
+		std::vector<IRValueId>& instructions = m_blocks[block].instructions;
+		auto insert_position = std::ranges::find_if(instructions, [this](IRValueId id) { return m_instructions[id].opcode != IROpCode::Phi; });
+		instructions.insert(insert_position, value);
+
+		return value;
+	}
+
+	void IRFunction::Erase(IRValueId value)
+	{
+		IRInstruction& instruction = m_instructions[value];
+		assert(!instruction.removed);
+
+		std::vector<IRValueId>& instructions = m_blocks[instruction.block].instructions;
+		instructions.erase(std::ranges::find(instructions, value));
+
+		if (IsTerminator(instruction.opcode))
+		{
+			for (const IRBlockId target : instruction.targets)
+			{
+				std::vector<IRBlockId>& predecessors = m_blocks[target].predecessors;
+				auto found = std::ranges::find(predecessors, instruction.block);
+				if (found != predecessors.end())
+				{
+					predecessors.erase(found);
+				}
+			}
+		}
+
+		instruction.removed = true;
+		instruction.operands.clear();
+		instruction.targets.clear();
+	}
+
+	void IRFunction::MoveBeforeTerminator(IRValueId value, IRBlockId block)
+	{
+		IRInstruction& instruction = m_instructions[value];
+		assert(!instruction.removed && instruction.opcode != IROpCode::Phi && !IsTerminator(instruction.opcode));
+
+		std::vector<IRValueId>& from_instructions = m_blocks[instruction.block].instructions;
+		from_instructions.erase(std::ranges::find(from_instructions, value));
+
+		std::vector<IRValueId>& to_instructions = m_blocks[block].instructions;
+		to_instructions.insert(GetTerminator(block) ? to_instructions.end() - 1 : to_instructions.end(), value);
+
+		instruction.block = block;
+	}
+
+	void IRFunction::ReplaceAllUsesWith(IRValueId from, IRValueId to)
+	{
+		assert(from != to);
+
+		for (IRInstruction& instruction : m_instructions)
+		{
+			if (instruction.removed)
+			{
+				continue;
+			}
+
+			for (IRValueId& operand : instruction.operands)
+			{
+				if (operand == from)
+				{
+					operand = to;
+				}
+			}
+		}
+	}
+
+	void IRFunction::ReplaceAllUsesWith(const std::unordered_map<IRValueId, IRValueId>& replacements)
+	{
+		if (replacements.empty())
+		{
+			return;
+		}
+
+		const auto Resolve = [&replacements](IRValueId value)
+			{
+				for (auto found = replacements.find(value); found != replacements.end(); found = replacements.find(value))
+				{
+					value = found->second;
+				}
+				return value;
+			};
+
+		for (IRInstruction& instruction : m_instructions)
+		{
+			if (instruction.removed)
+			{
+				continue;
+			}
+
+			for (IRValueId& operand : instruction.operands)
+			{
+				operand = Resolve(operand);
+			}
+		}
+	}
+
+	void IRFunction::RemoveEdge(IRBlockId from, IRBlockId to)
+	{
+		const std::optional<IRValueId> terminator_id = GetTerminator(from);
+		assert(terminator_id);
+
+		IRInstruction& terminator = m_instructions[*terminator_id];
+		assert(terminator.opcode == IROpCode::CondBranch);
+		assert(terminator.targets[0] != terminator.targets[1]);
+
+		const IRBlockId remaining = terminator.targets[0] == to ? terminator.targets[1] : terminator.targets[0];
+		terminator.opcode = IROpCode::Branch;
+		terminator.operands.clear();
+		terminator.targets = { remaining };
+
+		std::vector<IRBlockId>& predecessors = m_blocks[to].predecessors;
+		predecessors.erase(std::ranges::find(predecessors, from));
+
+		for (const IRValueId value : m_blocks[to].instructions)
+		{
+			IRInstruction& phi = m_instructions[value];
+			if (phi.opcode != IROpCode::Phi)
+			{
+				break;
+			}
+
+			for (size_t i = 0; i < phi.targets.size(); ++i)
+			{
+				if (phi.targets[i] == from)
+				{
+					phi.targets.erase(phi.targets.begin() + i);
+					phi.operands.erase(phi.operands.begin() + i);
+					break;
+				}
+			}
+		}
+	}
+
+	void IRFunction::RedirectEdge(IRBlockId from, IRBlockId through, IRBlockId to)
+	{
+		std::vector<IRBlockId>& to_predecessors = m_blocks[to].predecessors;
+		assert(std::ranges::find(to_predecessors, through) != to_predecessors.end());
+		assert(std::ranges::find(to_predecessors, from) == to_predecessors.end());
+
+		// Inputs to the phis of 'to' from 'through', as seen from 'from'
+		for (const IRValueId value : m_blocks[to].instructions)
+		{
+			IRInstruction& phi = m_instructions[value];
+			if (phi.opcode != IROpCode::Phi)
+			{
+				break;
+			}
+
+			IRValueId incoming = phi.operands[std::ranges::find(phi.targets, through) - phi.targets.begin()];
+
+			const IRInstruction& incoming_instruction = m_instructions[incoming];
+			if (incoming_instruction.opcode == IROpCode::Phi && incoming_instruction.block == through)
+			{
+				incoming = incoming_instruction.operands[std::ranges::find(incoming_instruction.targets, from) - incoming_instruction.targets.begin()];
+			}
+
+			phi.operands.push_back(incoming);
+			phi.targets.push_back(from);
+		}
+
+		to_predecessors.push_back(from);
+
+		IRInstruction& terminator = m_instructions[*GetTerminator(from)];
+		std::ranges::replace(terminator.targets, through, to);
+
+		std::vector<IRBlockId>& through_predecessors = m_blocks[through].predecessors;
+		through_predecessors.erase(std::ranges::find(through_predecessors, from));
+
+		for (const IRValueId value : m_blocks[through].instructions)
+		{
+			IRInstruction& phi = m_instructions[value];
+			if (phi.opcode != IROpCode::Phi)
+			{
+				break;
+			}
+
+			const size_t index = std::ranges::find(phi.targets, from) - phi.targets.begin();
+			phi.targets.erase(phi.targets.begin() + index);
+			phi.operands.erase(phi.operands.begin() + index);
+		}
+	}
+
+	void IRFunction::MergeIntoPredecessor(IRBlockId block)
+	{
+		assert(m_blocks[block].predecessors.size() == 1);
+		const IRBlockId predecessor = m_blocks[block].predecessors[0];
+		assert(predecessor != block);
+
+		const IRValueId branch = *GetTerminator(predecessor);
+		assert(m_instructions[branch].opcode == IROpCode::Branch);
+
+		// Unlink the branch by hand, as Erase would also drop 'predecessor' from this block
+		m_blocks[predecessor].instructions.pop_back();
+		m_instructions[branch].removed = true;
+		m_instructions[branch].targets.clear();
+
+		for (const IRValueId value : m_blocks[block].instructions)
+		{
+			assert(m_instructions[value].opcode != IROpCode::Phi);
+			m_instructions[value].block = predecessor;
+			m_blocks[predecessor].instructions.push_back(value);
+		}
+
+		for (const IRBlockId successor : GetSuccessors(predecessor))
+		{
+			std::ranges::replace(m_blocks[successor].predecessors, block, predecessor);
+
+			for (const IRValueId value : m_blocks[successor].instructions)
+			{
+				IRInstruction& phi = m_instructions[value];
+				if (phi.opcode != IROpCode::Phi)
+				{
+					break;
+				}
+				std::ranges::replace(phi.targets, block, predecessor);
+			}
+		}
+
+		m_blocks[block].instructions.clear();
+		m_blocks[block].predecessors.clear();
+		m_blocks[block].removed = true;
+	}
+
+	bool IRFunction::RemoveUnreachableBlocks()
+	{
+		std::vector<bool> reachable(m_blocks.size(), false);
+		for (const IRBlockId block : ComputeReversePostOrder())
+		{
+			reachable[block] = true;
+		}
+
+		bool changed = false;
+
+		for (IRBlockId block = 0; block < m_blocks.size(); ++block)
+		{
+			if (reachable[block] || m_blocks[block].removed)
+			{
+				continue;
+			}
+
+			// Detach from live successors, dropping any phi inputs that came from this block
+			for (const IRBlockId successor : GetSuccessors(block))
+			{
+				if (!reachable[successor])
+				{
+					continue;
+				}
+
+				std::vector<IRBlockId>& predecessors = m_blocks[successor].predecessors;
+				std::erase(predecessors, block);
+
+				for (const IRValueId value : m_blocks[successor].instructions)
+				{
+					IRInstruction& phi = m_instructions[value];
+					if (phi.opcode != IROpCode::Phi)
+					{
+						break;
+					}
+
+					for (size_t i = phi.targets.size(); i-- > 0;)
+					{
+						if (phi.targets[i] == block)
+						{
+							phi.targets.erase(phi.targets.begin() + i);
+							phi.operands.erase(phi.operands.begin() + i);
+						}
+					}
+				}
+			}
+
+			for (const IRValueId value : m_blocks[block].instructions)
+			{
+				IRInstruction& instruction = m_instructions[value];
+				instruction.removed = true;
+				instruction.operands.clear();
+				instruction.targets.clear();
+			}
+
+			m_blocks[block].instructions.clear();
+			m_blocks[block].predecessors.clear();
+			m_blocks[block].removed = true;
+			changed = true;
+		}
+
+		return changed;
+	}
+
+	std::optional<IRValueId> IRFunction::GetTerminator(IRBlockId block) const
+	{
+		const std::vector<IRValueId>& instructions = m_blocks[block].instructions;
+		if (!instructions.empty() && IsTerminator(m_instructions[instructions.back()].opcode))
+		{
+			return instructions.back();
+		}
+		return std::nullopt;
+	}
+
+	std::vector<IRBlockId> IRFunction::GetSuccessors(IRBlockId block) const
+	{
+		const std::optional<IRValueId> terminator = GetTerminator(block);
+		if (!terminator)
+		{
+			return {};
+		}
+
+		std::vector<IRBlockId> successors = m_instructions[*terminator].targets;
+		if (successors.size() == 2 && successors[0] == successors[1])
+		{
+			successors.pop_back();
+		}
+		return successors;
+	}
+
+	std::vector<IRBlockId> IRFunction::ComputeReversePostOrder() const
+	{
+		std::vector<IRBlockId> post_order;
+		std::vector<bool> visited(m_blocks.size(), false);
+
+		// (block, index of next successor to visit)
+		std::vector<std::pair<IRBlockId, size_t>> stack;
+		stack.push_back({ GetEntryBlock(), 0 });
+		visited[GetEntryBlock()] = true;
+
+		while (!stack.empty())
+		{
+			auto& [block, next_successor] = stack.back();
+			const std::vector<IRBlockId> successors = GetSuccessors(block);
+
+			if (next_successor < successors.size())
+			{
+				// Visit successors last to first so that the first successor (e.g. the
+				// 'true' side of a branch) ends up directly after its predecessor
+				const IRBlockId successor = successors[successors.size() - 1 - next_successor++];
+				if (!visited[successor])
+				{
+					visited[successor] = true;
+					stack.push_back({ successor, 0 });
+				}
+			}
+			else
+			{
+				post_order.push_back(block);
+				stack.pop_back();
+			}
+		}
+
+		std::ranges::reverse(post_order);
+		return post_order;
+	}
+
+	std::vector<std::optional<IRBlockId>> IRFunction::ComputeImmediateDominators() const
+	{
+		// Cooper, Harvey & Kennedy, "A Simple, Fast Dominance Algorithm"
+		const std::vector<IRBlockId> reverse_post_order = ComputeReversePostOrder();
+
+		std::vector<uint32_t> order(m_blocks.size(), 0);
+		for (uint32_t index = 0; index < reverse_post_order.size(); ++index)
+		{
+			order[reverse_post_order[index]] = index;
+		}
+
+		std::vector<std::optional<IRBlockId>> dominators(m_blocks.size());
+		dominators[GetEntryBlock()] = GetEntryBlock();
+
+		const auto Intersect = [&](IRBlockId left, IRBlockId right)
+			{
+				while (left != right)
+				{
+					while (order[left] > order[right])
+					{
+						left = *dominators[left];
+					}
+					while (order[right] > order[left])
+					{
+						right = *dominators[right];
+					}
+				}
+				return left;
+			};
+
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+
+			for (const IRBlockId block : reverse_post_order)
+			{
+				if (block == GetEntryBlock())
+				{
+					continue;
+				}
+
+				std::optional<IRBlockId> new_dominator;
+				for (const IRBlockId predecessor : m_blocks[block].predecessors)
+				{
+					if (!dominators[predecessor])
+					{
+						continue;
+					}
+					new_dominator = new_dominator ? Intersect(*new_dominator, predecessor) : predecessor;
+				}
+
+				if (new_dominator != dominators[block])
+				{
+					dominators[block] = new_dominator;
+					changed = true;
+				}
+			}
+		}
+
+		return dominators;
+	}
+
+	std::vector<uint32_t> IRFunction::ComputeUseCounts() const
+	{
+		std::vector<uint32_t> use_counts(m_instructions.size(), 0);
+
+		for (const IRBasicBlock& block : m_blocks)
+		{
+			for (const IRValueId value : block.instructions)
+			{
+				for (const IRValueId operand : m_instructions[value].operands)
+				{
+					++use_counts[operand];
+				}
+			}
+		}
+
+		return use_counts;
+	}
+
+	bool IRFunction::Verify() const
+	{
+		bool valid = true;
+
+		const auto Fail = [&](IRBlockId block, std::string message)
+			{
+				std::println("IR verification failed in '{}' bb{}: {}", m_name, block, message);
+				valid = false;
+			};
+
+		for (IRBlockId block = 0; block < m_blocks.size(); ++block)
+		{
+			const IRBasicBlock& basic_block = m_blocks[block];
+			if (basic_block.removed)
+			{
+				continue;
+			}
+
+			if (!GetTerminator(block))
+			{
+				Fail(block, "block has no terminator");
+			}
+
+			bool seen_non_phi = false;
+
+			for (size_t index = 0; index < basic_block.instructions.size(); ++index)
+			{
+				const IRValueId value = basic_block.instructions[index];
+				const IRInstruction& instruction = m_instructions[value];
+
+				if (instruction.removed)
+				{
+					Fail(block, std::format("%{} is removed but still linked", value));
+					continue;
+				}
+
+				if (instruction.block != block)
+				{
+					Fail(block, std::format("%{} claims to belong to bb{}", value, instruction.block));
+				}
+
+				if (IsTerminator(instruction.opcode) && index + 1 != basic_block.instructions.size())
+				{
+					Fail(block, std::format("terminator %{} is not the last instruction", value));
+				}
+
+				if (instruction.opcode == IROpCode::Phi)
+				{
+					if (seen_non_phi)
+					{
+						Fail(block, std::format("phi %{} follows a non-phi instruction", value));
+					}
+
+					if (instruction.operands.size() != basic_block.predecessors.size())
+					{
+						Fail(block, std::format("phi %{} has {} inputs but the block has {} predecessors", value, instruction.operands.size(), basic_block.predecessors.size()));
+					}
+
+					for (const IRBlockId incoming : instruction.targets)
+					{
+						if (std::ranges::find(basic_block.predecessors, incoming) == basic_block.predecessors.end())
+						{
+							Fail(block, std::format("phi %{} has an input from bb{} which is not a predecessor", value, incoming));
+						}
+					}
+				}
+				else
+				{
+					seen_non_phi = true;
+				}
+
+				for (const IRValueId operand : instruction.operands)
+				{
+					if (operand >= m_instructions.size() || m_instructions[operand].removed)
+					{
+						Fail(block, std::format("%{} uses an invalid value %{}", value, operand));
+					}
+				}
+			}
+
+			for (const IRBlockId successor : GetSuccessors(block))
+			{
+				const std::vector<IRBlockId>& predecessors = m_blocks[successor].predecessors;
+				if (m_blocks[successor].removed || std::ranges::find(predecessors, block) == predecessors.end())
+				{
+					Fail(block, std::format("successor bb{} does not list it as a predecessor", successor));
+				}
+			}
+		}
+
+		return valid;
+	}
+
+	void IRFunction::Dump() const
+	{
+		std::string parameters;
+		for (size_t i = 0; i < m_parameter_types.size(); ++i)
+		{
+			parameters += std::format("{}{}", i > 0 ? ", " : "", IRTypeToString(m_parameter_types[i]));
+		}
+
+		std::println("function {}({}) -> {}", m_name, parameters, IRTypeToString(m_return_type));
+
+		for (IRBlockId block = 0; block < m_blocks.size(); ++block)
+		{
+			const IRBasicBlock& basic_block = m_blocks[block];
+			if (basic_block.removed)
+			{
+				continue;
+			}
+
+			std::string predecessors;
+			for (const IRBlockId predecessor : basic_block.predecessors)
+			{
+				predecessors += std::format(" bb{}", predecessor);
+			}
+
+			std::println("bb{}:{}", block, predecessors.empty() ? "" : std::format(" ; preds:{}", predecessors));
+
+			for (const IRValueId value : basic_block.instructions)
+			{
+				const IRInstruction& instruction = m_instructions[value];
+
+				std::string operands;
+				if (instruction.opcode == IROpCode::Const || instruction.opcode == IROpCode::Param)
+				{
+					operands = std::format(" {}", instruction.immediate);
+				}
+				else if (instruction.opcode == IROpCode::Call)
+				{
+					operands = std::format(" @{}", instruction.immediate);
+				}
+
+				for (size_t i = 0; i < instruction.operands.size(); ++i)
+				{
+					if (instruction.opcode == IROpCode::Phi)
+					{
+						operands += std::format("{} [%{}, bb{}]", i > 0 ? "," : "", instruction.operands[i], instruction.targets[i]);
+					}
+					else
+					{
+						operands += std::format("{} %{}", i > 0 ? "," : "", instruction.operands[i]);
+					}
+				}
+
+				if (instruction.opcode != IROpCode::Phi)
+				{
+					for (size_t i = 0; i < instruction.targets.size(); ++i)
+					{
+						operands += std::format("{} bb{}", (i > 0 || !instruction.operands.empty()) ? "," : "", instruction.targets[i]);
+					}
+				}
+
+				if (instruction.type == IRType::Void)
+				{
+					std::println("    {}{}", IROpCodeToString(instruction.opcode), operands);
+				}
+				else
+				{
+					std::println("    %{} = {} {}{}", value, IROpCodeToString(instruction.opcode), IRTypeToString(instruction.type), operands);
+				}
+			}
+		}
+	}
+
+	IRFunctionId IRModule::AddFunction(IRFunction function)
+	{
+		m_functions.push_back(std::move(function));
+		return static_cast<IRFunctionId>(m_functions.size() - 1);
+	}
+
+	std::optional<IRFunctionId> IRModule::FindFunction(std::string_view name) const
+	{
+		for (IRFunctionId function = 0; function < m_functions.size(); ++function)
+		{
+			if (m_functions[function].GetName() == name)
+			{
+				return function;
+			}
+		}
+		return std::nullopt;
+	}
+
+	void IRModule::RemoveFunctions(const std::vector<bool>& keep)
+	{
+		assert(keep.size() == m_functions.size());
+
+		std::vector<IRFunctionId> remapped(m_functions.size(), 0);
+		std::vector<IRFunction> kept_functions;
+
+		for (IRFunctionId function = 0; function < m_functions.size(); ++function)
+		{
+			if (keep[function])
+			{
+				remapped[function] = static_cast<IRFunctionId>(kept_functions.size());
+				kept_functions.push_back(std::move(m_functions[function]));
+			}
+		}
+
+		m_functions = std::move(kept_functions);
+
+		for (IRFunction& function : m_functions)
+		{
+			for (IRValueId value = 0; value < function.GetInstructionCount(); ++value)
+			{
+				IRInstruction& instruction = function.GetInstruction(value);
+				if (!instruction.removed && instruction.opcode == IROpCode::Call)
+				{
+					assert(keep[instruction.immediate]);
+					instruction.immediate = static_cast<int32_t>(remapped[instruction.immediate]);
+				}
+			}
+		}
+	}
+
+	bool IRModule::Verify() const
+	{
+		bool valid = true;
+		for (const IRFunction& function : m_functions)
+		{
+			valid &= function.Verify();
+		}
+		return valid;
+	}
+
+	void IRModule::Dump() const
+	{
+		for (IRFunctionId function = 0; function < m_functions.size(); ++function)
+		{
+			std::print("@{} ", function);
+			m_functions[function].Dump();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,956 @@
+#include "OspreyVM/IR/IRBuilder.h"
+
+#include "OspreyAST/AST.h"
+#include "OspreyAST/ASTVisitor.h"
+
+#include "OspreyAST/Expressions/Literal.h"
+#include "OspreyAST/Expressions/Variable.h"
+#include "OspreyAST/Expressions/UnaryOp.h"
+#include "OspreyAST/Expressions/BinaryOp.h"
+#include "OspreyAST/Expressions/FunctionCall.h"
+#include "OspreyAST/Expressions/FunctionExpression.h"
+#include "OspreyAST/Statements/VariableDecl.h"
+#include "OspreyAST/Statements/Return.h"
+#include "OspreyAST/Statements/If.h"
+#include "OspreyAST/Statements/While.h"
+#include "OspreyAST/Statements/For.h"
+#include "OspreyAST/Statements/Match.h"
+#include "OspreyAST/Statements/Block.h"
+#include "OspreyAST/Statements/Assignment.h"
+#include "OspreyAST/Statements/FunctionDecl.h"
+
+#include <algorithm>
+#include <cassert>
+#include <print>
+#include <span>
+#include <unordered_map>
+
+namespace Osprey
+{
+	/*
+		Builds SSA form directly from the AST using the algorithm from
+		"Simple and Efficient Construction of Static Single Assignment Form"
+		(Braun et al.). Each source variable is tracked per block, phis are
+		created lazily on reads and removed again if they turn out to be trivial.
+	*/
+	class IRBuilder : public ASTVisitor
+	{
+	public:
+		IRBuilder(IRModule& module)
+			: m_module(module)
+		{
+		}
+
+	private:
+		using VariableId = uint32_t;
+
+		ASTVisitorTraversal Visit(const ASTLiteral& node)
+		{
+			m_value = EmitConst(ToIRType(node.GetType()).value_or(IRType::I32), node.GetValue());
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariable& node)
+		{
+			const std::optional<VariableId> variable = LookupVariable(node.GetIdentifier());
+			if (!variable)
+			{
+				std::println("Variable '{}' does not exist", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			m_value = ReadVariable(*variable, m_block);
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		{
+			if (node.GetNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			IRInstruction instruction;
+			instruction.operands = { m_value };
+
+			switch (node.GetOperator())
+			{
+				case UnaryOperator::Exclamation:
+				{
+					instruction.opcode = IROpCode::Not;
+					instruction.type = IRType::Bool;
+					break;
+				}
+				case UnaryOperator::Minus:
+				{
+					instruction.opcode = IROpCode::Neg;
+					instruction.type = IRType::I32;
+					break;
+				}
+				default:
+				{
+					std::println("Unknown unary operator");
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			m_value = Emit(std::move(instruction));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTBinaryExpr& node)
+		{
+			if (node.GetOperator() == BinaryOperator::And || node.GetOperator() == BinaryOperator::Or)
+			{
+				return VisitLogicalExpr(node);
+			}
+
+			if (node.GetLeftNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId left = m_value;
+
+			if (node.GetRightNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId right = m_value;
+
+			IRInstruction instruction;
+			instruction.type = IRType::I32;
+			instruction.operands = { left, right };
+
+			switch (node.GetOperator())
+			{
+				case BinaryOperator::Plus: instruction.opcode = IROpCode::Add; break;
+				case BinaryOperator::Minus: instruction.opcode = IROpCode::Sub; break;
+				case BinaryOperator::Asterisk: instruction.opcode = IROpCode::Mul; break;
+				case BinaryOperator::Divide: instruction.opcode = IROpCode::Div; break;
+				case BinaryOperator::Percent: instruction.opcode = IROpCode::Mod; break;
+				case BinaryOperator::Lt: instruction.opcode = IROpCode::CmpLt; break;
+				case BinaryOperator::LtEq: instruction.opcode = IROpCode::CmpLe; break;
+				case BinaryOperator::Gt: instruction.opcode = IROpCode::CmpGt; break;
+				case BinaryOperator::GtEq: instruction.opcode = IROpCode::CmpGe; break;
+				case BinaryOperator::Equality: instruction.opcode = IROpCode::CmpEq; break;
+				case BinaryOperator::NotEquality: instruction.opcode = IROpCode::CmpNe; break;
+				default:
+				{
+					std::println("Unknown operator");
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			if (IsComparison(instruction.opcode))
+			{
+				instruction.type = IRType::Bool;
+			}
+
+			m_value = Emit(std::move(instruction));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		// '&&' and '||' only evaluate their right-hand side when needed, so they become control flow
+		ASTVisitorTraversal VisitLogicalExpr(const ASTBinaryExpr& node)
+		{
+			const bool is_and = node.GetOperator() == BinaryOperator::And;
+
+			if (node.GetLeftNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// The value produced when the right-hand side is skipped
+			const IRValueId short_circuit_value = EmitConst(IRType::Bool, is_and ? 0 : 1);
+
+			const IRBlockId right_block = CreateBlock();
+			const IRBlockId merge_block = CreateBlock();
+
+			if (is_and)
+			{
+				EmitCondBranch(m_value, right_block, merge_block);
+			}
+			else
+			{
+				EmitCondBranch(m_value, merge_block, right_block);
+			}
+			SealBlock(right_block);
+
+			m_block = right_block;
+			if (node.GetRightNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId right_value = ToBool(m_value);
+			const IRBlockId right_end_block = m_block;
+			EmitBranch(merge_block);
+			SealBlock(merge_block);
+
+			m_block = merge_block;
+			const IRValueId phi = m_function->InsertPhi(merge_block, IRType::Bool);
+			for (const IRBlockId predecessor : m_function->GetBlock(merge_block).predecessors)
+			{
+				IRInstruction& instruction = m_function->GetInstruction(phi);
+				instruction.operands.push_back(predecessor == right_end_block ? right_value : short_circuit_value);
+				instruction.targets.push_back(predecessor);
+			}
+
+			m_value = phi;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		{
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const std::optional<IRType> type = ToIRType(node.GetType());
+			if (!type)
+			{
+				std::println("Variable '{}' has a type that is not supported by the IR", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const std::optional<VariableId> variable = DeclareVariable(node.GetIdentifier(), *type);
+			if (!variable)
+			{
+				std::println("Failed to push variable declaration");
+				return ASTVisitorTraversal::Stop;
+			}
+
+			WriteVariable(*variable, m_block, m_value);
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTReturn& node)
+		{
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::Return;
+			instruction.operands = { m_value };
+			Emit(std::move(instruction));
+
+			// Anything following a return is unreachable, but still needs somewhere to go
+			m_block = CreateBlock();
+			SealBlock(m_block);
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTBlock& node)
+		{
+			m_scopes.emplace_back();
+
+			for (const ASTStmt* statement : node.GetStatements())
+			{
+				if (statement->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			m_scopes.pop_back();
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		{
+			const std::optional<VariableId> variable = LookupVariable(node.GetIdentifier());
+			if (!variable)
+			{
+				std::println("Trying to assign to a variable '{}' that doesn't exist", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			WriteVariable(*variable, m_block, m_value);
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		{
+			if (node.GetPredicate()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const IRBlockId true_block = CreateBlock();
+			const IRBlockId false_block = node.GetFalseBlock() ? CreateBlock() : 0;
+			const IRBlockId merge_block = CreateBlock();
+
+			EmitCondBranch(m_value, true_block, node.GetFalseBlock() ? false_block : merge_block);
+			SealBlock(true_block);
+
+			m_block = true_block;
+			if (node.GetTrueBlock()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			EmitBranch(merge_block);
+
+			if (node.GetFalseBlock())
+			{
+				SealBlock(false_block);
+
+				m_block = false_block;
+				if (node.GetFalseBlock()->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+				EmitBranch(merge_block);
+			}
+
+			SealBlock(merge_block);
+			m_block = merge_block;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTWhileStmt& node)
+		{
+			// The header is sealed once the back edge from the end of the body has been added
+			const IRBlockId header_block = CreateBlock();
+			const IRBlockId body_block = CreateBlock();
+			const IRBlockId exit_block = CreateBlock();
+
+			EmitBranch(header_block);
+
+			m_block = header_block;
+			if (node.GetPredicate()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			EmitCondBranch(m_value, body_block, exit_block);
+			SealBlock(body_block);
+
+			m_block = body_block;
+			if (node.GetBody()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			EmitBranch(header_block);
+
+			SealBlock(header_block);
+			SealBlock(exit_block);
+			m_block = exit_block;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		// Lowered as 'i = start; while (i < limit) { body; i = i + 1; }' with the limit read once,
+		// so that the passes treat it like any other loop
+		ASTVisitorTraversal Visit(const ASTForStmt& node)
+		{
+			if (node.GetStart()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId start = m_value;
+
+			if (node.GetLimit()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId limit = m_value;
+
+			m_scopes.emplace_back();
+
+			const std::optional<VariableId> counter = DeclareVariable(node.GetIdentifier(), IRType::I32);
+			if (!counter)
+			{
+				std::println("Failed to declare loop variable '{}'", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+			WriteVariable(*counter, m_block, start);
+
+			const IRBlockId header_block = CreateBlock();
+			const IRBlockId body_block = CreateBlock();
+			const IRBlockId exit_block = CreateBlock();
+
+			EmitBranch(header_block);
+
+			m_block = header_block;
+			IRInstruction compare;
+			compare.opcode = IROpCode::CmpLt;
+			compare.type = IRType::Bool;
+			compare.operands = { ReadVariable(*counter, header_block), limit };
+			EmitCondBranch(Emit(std::move(compare)), body_block, exit_block);
+			SealBlock(body_block);
+
+			m_block = body_block;
+			if (node.GetBody()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			IRInstruction increment;
+			increment.opcode = IROpCode::Add;
+			increment.type = IRType::I32;
+			increment.operands = { ReadVariable(*counter, m_block), EmitConst(IRType::I32, 1) };
+			WriteVariable(*counter, m_block, Emit(std::move(increment)));
+			EmitBranch(header_block);
+
+			SealBlock(header_block);
+			SealBlock(exit_block);
+			m_block = exit_block;
+
+			m_scopes.pop_back();
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTMatchStmt& node)
+		{
+			if (node.GetValue()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			const IRValueId value = m_value;
+
+			std::vector<IRBlockId> arm_blocks;
+			std::vector<std::pair<int32_t, IRBlockId>> cases;
+			for (const MatchArm& arm : node.GetArms())
+			{
+				arm_blocks.push_back(CreateBlock());
+				for (const int32_t arm_value : arm.values)
+				{
+					cases.emplace_back(arm_value, arm_blocks.back());
+				}
+			}
+			std::ranges::sort(cases);
+
+			const IRBlockId merge_block = CreateBlock();
+			const IRBlockId else_block = node.GetElseArm() ? CreateBlock() : merge_block;
+
+			EmitMatchDispatch(value, cases, else_block);
+
+			for (size_t arm = 0; arm < arm_blocks.size(); ++arm)
+			{
+				SealBlock(arm_blocks[arm]);
+
+				m_block = arm_blocks[arm];
+				if (node.GetArms()[arm].body->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+				EmitBranch(merge_block);
+			}
+
+			if (node.GetElseArm())
+			{
+				SealBlock(else_block);
+
+				m_block = else_block;
+				if (node.GetElseArm()->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+				EmitBranch(merge_block);
+			}
+
+			SealBlock(merge_block);
+			m_block = merge_block;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		// Branches from the current block to the block of the case equal to 'value', or to
+		// 'else_block'. A few cases are compared in turn, more are split in two by comparing
+		// against the middle case, so that dispatch is logarithmic in the number of cases.
+		void EmitMatchDispatch(IRValueId value, std::span<const std::pair<int32_t, IRBlockId>> cases, IRBlockId else_block)
+		{
+			constexpr size_t MaxCompareChain = 4;
+
+			const auto EmitCompare = [&](IROpCode opcode, int32_t case_value) -> IRValueId
+				{
+					IRInstruction compare;
+					compare.opcode = opcode;
+					compare.type = IRType::Bool;
+					compare.operands = { value, EmitConst(IRType::I32, case_value) };
+					return Emit(std::move(compare));
+				};
+
+			if (cases.size() <= MaxCompareChain)
+			{
+				for (size_t index = 0; index < cases.size(); ++index)
+				{
+					const IRBlockId next_block = index + 1 < cases.size() ? CreateBlock() : else_block;
+					EmitCondBranch(EmitCompare(IROpCode::CmpEq, cases[index].first), cases[index].second, next_block);
+
+					if (next_block != else_block)
+					{
+						SealBlock(next_block);
+						m_block = next_block;
+					}
+				}
+
+				if (cases.empty())
+				{
+					EmitBranch(else_block);
+				}
+				return;
+			}
+
+			const size_t middle = cases.size() / 2;
+			const IRBlockId lower_block = CreateBlock();
+			const IRBlockId upper_block = CreateBlock();
+			EmitCondBranch(EmitCompare(IROpCode::CmpLt, cases[middle].first), lower_block, upper_block);
+			SealBlock(lower_block);
+			SealBlock(upper_block);
+
+			m_block = lower_block;
+			EmitMatchDispatch(value, cases.first(middle), else_block);
+
+			m_block = upper_block;
+			EmitMatchDispatch(value, cases.subspan(middle), else_block);
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionCall& node)
+		{
+			const std::optional<IRFunctionId> callee = m_module.FindFunction(node.GetIdentifier());
+			if (!callee)
+			{
+				std::println("Failed to call undefined function '{}'", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const IRFunction& callee_function = m_module.GetFunction(*callee);
+			if (callee_function.GetParameterTypes().size() != node.GetArgs().args.size())
+			{
+				std::println("Function '{}' expects {} argument(s) but was given {}", node.GetIdentifier(), callee_function.GetParameterTypes().size(), node.GetArgs().args.size());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::Call;
+			instruction.type = callee_function.GetReturnType();
+			instruction.immediate = static_cast<int32_t>(*callee);
+
+			for (const ASTExpr* arg : node.GetArgs().args)
+			{
+				if (arg->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+				instruction.operands.push_back(m_value);
+			}
+
+			m_value = Emit(std::move(instruction));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
+		{
+			std::println("Nested function '{}' is not supported by the IR", node.GetIdentifier());
+			return ASTVisitorTraversal::Stop;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionExpr& node)
+		{
+			assert(m_function != nullptr);
+
+			m_scopes.emplace_back();
+
+			const ParameterList& parameters = node.GetParameters();
+			for (size_t index = 0; index < parameters.size(); ++index)
+			{
+				const IRType type = m_function->GetParameterTypes()[index];
+
+				IRInstruction instruction;
+				instruction.opcode = IROpCode::Param;
+				instruction.type = type;
+				instruction.immediate = static_cast<int32_t>(index);
+				const IRValueId value = Emit(std::move(instruction));
+
+				const std::optional<VariableId> variable = DeclareVariable(parameters[index].GetIdentifier(), type);
+				if (!variable)
+				{
+					std::println("Duplicate parameter '{}'", parameters[index].GetIdentifier());
+					return ASTVisitorTraversal::Stop;
+				}
+				WriteVariable(*variable, m_block, value);
+			}
+
+			// Parses the body now if the parser skipped it
+			const ASTBlock* body = node.GetBody();
+			if (!body)
+			{
+				std::println("Failed to parse function '{}': {}", m_function->GetName(), node.GetBodyError().value_or(""));
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (body->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			m_scopes.pop_back();
+
+			// The block we finished in is only allowed to lack a return if it can never be reached
+			m_function->RemoveUnreachableBlocks();
+			if (!m_function->GetBlock(m_block).removed)
+			{
+				std::println("Function '{}' does not return a value on every path", m_function->GetName());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTProgram& node)
+		{
+			std::vector<const ASTFunctionDeclarationStmt*> declarations;
+
+			// Register every function first so that calls can refer to functions declared later
+			for (const ASTStmt* statement : node.GetStatements())
+			{
+				const ASTFunctionDeclarationStmt* declaration = ASTNodeCast<ASTFunctionDeclarationStmt>(statement);
+				if (!declaration)
+				{
+					std::println("Only function declarations are supported at the top level by the IR");
+					return ASTVisitorTraversal::Stop;
+				}
+
+				if (m_module.FindFunction(declaration->GetIdentifier()))
+				{
+					std::println("Function '{}' is declared more than once", declaration->GetIdentifier());
+					return ASTVisitorTraversal::Stop;
+				}
+
+				const ASTFunctionExpr& function = *declaration->GetFunction();
+
+				std::vector<IRType> parameter_types;
+				for (const FunctionParameter& parameter : function.GetParameters())
+				{
+					const std::optional<IRType> type = ToIRType(parameter.GetType());
+					if (!type)
+					{
+						std::println("Parameter '{}' has a type that is not supported by the IR", parameter.GetIdentifier());
+						return ASTVisitorTraversal::Stop;
+					}
+					parameter_types.push_back(*type);
+				}
+
+				const std::optional<IRType> return_type = ToIRType(function.GetReturnType());
+				if (!return_type)
+				{
+					std::println("Function '{}' has a return type that is not supported by the IR", declaration->GetIdentifier());
+					return ASTVisitorTraversal::Stop;
+				}
+
+				m_module.AddFunction(IRFunction(declaration->GetIdentifier(), std::move(parameter_types), *return_type));
+				declarations.push_back(declaration);
+			}
+
+			for (IRFunctionId function = 0; function < declarations.size(); ++function)
+			{
+				BeginFunction(m_module.GetFunction(function));
+
+				if (declarations[function]->GetFunction()->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					std::println("Failed to compile function '{}'", declarations[function]->GetIdentifier());
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			if (!m_module.FindFunction("main"))
+			{
+				std::println("Failed to compile program: no 'main' function");
+				return ASTVisitorTraversal::Stop;
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+	private:
+		static std::optional<IRType> ToIRType(const Type& type)
+		{
+			const std::optional<DataType> data_type = type.GetDataType();
+			if (!data_type)
+			{
+				return std::nullopt;
+			}
+
+			switch (*data_type)
+			{
+				case DataType::Bool: return IRType::Bool;
+				case DataType::I32: return IRType::I32;
+				default: return std::nullopt;
+			}
+		}
+
+		void BeginFunction(IRFunction& function)
+		{
+			m_function = &function;
+			m_block = function.GetEntryBlock();
+
+			m_scopes.clear();
+			m_variable_types.clear();
+			m_current_definitions.clear();
+			m_incomplete_phis.clear();
+			m_forwarded.clear();
+			m_sealed.assign(function.GetBlockCount(), false);
+
+			SealBlock(m_block);
+		}
+
+		IRBlockId CreateBlock()
+		{
+			const IRBlockId block = m_function->CreateBlock();
+			m_sealed.resize(m_function->GetBlockCount(), false);
+			return block;
+		}
+
+		IRValueId Emit(IRInstruction instruction)
+		{
+			return m_function->Append(m_block, std::move(instruction));
+		}
+
+		IRValueId EmitConst(IRType type, int32_t value)
+		{
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::Const;
+			instruction.type = type;
+			instruction.immediate = value;
+			return Emit(std::move(instruction));
+		}
+
+		void EmitBranch(IRBlockId target)
+		{
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::Branch;
+			instruction.targets = { target };
+			Emit(std::move(instruction));
+		}
+
+		void EmitCondBranch(IRValueId condition, IRBlockId true_target, IRBlockId false_target)
+		{
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::CondBranch;
+			instruction.operands = { condition };
+			instruction.targets = { true_target, false_target };
+			Emit(std::move(instruction));
+		}
+
+		IRValueId ToBool(IRValueId value)
+		{
+			if (m_function->GetInstruction(value).type == IRType::Bool)
+			{
+				return value;
+			}
+
+			const IRValueId zero = EmitConst(IRType::I32, 0);
+
+			IRInstruction instruction;
+			instruction.opcode = IROpCode::CmpNe;
+			instruction.type = IRType::Bool;
+			instruction.operands = { value, zero };
+			return Emit(std::move(instruction));
+		}
+
+		std::optional<VariableId> DeclareVariable(const std::string& identifier, IRType type)
+		{
+			for (const auto& scope : m_scopes)
+			{
+				if (scope.contains(identifier))
+				{
+					return std::nullopt;
+				}
+			}
+
+			const VariableId variable = static_cast<VariableId>(m_variable_types.size());
+			m_variable_types.push_back(type);
+			m_current_definitions.emplace_back();
+			m_scopes.back().emplace(identifier, variable);
+			return variable;
+		}
+
+		std::optional<VariableId> LookupVariable(const std::string& identifier) const
+		{
+			for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope)
+			{
+				auto found = scope->find(identifier);
+				if (found != scope->end())
+				{
+					return found->second;
+				}
+			}
+			return std::nullopt;
+		}
+
+		IRValueId Resolve(IRValueId value) const
+		{
+			for (auto found = m_forwarded.find(value); found != m_forwarded.end(); found = m_forwarded.find(value))
+			{
+				value = found->second;
+			}
+			return value;
+		}
+
+		void WriteVariable(VariableId variable, IRBlockId block, IRValueId value)
+		{
+			m_current_definitions[variable][block] = value;
+		}
+
+		IRValueId ReadVariable(VariableId variable, IRBlockId block)
+		{
+			auto found = m_current_definitions[variable].find(block);
+			if (found != m_current_definitions[variable].end())
+			{
+				return Resolve(found->second);
+			}
+			return ReadVariableRecursive(variable, block);
+		}
+
+		IRValueId ReadVariableRecursive(VariableId variable, IRBlockId block)
+		{
+			const std::vector<IRBlockId> predecessors = m_function->GetBlock(block).predecessors;
+
+			IRValueId value;
+			if (!m_sealed[block])
+			{
+				// Not all predecessors are known yet, so resolve this phi when the block is sealed
+				value = m_function->InsertPhi(block, m_variable_types[variable]);
+				m_incomplete_phis[block].push_back({ variable, value });
+			}
+			else if (predecessors.size() == 1)
+			{
+				value = ReadVariable(variable, predecessors[0]);
+			}
+			else
+			{
+				// With no predecessors (dead code) this is an empty phi, acting as an undefined value
+				value = m_function->InsertPhi(block, m_variable_types[variable]);
+				WriteVariable(variable, block, value);
+				value = AddPhiOperands(variable, value);
+			}
+
+			WriteVariable(variable, block, value);
+			return value;
+		}
+
+		IRValueId AddPhiOperands(VariableId variable, IRValueId phi)
+		{
+			const IRBlockId block = m_function->GetInstruction(phi).block;
+			const std::vector<IRBlockId> predecessors = m_function->GetBlock(block).predecessors;
+
+			std::vector<IRValueId> operands;
+			for (const IRBlockId predecessor : predecessors)
+			{
+				operands.push_back(ReadVariable(variable, predecessor));
+			}
+
+			IRInstruction& instruction = m_function->GetInstruction(phi);
+			instruction.operands = std::move(operands);
+			instruction.targets = predecessors;
+
+			return TryRemoveTrivialPhi(phi);
+		}
+
+		IRValueId TryRemoveTrivialPhi(IRValueId phi)
+		{
+			std::optional<IRValueId> same;
+			for (const IRValueId operand : m_function->GetInstruction(phi).operands)
+			{
+				if (operand == same || operand == phi)
+				{
+					continue;
+				}
+				if (same)
+				{
+					return phi;
+				}
+				same = operand;
+			}
+
+			if (!same)
+			{
+				return phi;
+			}
+
+			// Other phis using this one may become trivial once it is replaced
+			std::vector<IRValueId> phi_users;
+			for (size_t value = 0; value < m_function->GetInstructionCount(); ++value)
+			{
+				const IRInstruction& user = m_function->GetInstruction(static_cast<IRValueId>(value));
+				if (value != phi && !user.removed && user.opcode == IROpCode::Phi && std::ranges::find(user.operands, phi) != user.operands.end())
+				{
+					phi_users.push_back(static_cast<IRValueId>(value));
+				}
+			}
+
+			m_function->ReplaceAllUsesWith(phi, *same);
+			m_function->Erase(phi);
+			m_forwarded[phi] = *same;
+
+			for (const IRValueId user : phi_users)
+			{
+				if (!m_function->GetInstruction(user).removed)
+				{
+					TryRemoveTrivialPhi(user);
+				}
+			}
+
+			return Resolve(*same);
+		}
+
+		void SealBlock(IRBlockId block)
+		{
+			const std::vector<std::pair<VariableId, IRValueId>> incomplete_phis = std::move(m_incomplete_phis[block]);
+			m_incomplete_phis.erase(block);
+
+			for (const auto& [variable, phi] : incomplete_phis)
+			{
+				AddPhiOperands(variable, phi);
+			}
+
+			m_sealed[block] = true;
+		}
+
+	private:
+		IRModule& m_module;
+		IRFunction* m_function = nullptr;
+		IRBlockId m_block = 0;
+		IRValueId m_value = 0;
+
+		std::vector<std::unordered_map<std::string, VariableId>> m_scopes;
+		std::vector<IRType> m_variable_types;
+		std::vector<std::unordered_map<IRBlockId, IRValueId>> m_current_definitions;
+		std::unordered_map<IRBlockId, std::vector<std::pair<VariableId, IRValueId>>> m_incomplete_phis;
+		std::unordered_map<IRValueId, IRValueId> m_forwarded;
+		std::vector<bool> m_sealed;
+	};
+
+	std::optional<IRModule> BuildIR(const AST& ast)
+	{
+		IRModule module;
+		IRBuilder builder(module);
+
+		if (ast.GetRoot()->Accept(builder) == ASTVisitorTraversal::Stop)
+		{
+			std::println("Failed to build IR");
+			return std::nullopt;
+		}
+
+		return module;
+	}
+}
\ No newline at end of file
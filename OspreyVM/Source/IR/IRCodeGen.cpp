@@ -0,0 +1,1062 @@
+#include "OspreyVM/IR/IRCodeGen.h"
+
+#include "OspreyVM/VMInstruction.h"
+#include "OspreyVM/VMProgram.h"
+#include "OspreyVM/VMProfile.h"
+#include "OspreyVM/VM.h"
+
+#include <array>
+#include <cassert>
+#include <map>
+#include <numeric>
+#include <print>
+#include <utility>
+
+namespace Osprey
+{
+	// Execution counts of a module's functions, blocks and calls
+	struct IRExecutionProfile
+	{
+		struct Function
+		{
+			uint64_t call_count = 0;
+			std::vector<uint64_t> block_counts;
+			// How often the conditional branch ending each block went to each of its targets
+			std::vector<std::array<uint64_t, 2>> branch_counts;
+		};
+
+		std::vector<Function> functions;
+		// Keyed by (caller, callee), ordered so that layouts are deterministic
+		std::map<std::pair<IRFunctionId, IRFunctionId>, uint64_t> call_counts;
+	};
+
+	namespace
+	{
+		uint64_t GetEdgeCount(const IRFunction& function, const IRExecutionProfile::Function& profile, IRBlockId from, IRBlockId to)
+		{
+			const IRInstruction& terminator = function.GetInstruction(*function.GetTerminator(from));
+			if (terminator.opcode != IROpCode::CondBranch)
+			{
+				return profile.block_counts[from];
+			}
+
+			uint64_t count = 0;
+			for (size_t target = 0; target < terminator.targets.size(); ++target)
+			{
+				if (terminator.targets[target] == to)
+				{
+					count += profile.branch_counts[from][target];
+				}
+			}
+			return count;
+		}
+
+		// Each block runs as often as the edges into it are taken. Conditional edges were
+		// counted directly, and an unconditional edge is taken as often as its source runs.
+		void ComputeBlockCounts(const IRFunction& function, IRExecutionProfile::Function& profile)
+		{
+			const std::vector<IRBlockId> order = function.ComputeReversePostOrder();
+
+			// Each pass carries the counts at least one edge further around any loops
+			for (size_t pass = 0; pass <= order.size(); ++pass)
+			{
+				bool changed = false;
+
+				for (const IRBlockId block : order)
+				{
+					uint64_t count = block == order.front() ? profile.call_count : 0;
+					for (const IRBlockId predecessor : function.GetBlock(block).predecessors)
+					{
+						count += GetEdgeCount(function, profile, predecessor, block);
+					}
+
+					changed |= std::exchange(profile.block_counts[block], count) != count;
+				}
+
+				if (!changed)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	/*
+		Each function gets a fixed stack frame above the caller's return address:
+
+		[..., return_addr, param_0, ..., param_n, slot_0, ..., slot_k, temporaries ]
+
+		Values that are used more than once, across blocks, or by a phi are given a
+		slot. Single-use values are instead emitted directly where they are used so
+		that expression trees stay on the operand stack just like the direct compiler.
+		Constants are always rematerialised with PUSH.
+	*/
+	class IRCodeGen
+	{
+	public:
+		// With a profile, functions and blocks are laid out for locality using its counts
+		IRCodeGen(const IRModule& module, const IRExecutionProfile* profile = nullptr)
+			: m_module(module)
+			, m_profile(profile)
+		{
+		}
+
+		bool Generate(IRFunctionId entry, std::span<const int32_t> arguments)
+		{
+			GenerateEntry(entry, arguments);
+
+			m_function_offsets.resize(m_module.GetFunctions().size(), -1);
+
+			for (const IRFunctionId function : ComputeFunctionLayout(entry))
+			{
+				m_function_offsets[function] = GetNextInstructionOffset();
+				if (!GenerateFunction(function))
+				{
+					std::println("Failed to compile function '{}'", m_module.GetFunction(function).GetName());
+					return false;
+				}
+			}
+
+			// Blocks that never ran are kept out of the way of the hot code, after every function
+			for (ColdBlocks& cold_blocks : m_cold_blocks)
+			{
+				if (!GenerateColdBlocks(cold_blocks))
+				{
+					std::println("Failed to compile function '{}'", m_module.GetFunction(cold_blocks.function).GetName());
+					return false;
+				}
+			}
+
+			ResolveCallFixups();
+			return true;
+		}
+
+		// Generates 'entry', and the functions it can call, unless an earlier call already
+		// has, so that evaluating calls at compile time only pays for the code it runs
+		bool GenerateReachableFunctions(IRFunctionId entry)
+		{
+			assert(!m_profile);
+			m_function_offsets.resize(m_module.GetFunctions().size(), -1);
+
+			std::vector<IRFunctionId> pending = { entry };
+			while (!pending.empty())
+			{
+				const IRFunctionId function = pending.back();
+				pending.pop_back();
+				if (m_function_offsets[function] >= 0)
+				{
+					continue;
+				}
+
+				m_function_offsets[function] = GetNextInstructionOffset();
+				const size_t first_fixup = m_call_fixups.size();
+				if (!GenerateFunction(function))
+				{
+					std::println("Failed to compile function '{}'", m_module.GetFunction(function).GetName());
+					return false;
+				}
+
+				for (size_t fixup = first_fixup; fixup < m_call_fixups.size(); ++fixup)
+				{
+					pending.push_back(m_call_fixups[fixup].second);
+				}
+			}
+
+			ResolveCallFixups();
+			return true;
+		}
+
+		// Runs 'entry', which must have been generated, from a stub appended to the program
+		// and removed again afterwards. 'fuel' is left holding what the call did not use.
+		std::optional<int32_t> Evaluate(IRFunctionId entry, std::span<const int32_t> arguments, size_t& fuel)
+		{
+			const int32_t entry_offset = GetNextInstructionOffset();
+			GenerateEntry(entry, arguments);
+			ResolveCallFixups();
+
+			std::optional<VM> vm = VM::Load(VMProgram(std::move(m_instructions)), entry_offset);
+			std::optional<int32_t> result;
+			if (vm->Execute(fuel) == VMStatus::Halted && vm->GetStack().GetSize() == 1)
+			{
+				result = vm->GetStack().GetFromTop(0);
+			}
+			fuel = vm->GetRemainingFuel();
+
+			m_instructions = vm->TakeProgram().TakeInstructions();
+			m_instructions.resize(entry_offset);
+			m_call_sites.pop_back();
+
+			return result;
+		}
+
+		std::vector<int32_t> TakeInstructions()
+		{
+			return std::move(m_instructions);
+		}
+
+		// Attributes the counts from running the generated program to the module
+		IRExecutionProfile MapProfile(const VMProfile& profile) const
+		{
+			IRExecutionProfile execution_profile;
+			execution_profile.functions.resize(m_module.GetFunctions().size());
+
+			for (IRFunctionId function = 0; function < m_module.GetFunctions().size(); ++function)
+			{
+				const size_t block_count = m_module.GetFunction(function).GetBlockCount();
+				execution_profile.functions[function].block_counts.assign(block_count, 0);
+				execution_profile.functions[function].branch_counts.assign(block_count, {});
+			}
+
+			for (const auto& [caller, callee, opcode_offset] : m_call_sites)
+			{
+				const uint64_t count = profile.GetJumpCount(opcode_offset);
+				execution_profile.functions[callee].call_count += count;
+				if (caller && count > 0)
+				{
+					execution_profile.call_counts[{ *caller, callee }] += count;
+				}
+			}
+
+			for (const auto& [function, block, opcode_offset, jump_target] : m_branch_sites)
+			{
+				const VMBranchCounts counts = profile.GetBranchCounts(opcode_offset);
+				std::array<uint64_t, 2>& branch_counts = execution_profile.functions[function].branch_counts[block];
+				branch_counts[jump_target] += counts.taken;
+				branch_counts[1 - jump_target] += counts.not_taken;
+			}
+
+			for (IRFunctionId function = 0; function < m_module.GetFunctions().size(); ++function)
+			{
+				ComputeBlockCounts(m_module.GetFunction(function), execution_profile.functions[function]);
+			}
+
+			return execution_profile;
+		}
+
+	private:
+		enum class ValueLocation : uint8_t
+		{
+			None,		// produces nothing, or is never used
+			Constant,	// rematerialised at every use
+			Frame,		// lives in a parameter or slot of the frame
+			Deferred,	// emitted at its only use
+			Discarded,	// emitted for its side effects and popped
+		};
+
+		// A function's blocks that never ran, with the state to generate them after every function
+		struct ColdBlocks
+		{
+			IRFunctionId function;
+			std::vector<IRBlockId> layout;
+			std::vector<int32_t> block_offsets;
+			std::vector<std::pair<size_t, IRBlockId>> block_fixups;
+		};
+
+		bool GenerateFunction(IRFunctionId function_id)
+		{
+			const IRFunction& function = m_module.GetFunction(function_id);
+
+			m_function_id = function_id;
+			m_function = &function;
+			m_block_offsets.assign(function.GetBlockCount(), -1);
+			m_block_fixups.clear();
+
+			AssignLocations();
+
+			std::vector<IRBlockId> cold_layout;
+			const std::vector<IRBlockId> layout = ComputeBlockLayout(cold_layout);
+
+			// Prologue: reserve the slots, the parameters have already been pushed by the caller
+			m_depth = static_cast<int32_t>(function.GetParameterTypes().size());
+			for (int32_t slot = 0; slot < m_slot_count; ++slot)
+			{
+				Emit(VMInstruction::PUSH(0));
+			}
+
+			if (!GenerateBlocks(layout))
+			{
+				return false;
+			}
+
+			// The jumps into the cold blocks are patched once they have been placed
+			if (!cold_layout.empty())
+			{
+				m_cold_blocks.push_back({ function_id, std::move(cold_layout), std::move(m_block_offsets), std::move(m_block_fixups) });
+				return true;
+			}
+
+			ResolveBlockFixups();
+			return true;
+		}
+
+		bool GenerateColdBlocks(ColdBlocks& cold_blocks)
+		{
+			m_function_id = cold_blocks.function;
+			m_function = &m_module.GetFunction(cold_blocks.function);
+			m_block_offsets = std::move(cold_blocks.block_offsets);
+			m_block_fixups = std::move(cold_blocks.block_fixups);
+
+			// Locations are deterministic, so match those the rest of the function was generated with
+			AssignLocations();
+
+			if (!GenerateBlocks(cold_blocks.layout))
+			{
+				return false;
+			}
+
+			ResolveBlockFixups();
+			return true;
+		}
+
+		bool GenerateBlocks(std::span<const IRBlockId> layout)
+		{
+			m_edge_stubs.clear();
+
+			for (size_t layout_index = 0; layout_index < layout.size(); ++layout_index)
+			{
+				const IRBlockId block = layout[layout_index];
+				const std::optional<IRBlockId> next_block = layout_index + 1 < layout.size() ? std::optional(layout[layout_index + 1]) : std::nullopt;
+
+				m_block_offsets[block] = GetNextInstructionOffset();
+				m_depth = GetFrameSize();
+
+				if (!GenerateBlock(block, next_block))
+				{
+					return false;
+				}
+			}
+
+			// Phi copies for conditional edges live out of line
+			for (size_t stub = 0; stub < m_edge_stubs.size(); ++stub)
+			{
+				const auto& [from, to, operand_offsets] = m_edge_stubs[stub];
+				for (const size_t operand_offset : operand_offsets)
+				{
+					m_instructions[operand_offset] = GetNextInstructionOffset();
+				}
+
+				m_depth = GetFrameSize();
+				EmitEdge(from, to, std::nullopt);
+			}
+
+			return true;
+		}
+
+		void ResolveBlockFixups()
+		{
+			for (const auto& [operand_offset, block] : m_block_fixups)
+			{
+				assert(m_block_offsets[block] >= 0);
+				m_instructions[operand_offset] = m_block_offsets[block];
+			}
+		}
+
+		// Without a profile, functions are laid out in module order. With one, the entry comes
+		// first and then, repeatedly, the function called most often by those already placed,
+		// so hot callees follow their callers. Functions that never ran come last.
+		std::vector<IRFunctionId> ComputeFunctionLayout(IRFunctionId entry) const
+		{
+			const size_t function_count = m_module.GetFunctions().size();
+
+			std::vector<IRFunctionId> layout(function_count);
+			if (!m_profile)
+			{
+				std::iota(layout.begin(), layout.end(), IRFunctionId(0));
+				return layout;
+			}
+
+			assert(m_profile->functions.size() == function_count);
+
+			std::vector<bool> placed(function_count, false);
+			layout = { entry };
+			placed[entry] = true;
+
+			while (true)
+			{
+				std::optional<IRFunctionId> next;
+				uint64_t next_count = 0;
+				for (const auto& [call, count] : m_profile->call_counts)
+				{
+					if (placed[call.first] && !placed[call.second] && count > next_count)
+					{
+						next = call.second;
+						next_count = count;
+					}
+				}
+
+				if (!next)
+				{
+					break;
+				}
+
+				layout.push_back(*next);
+				placed[*next] = true;
+			}
+
+			for (IRFunctionId function = 0; function < function_count; ++function)
+			{
+				if (!placed[function])
+				{
+					layout.push_back(function);
+				}
+			}
+
+			return layout;
+		}
+
+		// Without a profile, blocks are laid out in reverse post-order. With one, each block is
+		// followed by its most frequent unplaced successor so the hot path falls through, and
+		// the blocks that never ran are returned in 'cold_layout'.
+		std::vector<IRBlockId> ComputeBlockLayout(std::vector<IRBlockId>& cold_layout) const
+		{
+			const std::vector<IRBlockId> order = m_function->ComputeReversePostOrder();
+
+			// Functions that never ran are already kept together at the end of the program
+			if (!m_profile || m_profile->functions[m_function_id].call_count == 0)
+			{
+				return order;
+			}
+
+			const IRExecutionProfile::Function& profile = m_profile->functions[m_function_id];
+
+			std::vector<bool> placed(m_function->GetBlockCount(), false);
+			for (const IRBlockId block : order)
+			{
+				if (profile.block_counts[block] == 0)
+				{
+					cold_layout.push_back(block);
+					placed[block] = true;
+				}
+			}
+
+			std::vector<IRBlockId> layout;
+			size_t order_index = 0;
+
+			for (std::optional<IRBlockId> block = order.front(); block;)
+			{
+				layout.push_back(*block);
+				placed[*block] = true;
+
+				std::optional<IRBlockId> next;
+				uint64_t next_count = 0;
+				for (const IRBlockId successor : m_function->GetSuccessors(*block))
+				{
+					const uint64_t count = GetEdgeCount(*m_function, profile, *block, successor);
+					if (!placed[successor] && (!next || count > next_count))
+					{
+						next = successor;
+						next_count = count;
+					}
+				}
+
+				// Otherwise carry on from the first block left in reverse post-order
+				for (; !next && order_index < order.size(); ++order_index)
+				{
+					if (!placed[order[order_index]])
+					{
+						next = order[order_index];
+					}
+				}
+
+				block = next;
+			}
+
+			return layout;
+		}
+
+		void AssignLocations()
+		{
+			const IRFunction& function = *m_function;
+			const std::vector<uint32_t> use_counts = function.ComputeUseCounts();
+
+			// The single user of each value, where it has exactly one
+			std::vector<std::optional<IRValueId>> single_user(function.GetInstructionCount());
+			for (IRBlockId block = 0; block < function.GetBlockCount(); ++block)
+			{
+				for (const IRValueId value : function.GetBlock(block).instructions)
+				{
+					for (const IRValueId operand : function.GetInstruction(value).operands)
+					{
+						single_user[operand] = value;
+					}
+				}
+			}
+
+			m_locations.assign(function.GetInstructionCount(), ValueLocation::None);
+			m_frame_indices.assign(function.GetInstructionCount(), -1);
+			m_slot_count = 0;
+
+			const int32_t parameter_count = static_cast<int32_t>(function.GetParameterTypes().size());
+
+			for (IRBlockId block = 0; block < function.GetBlockCount(); ++block)
+			{
+				for (const IRValueId value : function.GetBlock(block).instructions)
+				{
+					const IRInstruction& instruction = function.GetInstruction(value);
+
+					if (IsTerminator(instruction.opcode))
+					{
+						continue;
+					}
+
+					if (instruction.opcode == IROpCode::Const)
+					{
+						m_locations[value] = ValueLocation::Constant;
+						continue;
+					}
+
+					if (instruction.opcode == IROpCode::Param)
+					{
+						m_locations[value] = ValueLocation::Frame;
+						m_frame_indices[value] = instruction.immediate;
+						continue;
+					}
+
+					if (use_counts[value] == 0)
+					{
+						m_locations[value] = HasSideEffects(instruction.opcode) ? ValueLocation::Discarded : ValueLocation::None;
+						continue;
+					}
+
+					if (use_counts[value] == 1 && !HasSideEffects(instruction.opcode) && instruction.opcode != IROpCode::Phi)
+					{
+						const IRInstruction& user = function.GetInstruction(*single_user[value]);
+						if (user.block == instruction.block && user.opcode != IROpCode::Phi)
+						{
+							m_locations[value] = ValueLocation::Deferred;
+							continue;
+						}
+					}
+
+					m_locations[value] = ValueLocation::Frame;
+					m_frame_indices[value] = parameter_count + m_slot_count++;
+				}
+			}
+		}
+
+		bool GenerateBlock(IRBlockId block, std::optional<IRBlockId> next_block)
+		{
+			for (const IRValueId value : m_function->GetBlock(block).instructions)
+			{
+				const IRInstruction& instruction = m_function->GetInstruction(value);
+
+				switch (instruction.opcode)
+				{
+					case IROpCode::Return:
+					{
+						EmitValue(instruction.operands[0]);
+						EmitReturn();
+						break;
+					}
+					case IROpCode::Branch:
+					{
+						EmitEdge(block, instruction.targets[0], next_block);
+						break;
+					}
+					case IROpCode::CondBranch:
+					{
+						const IRBlockId if_true = instruction.targets[0];
+						const IRBlockId if_false = instruction.targets[1];
+
+						// A comparison used only by this branch is fused with it (e.g. cmp.lt + condbr => JGE)
+						const std::optional<VMOpCode> comparison = GetFusableComparison(instruction.operands[0]);
+						if (comparison)
+						{
+							for (const IRValueId operand : m_function->GetInstruction(instruction.operands[0]).operands)
+							{
+								if (!EmitValue(operand))
+								{
+									return false;
+								}
+							}
+
+							// Branch on the comparison holding and fall through to the false side instead
+							if (if_false == next_block && !HasPhis(if_false))
+							{
+								const VMInstructionHandle jump = Emit(*VMInstruction::JumpIf(*comparison, 0));
+								AddEdgeFixup(*jump.operand_offset, block, if_true);
+								m_branch_sites.push_back({ m_function_id, block, jump.opcode_offset, 0 });
+								break;
+							}
+
+							const VMInstructionHandle jump = Emit(*VMInstruction::JumpIfNot(*comparison, 0));
+							AddEdgeFixup(*jump.operand_offset, block, if_false);
+							m_branch_sites.push_back({ m_function_id, block, jump.opcode_offset, 1 });
+						}
+						else
+						{
+							EmitValue(instruction.operands[0]);
+
+							const VMInstructionHandle jump = Emit(VMInstruction::JZ(0));
+							AddEdgeFixup(*jump.operand_offset, block, if_false);
+							m_branch_sites.push_back({ m_function_id, block, jump.opcode_offset, 1 });
+						}
+
+						if (!HasPhis(if_true) && if_true == next_block)
+						{
+							break;
+						}
+
+						const VMInstructionHandle address = Emit(VMInstruction::PUSH(0));
+						AddEdgeFixup(*address.operand_offset, block, instruction.targets[0]);
+						Emit(VMInstruction::JMP());
+						break;
+					}
+					case IROpCode::Phi:
+					case IROpCode::Param:
+					case IROpCode::Const:
+					{
+						break;
+					}
+					default:
+					{
+						switch (m_locations[value])
+						{
+							case ValueLocation::Frame:
+							{
+								if (!EmitOperation(value))
+								{
+									return false;
+								}
+								StoreTop(m_frame_indices[value]);
+								break;
+							}
+							case ValueLocation::Discarded:
+							{
+								if (!EmitOperation(value))
+								{
+									return false;
+								}
+								Emit(VMInstruction::POP(1));
+								break;
+							}
+							default:
+							{
+								break;
+							}
+						}
+						break;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		std::optional<VMOpCode> GetFusableComparison(IRValueId condition) const
+		{
+			if (m_locations[condition] != ValueLocation::Deferred)
+			{
+				return std::nullopt;
+			}
+
+			switch (m_function->GetInstruction(condition).opcode)
+			{
+				case IROpCode::CmpLt: return VMOpCode::LT;
+				case IROpCode::CmpLe: return VMOpCode::LE;
+				case IROpCode::CmpGt: return VMOpCode::GT;
+				case IROpCode::CmpGe: return VMOpCode::GE;
+				case IROpCode::CmpEq: return VMOpCode::EQ;
+				case IROpCode::CmpNe: return VMOpCode::NE;
+				default: return std::nullopt;
+			}
+		}
+
+		// Pushes the value on top of the operand stack
+		bool EmitValue(IRValueId value)
+		{
+			const IRInstruction& instruction = m_function->GetInstruction(value);
+
+			switch (m_locations[value])
+			{
+				case ValueLocation::Constant:
+				{
+					Emit(VMInstruction::PUSH(instruction.immediate));
+					return true;
+				}
+				case ValueLocation::Frame:
+				{
+					Emit(VMInstruction::DUP(m_depth - 1 - m_frame_indices[value]));
+					return true;
+				}
+				case ValueLocation::Deferred:
+				{
+					return EmitOperation(value);
+				}
+				default:
+				{
+					std::println("Value %{} has no location", value);
+					return false;
+				}
+			}
+		}
+
+		bool EmitOperation(IRValueId value)
+		{
+			const IRInstruction& instruction = m_function->GetInstruction(value);
+
+			if (instruction.opcode == IROpCode::Call)
+			{
+				return EmitCall(instruction);
+			}
+
+			for (const IRValueId operand : instruction.operands)
+			{
+				if (!EmitValue(operand))
+				{
+					return false;
+				}
+			}
+
+			switch (instruction.opcode)
+			{
+				case IROpCode::Neg: Emit(VMInstruction::NEGATE()); break;
+				case IROpCode::Not: Emit(VMInstruction::NOT()); break;
+				case IROpCode::Add: Emit(VMInstruction::ADD()); break;
+				case IROpCode::Sub: Emit(VMInstruction::SUB()); break;
+				case IROpCode::Mul: Emit(VMInstruction::MUL()); break;
+				case IROpCode::Div: Emit(VMInstruction::DIV()); break;
+				case IROpCode::Mod: Emit(VMInstruction::MOD()); break;
+				case IROpCode::CmpLt: Emit(VMInstruction::LT()); break;
+				case IROpCode::CmpLe: Emit(VMInstruction::LE()); break;
+				case IROpCode::CmpGt: Emit(VMInstruction::GT()); break;
+				case IROpCode::CmpGe: Emit(VMInstruction::GE()); break;
+				case IROpCode::CmpEq: Emit(VMInstruction::EQ()); break;
+				case IROpCode::CmpNe: Emit(VMInstruction::NE()); break;
+				default:
+				{
+					std::println("No bytecode for IR instruction '{}'", IROpCodeToString(instruction.opcode));
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Calling convention: [..., return_addr, arg_0, ..., arg_n] then jump to the callee,
+		// which leaves [..., return_value] behind when it returns.
+		bool EmitCall(const IRInstruction& instruction)
+		{
+			const VMInstructionHandle return_address = Emit(VMInstruction::PUSH(0));
+
+			for (const IRValueId argument : instruction.operands)
+			{
+				if (!EmitValue(argument))
+				{
+					return false;
+				}
+			}
+
+			const IRFunctionId callee = static_cast<IRFunctionId>(instruction.immediate);
+			EmitFunctionAddress(callee);
+			m_call_sites.push_back({ m_function_id, callee, Emit(VMInstruction::JMP()).opcode_offset });
+
+			// The callee consumes the arguments and the return address, then pushes its result
+			m_depth -= static_cast<int32_t>(instruction.operands.size());
+
+			PatchOperand(return_address, GetNextInstructionOffset());
+			return true;
+		}
+
+		void EmitReturn()
+		{
+			// The data stack looks like this, where x, y, z is the rest of the frame:
+			//
+			// offset:  n            ...        0
+			// stack:  [..., return_addr, x, y, z, return_value ]
+			//
+			// we want to transform it into [..., return_value, return_addr ] and then call JMP
+
+			const int32_t frame_entries = m_depth - 1;
+			if (frame_entries > 0)
+			{
+				Emit(VMInstruction::SWAP(frame_entries));
+				Emit(VMInstruction::POP(frame_entries));
+			}
+
+			Emit(VMInstruction::SWAP(1));
+			Emit(VMInstruction::JMP());
+		}
+
+		// Moves the values flowing into the phis of 'to' and then jumps there
+		void EmitEdge(IRBlockId from, IRBlockId to, std::optional<IRBlockId> next_block)
+		{
+			std::vector<IRValueId> phis;
+			for (const IRValueId value : m_function->GetBlock(to).instructions)
+			{
+				const IRInstruction& phi = m_function->GetInstruction(value);
+				if (phi.opcode != IROpCode::Phi)
+				{
+					break;
+				}
+
+				// Phis that are never used have no slot, e.g. in IR that has not been through DCE
+				if (m_locations[value] != ValueLocation::Frame)
+				{
+					continue;
+				}
+
+				for (size_t i = 0; i < phi.targets.size(); ++i)
+				{
+					if (phi.targets[i] == from)
+					{
+						EmitValue(phi.operands[i]);
+						phis.push_back(value);
+						break;
+					}
+				}
+			}
+
+			// All inputs are pushed before any phi is written, so this behaves as a parallel copy
+			for (auto phi = phis.rbegin(); phi != phis.rend(); ++phi)
+			{
+				StoreTop(m_frame_indices[*phi]);
+			}
+
+			if (to != next_block)
+			{
+				const VMInstructionHandle address = Emit(VMInstruction::PUSH(0));
+				m_block_fixups.push_back({ static_cast<size_t>(*address.operand_offset), to });
+				Emit(VMInstruction::JMP());
+			}
+		}
+
+		// Jumps along a conditional edge either go straight to the block or, if the
+		// block has phis, to a stub that performs the copies first
+		void AddEdgeFixup(size_t operand_offset, IRBlockId from, IRBlockId to)
+		{
+			if (!HasPhis(to))
+			{
+				m_block_fixups.push_back({ operand_offset, to });
+				return;
+			}
+
+			for (EdgeStub& stub : m_edge_stubs)
+			{
+				if (stub.from == from && stub.to == to)
+				{
+					stub.operand_offsets.push_back(operand_offset);
+					return;
+				}
+			}
+
+			m_edge_stubs.push_back({ from, to, { operand_offset } });
+		}
+
+		bool HasPhis(IRBlockId block) const
+		{
+			const std::vector<IRValueId>& instructions = m_function->GetBlock(block).instructions;
+			return !instructions.empty() && m_function->GetInstruction(instructions.front()).opcode == IROpCode::Phi;
+		}
+
+		void StoreTop(int32_t frame_index)
+		{
+			// [..., k, ..., e ] where k is the slot and e is its new value
+			assert(frame_index >= 0 && frame_index < GetFrameSize());
+			Emit(VMInstruction::SWAP(m_depth - 1 - frame_index));
+			Emit(VMInstruction::POP(1));
+		}
+
+		// Calls 'entry' and halts once it returns
+		void GenerateEntry(IRFunctionId entry, std::span<const int32_t> arguments)
+		{
+			assert(m_module.GetFunction(entry).GetParameterTypes().size() == arguments.size());
+
+			const VMInstructionHandle return_address = Emit(VMInstruction::PUSH(0));
+			for (const int32_t argument : arguments)
+			{
+				Emit(VMInstruction::PUSH(argument));
+			}
+			EmitFunctionAddress(entry);
+			m_call_sites.push_back({ std::nullopt, entry, Emit(VMInstruction::JMP()).opcode_offset });
+			PatchOperand(return_address, GetNextInstructionOffset());
+			Emit(VMInstruction::HALT());
+		}
+
+		void ResolveCallFixups()
+		{
+			for (const auto& [operand_offset, function] : m_call_fixups)
+			{
+				assert(m_function_offsets[function] >= 0);
+				m_instructions[operand_offset] = m_function_offsets[function];
+			}
+			m_call_fixups.clear();
+		}
+
+		void EmitFunctionAddress(IRFunctionId function)
+		{
+			const VMInstructionHandle handle = Emit(VMInstruction::PUSH(0));
+			m_call_fixups.push_back({ static_cast<size_t>(*handle.operand_offset), function });
+		}
+
+		int32_t GetFrameSize() const
+		{
+			return static_cast<int32_t>(m_function->GetParameterTypes().size()) + m_slot_count;
+		}
+
+		VMInstructionHandle Emit(VMInstruction instruction)
+		{
+			VMInstructionHandle handle;
+
+			handle.opcode_offset = GetNextInstructionOffset();
+			m_instructions.push_back(static_cast<int32_t>(instruction.GetOpcode()));
+
+			if (const std::optional<int32_t> operand = instruction.GetOperand())
+			{
+				handle.operand_offset = GetNextInstructionOffset();
+				m_instructions.push_back(*operand);
+			}
+
+			m_depth += instruction.GetScopeSizeDelta();
+
+			return handle;
+		}
+
+		void PatchOperand(const VMInstructionHandle& handle, int32_t operand)
+		{
+			m_instructions[*handle.operand_offset] = operand;
+		}
+
+		int32_t GetNextInstructionOffset() const
+		{
+			return static_cast<int32_t>(m_instructions.size());
+		}
+
+	private:
+		struct EdgeStub
+		{
+			IRBlockId from;
+			IRBlockId to;
+			std::vector<size_t> operand_offsets;
+		};
+
+		// The JMP of each call, where the caller is empty for the entry stub's call
+		struct CallSite
+		{
+			std::optional<IRFunctionId> caller;
+			IRFunctionId callee;
+			int32_t opcode_offset;
+		};
+
+		// The conditional jump ending a block, and which of the block's targets it jumps to
+		struct BranchSite
+		{
+			IRFunctionId function;
+			IRBlockId block;
+			int32_t opcode_offset;
+			size_t jump_target;
+		};
+
+		const IRModule& m_module;
+		const IRExecutionProfile* m_profile = nullptr;
+		std::vector<int32_t> m_instructions;
+		std::vector<int32_t> m_function_offsets;
+		std::vector<std::pair<size_t, IRFunctionId>> m_call_fixups;
+		std::vector<CallSite> m_call_sites;
+		std::vector<BranchSite> m_branch_sites;
+		std::vector<ColdBlocks> m_cold_blocks;
+
+		// Per function state
+		IRFunctionId m_function_id = 0;
+		const IRFunction* m_function = nullptr;
+		std::vector<ValueLocation> m_locations;
+		std::vector<int32_t> m_frame_indices;
+		int32_t m_slot_count = 0;
+		int32_t m_depth = 0;
+		std::vector<int32_t> m_block_offsets;
+		std::vector<std::pair<size_t, IRBlockId>> m_block_fixups;
+		std::vector<EdgeStub> m_edge_stubs;
+	};
+
+	namespace
+	{
+		std::optional<IRFunctionId> FindEntry(const IRModule& module)
+		{
+			const std::optional<IRFunctionId> main = module.FindFunction("main");
+			if (!main)
+			{
+				std::println("Failed to compile program: no 'main' function");
+				return std::nullopt;
+			}
+
+			if (!module.GetFunction(*main).GetParameterTypes().empty())
+			{
+				std::println("'main' must not take any parameters");
+				return std::nullopt;
+			}
+
+			return main;
+		}
+	}
+
+	std::optional<VMProgram> GenerateProgram(const IRModule& module)
+	{
+		const std::optional<IRFunctionId> main = FindEntry(module);
+		if (!main)
+		{
+			return std::nullopt;
+		}
+
+		IRCodeGen codegen(module);
+		if (!codegen.Generate(*main, {}))
+		{
+			std::println("Failed to generate bytecode from IR");
+			return std::nullopt;
+		}
+
+		return VMProgram(codegen.TakeInstructions());
+	}
+
+	std::optional<VMProgram> GenerateProgram(const IRModule& module, const VMProfile& profile)
+	{
+		const std::optional<IRFunctionId> main = FindEntry(module);
+		if (!main)
+		{
+			return std::nullopt;
+		}
+
+		// Generate the program the profile was collected from to attribute its counts to the IR
+		IRCodeGen profiled_codegen(module);
+		if (!profiled_codegen.Generate(*main, {}))
+		{
+			std::println("Failed to generate bytecode from IR");
+			return std::nullopt;
+		}
+
+		const IRExecutionProfile execution_profile = profiled_codegen.MapProfile(profile);
+
+		IRCodeGen codegen(module, &execution_profile);
+		if (!codegen.Generate(*main, {}))
+		{
+			std::println("Failed to generate bytecode from IR");
+			return std::nullopt;
+		}
+
+		return VMProgram(codegen.TakeInstructions());
+	}
+
+	IREvaluator::IREvaluator(const IRModule& module)
+		: m_codegen(std::make_unique<IRCodeGen>(module))
+	{
+	}
+
+	IREvaluator::~IREvaluator() = default;
+
+	std::optional<int32_t> IREvaluator::Evaluate(IRFunctionId function, std::span<const int32_t> arguments, size_t& fuel)
+	{
+		if (!m_codegen)
+		{
+			return std::nullopt;
+		}
+
+		// A function that failed may have been partly generated, so nothing more can be run
+		if (!m_codegen->GenerateReachableFunctions(function))
+		{
+			std::println("Failed to generate bytecode from IR");
+			m_codegen.reset();
+			return std::nullopt;
+		}
+
+		return m_codegen->Evaluate(function, arguments, fuel);
+	}
+}
\ No newline at end of file
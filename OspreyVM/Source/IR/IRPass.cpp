@@ -0,0 +1,77 @@
+#include "OspreyVM/IR/IRPass.h"
+
+#include "OspreyVM/IR/Passes/ConstantFolding.h"
+#include "OspreyVM/IR/Passes/AlgebraicSimplification.h"
+#include "OspreyVM/IR/Passes/GlobalValueNumbering.h"
+#include "OspreyVM/IR/Passes/LoopInvariantCodeMotion.h"
+#include "OspreyVM/IR/Passes/DeadCodeElimination.h"
+#include "OspreyVM/IR/Passes/JumpThreading.h"
+#include "OspreyVM/IR/Passes/CallEvaluation.h"
+#include "OspreyVM/VMCompiler.h"
+
+#include <cassert>
+#include <print>
+
+namespace Osprey
+{
+	bool IRPass::Run(IRModule& module)
+	{
+		bool changed = false;
+
+		for (IRFunction& function : module.GetFunctions())
+		{
+			changed |= RunOnFunction(function);
+		}
+
+		return changed;
+	}
+
+	void IRPassManager::AddPass(std::unique_ptr<IRPass> pass)
+	{
+		m_passes.push_back(std::move(pass));
+	}
+
+	void IRPassManager::Run(IRModule& module) const
+	{
+		for (size_t iteration = 0; iteration < m_max_iterations; ++iteration)
+		{
+			bool changed = false;
+
+			for (const std::unique_ptr<IRPass>& pass : m_passes)
+			{
+				const bool pass_changed = pass->Run(module);
+				changed |= pass_changed;
+
+				if (m_verbose && pass_changed)
+				{
+					std::println("; after {} (iteration {})", pass->GetName(), iteration);
+					module.Dump();
+				}
+
+				assert(module.Verify());
+			}
+
+			if (!changed)
+			{
+				break;
+			}
+		}
+	}
+
+	IRPassManager IRPassManager::CreateDefaultPipeline(const VMCompileOptions& options)
+	{
+		IRPassManager pass_manager;
+		pass_manager.AddPass(std::make_unique<ConstantFoldingPass>());
+		if (options.evaluation_fuel > 0)
+		{
+			pass_manager.AddPass(std::make_unique<CallEvaluationPass>(options.evaluation_fuel, options.evaluation_budget));
+		}
+		pass_manager.AddPass(std::make_unique<JumpThreadingPass>());
+		pass_manager.AddPass(std::make_unique<AlgebraicSimplificationPass>());
+		pass_manager.AddPass(std::make_unique<GlobalValueNumberingPass>());
+		pass_manager.AddPass(std::make_unique<LoopInvariantCodeMotionPass>());
+		pass_manager.AddPass(std::make_unique<DeadCodeEliminationPass>());
+		pass_manager.AddPass(std::make_unique<DeadFunctionEliminationPass>());
+		return pass_manager;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "OspreyVM/IR/Passes/AlgebraicSimplification.h"
+
+namespace Osprey
+{
+	namespace
+	{
+		std::optional<int32_t> GetConstant(const IRFunction& function, IRValueId value)
+		{
+			const IRInstruction& instruction = function.GetInstruction(value);
+			if (instruction.opcode == IROpCode::Const)
+			{
+				return instruction.immediate;
+			}
+			return std::nullopt;
+		}
+
+		void MakeConstant(IRInstruction& instruction, int32_t value)
+		{
+			instruction.opcode = IROpCode::Const;
+			instruction.immediate = value;
+			instruction.operands.clear();
+		}
+
+		void MakeUnary(IRInstruction& instruction, IROpCode opcode, IRValueId operand)
+		{
+			instruction.opcode = opcode;
+			instruction.operands = { operand };
+		}
+
+		// Either the value the instruction is equivalent to, or std::nullopt if it was
+		// rewritten in place (or left alone, in which case 'changed' is not set)
+		std::optional<IRValueId> Simplify(IRFunction& function, IRValueId value, bool& changed)
+		{
+			IRInstruction& instruction = function.GetInstruction(value);
+
+			if (IsUnaryOp(instruction.opcode))
+			{
+				const IRInstruction& operand = function.GetInstruction(instruction.operands[0]);
+
+				// -(-x) => x
+				if (instruction.opcode == IROpCode::Neg && operand.opcode == IROpCode::Neg)
+				{
+					return operand.operands[0];
+				}
+
+				// !!x => x, only when x is already a bool
+				if (instruction.opcode == IROpCode::Not && operand.opcode == IROpCode::Not && function.GetInstruction(operand.operands[0]).type == IRType::Bool)
+				{
+					return operand.operands[0];
+				}
+
+				return std::nullopt;
+			}
+
+			if (!IsBinaryOp(instruction.opcode))
+			{
+				return std::nullopt;
+			}
+
+			const IRValueId left = instruction.operands[0];
+			const IRValueId right = instruction.operands[1];
+			const std::optional<int32_t> left_constant = GetConstant(function, left);
+			const std::optional<int32_t> right_constant = GetConstant(function, right);
+
+			if (left == right)
+			{
+				switch (instruction.opcode)
+				{
+					case IROpCode::Sub:
+					case IROpCode::CmpLt:
+					case IROpCode::CmpGt:
+					case IROpCode::CmpNe:
+					{
+						MakeConstant(instruction, 0);
+						changed = true;
+						return std::nullopt;
+					}
+					case IROpCode::CmpLe:
+					case IROpCode::CmpGe:
+					case IROpCode::CmpEq:
+					{
+						MakeConstant(instruction, 1);
+						changed = true;
+						return std::nullopt;
+					}
+					default:
+					{
+						break;
+					}
+				}
+			}
+
+			switch (instruction.opcode)
+			{
+				case IROpCode::Add:
+				{
+					// x + 0 => x
+					if (right_constant == 0)
+					{
+						return left;
+					}
+					if (left_constant == 0)
+					{
+						return right;
+					}
+					break;
+				}
+				case IROpCode::Sub:
+				{
+					// x - 0 => x
+					if (right_constant == 0)
+					{
+						return left;
+					}
+					// 0 - x => -x
+					if (left_constant == 0)
+					{
+						MakeUnary(instruction, IROpCode::Neg, right);
+						changed = true;
+					}
+					break;
+				}
+				case IROpCode::Mul:
+				{
+					// x * 1 => x
+					if (right_constant == 1)
+					{
+						return left;
+					}
+					if (left_constant == 1)
+					{
+						return right;
+					}
+					// x * 0 => 0, neither operand has side effects of its own
+					if (right_constant == 0 || left_constant == 0)
+					{
+						MakeConstant(instruction, 0);
+						changed = true;
+						break;
+					}
+					// x * -1 => -x
+					if (right_constant == -1)
+					{
+						MakeUnary(instruction, IROpCode::Neg, left);
+						changed = true;
+					}
+					else if (left_constant == -1)
+					{
+						MakeUnary(instruction, IROpCode::Neg, right);
+						changed = true;
+					}
+					break;
+				}
+				case IROpCode::Div:
+				{
+					// x / 1 => x
+					if (right_constant == 1)
+					{
+						return left;
+					}
+					// x / -1 => -x, both wrap for the most negative value
+					if (right_constant == -1)
+					{
+						MakeUnary(instruction, IROpCode::Neg, left);
+						changed = true;
+					}
+					break;
+				}
+				case IROpCode::Mod:
+				{
+					// x % 1 => 0 and x % -1 => 0
+					if (right_constant == 1 || right_constant == -1)
+					{
+						MakeConstant(instruction, 0);
+						changed = true;
+					}
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+
+			return std::nullopt;
+		}
+	}
+
+	bool AlgebraicSimplificationPass::RunOnFunction(IRFunction& function)
+	{
+		bool changed = false;
+
+		std::unordered_map<IRValueId, IRValueId> replacements;
+
+		for (const IRBlockId block : function.ComputeReversePostOrder())
+		{
+			for (const IRValueId value : function.GetBlock(block).instructions)
+			{
+				IRInstruction& instruction = function.GetInstruction(value);
+
+				// Apply earlier replacements so identities can chain, e.g. (x + 0) * 1
+				if (instruction.opcode != IROpCode::Phi)
+				{
+					for (IRValueId& operand : instruction.operands)
+					{
+						const auto found = replacements.find(operand);
+						if (found != replacements.end())
+						{
+							operand = found->second;
+						}
+					}
+				}
+
+				const std::optional<IRValueId> replacement = Simplify(function, value, changed);
+				if (replacement)
+				{
+					replacements[value] = *replacement;
+				}
+			}
+		}
+
+		if (replacements.empty())
+		{
+			return changed;
+		}
+
+		function.ReplaceAllUsesWith(replacements);
+
+		for (const auto& [value, replacement] : replacements)
+		{
+			function.Erase(value);
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "OspreyVM/IR/Passes/CallEvaluation.h"
+
+#include "OspreyVM/IR/IRCodeGen.h"
+
+#include <algorithm>
+
+namespace Osprey
+{
+	bool CallEvaluationPass::Run(IRModule& module)
+	{
+		bool changed = false;
+
+		// Only the functions the evaluated calls can reach are generated, once for this run
+		IREvaluator evaluator(module);
+
+		for (IRFunction& function : module.GetFunctions())
+		{
+			for (IRValueId value = 0; value < function.GetInstructionCount(); ++value)
+			{
+				const IRInstruction& call = function.GetInstruction(value);
+				if (call.removed || call.opcode != IROpCode::Call)
+				{
+					continue;
+				}
+
+				std::vector<int32_t> arguments;
+				for (const IRValueId operand : call.operands)
+				{
+					const IRInstruction& argument = function.GetInstruction(operand);
+					if (argument.opcode != IROpCode::Const)
+					{
+						break;
+					}
+					arguments.push_back(argument.immediate);
+				}
+
+				if (arguments.size() != call.operands.size())
+				{
+					continue;
+				}
+
+				const IRFunctionId callee = static_cast<IRFunctionId>(call.immediate);
+				std::pair<std::string, std::vector<int32_t>> key(module.GetFunction(callee).GetName(), std::move(arguments));
+				auto it = m_results.find(key);
+				if (it == m_results.end())
+				{
+					// Once the budget is spent calls are left as they are, rather than
+					// remembered as failed
+					const size_t call_fuel = std::min(m_fuel, m_budget);
+					if (call_fuel == 0)
+					{
+						continue;
+					}
+
+					size_t remaining_fuel = call_fuel;
+					const std::optional<int32_t> result = evaluator.Evaluate(callee, key.second, remaining_fuel);
+					m_budget -= call_fuel - remaining_fuel;
+
+					it = m_results.emplace(std::move(key), result).first;
+				}
+
+				if (!it->second)
+				{
+					continue;
+				}
+
+				IRInstruction& instruction = function.GetInstruction(value);
+				instruction.opcode = IROpCode::Const;
+				instruction.immediate = *it->second;
+				instruction.operands.clear();
+				changed = true;
+			}
+		}
+
+		return changed;
+	}
+}
\ No newline at end of file
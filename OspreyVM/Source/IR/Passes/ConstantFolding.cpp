@@ -0,0 +1,139 @@
+#include "OspreyVM/IR/Passes/ConstantFolding.h"
+
+#include <array>
+
+namespace Osprey
+{
+	namespace
+	{
+		std::optional<int32_t> GetConstant(const IRFunction& function, IRValueId value)
+		{
+			const IRInstruction& instruction = function.GetInstruction(value);
+			if (instruction.opcode == IROpCode::Const)
+			{
+				return instruction.immediate;
+			}
+			return std::nullopt;
+		}
+
+		bool FoldOperation(IRFunction& function, IRValueId value)
+		{
+			IRInstruction& instruction = function.GetInstruction(value);
+
+			std::array<int32_t, 2> constants = {};
+			for (size_t i = 0; i < instruction.operands.size(); ++i)
+			{
+				const std::optional<int32_t> constant = GetConstant(function, instruction.operands[i]);
+				if (!constant)
+				{
+					return false;
+				}
+				constants[i] = *constant;
+			}
+
+			const std::optional<int32_t> result = EvaluateIROp(instruction.opcode, std::span(constants.data(), instruction.operands.size()));
+			if (!result)
+			{
+				// Leave operations that would trap for the VM to report
+				return false;
+			}
+
+			instruction.opcode = IROpCode::Const;
+			instruction.immediate = *result;
+			instruction.operands.clear();
+			return true;
+		}
+
+		bool FoldTrivialPhi(IRFunction& function, IRValueId value)
+		{
+			const IRInstruction& phi = function.GetInstruction(value);
+
+			std::optional<IRValueId> same;
+			for (const IRValueId operand : phi.operands)
+			{
+				if (operand == value || operand == same)
+				{
+					continue;
+				}
+				if (same)
+				{
+					return false;
+				}
+				same = operand;
+			}
+
+			if (!same)
+			{
+				return false;
+			}
+
+			function.ReplaceAllUsesWith(value, *same);
+			function.Erase(value);
+			return true;
+		}
+
+		bool FoldBranch(IRFunction& function, IRBlockId block, IRValueId value)
+		{
+			IRInstruction& branch = function.GetInstruction(value);
+
+			const std::optional<int32_t> condition = GetConstant(function, branch.operands[0]);
+			if (!condition)
+			{
+				return false;
+			}
+
+			const IRBlockId taken = *condition != 0 ? branch.targets[0] : branch.targets[1];
+			const IRBlockId not_taken = *condition != 0 ? branch.targets[1] : branch.targets[0];
+
+			if (taken == not_taken)
+			{
+				branch.opcode = IROpCode::Branch;
+				branch.operands.clear();
+				branch.targets = { taken };
+			}
+			else
+			{
+				function.RemoveEdge(block, not_taken);
+			}
+
+			return true;
+		}
+	}
+
+	bool ConstantFoldingPass::RunOnFunction(IRFunction& function)
+	{
+		bool changed = false;
+		bool cfg_changed = false;
+
+		for (const IRBlockId block : function.ComputeReversePostOrder())
+		{
+			// Copy, as folding phis unlinks instructions from the block
+			const std::vector<IRValueId> instructions = function.GetBlock(block).instructions;
+
+			for (const IRValueId value : instructions)
+			{
+				const IROpCode opcode = function.GetInstruction(value).opcode;
+
+				if (IsUnaryOp(opcode) || IsBinaryOp(opcode))
+				{
+					changed |= FoldOperation(function, value);
+				}
+				else if (opcode == IROpCode::Phi)
+				{
+					changed |= FoldTrivialPhi(function, value);
+				}
+				else if (opcode == IROpCode::CondBranch)
+				{
+					cfg_changed |= FoldBranch(function, block, value);
+				}
+			}
+		}
+
+		if (cfg_changed)
+		{
+			function.RemoveUnreachableBlocks();
+		}
+
+		return changed || cfg_changed;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "OspreyVM/IR/Passes/DeadCodeElimination.h"
+
+#include <algorithm>
+
+namespace Osprey
+{
+	bool DeadCodeEliminationPass::RunOnFunction(IRFunction& function)
+	{
+		std::vector<bool> live(function.GetInstructionCount(), false);
+		std::vector<IRValueId> worklist;
+
+		for (const IRBlockId block : function.ComputeReversePostOrder())
+		{
+			for (const IRValueId value : function.GetBlock(block).instructions)
+			{
+				if (HasSideEffects(function, function.GetInstruction(value)))
+				{
+					live[value] = true;
+					worklist.push_back(value);
+				}
+			}
+		}
+
+		while (!worklist.empty())
+		{
+			const IRValueId value = worklist.back();
+			worklist.pop_back();
+
+			for (const IRValueId operand : function.GetInstruction(value).operands)
+			{
+				if (!live[operand])
+				{
+					live[operand] = true;
+					worklist.push_back(operand);
+				}
+			}
+		}
+
+		bool changed = false;
+
+		for (IRBlockId block = 0; block < function.GetBlockCount(); ++block)
+		{
+			// Copy, as erasing unlinks instructions from the block
+			const std::vector<IRValueId> instructions = function.GetBlock(block).instructions;
+
+			for (const IRValueId value : instructions)
+			{
+				if (!live[value])
+				{
+					function.Erase(value);
+					changed = true;
+				}
+			}
+		}
+
+		return changed;
+	}
+
+	bool DeadFunctionEliminationPass::Run(IRModule& module)
+	{
+		const std::optional<IRFunctionId> main = module.FindFunction("main");
+		if (!main)
+		{
+			return false;
+		}
+
+		std::vector<bool> reachable(module.GetFunctions().size(), false);
+		std::vector<IRFunctionId> worklist = { *main };
+		reachable[*main] = true;
+
+		while (!worklist.empty())
+		{
+			const IRFunction& function = module.GetFunction(worklist.back());
+			worklist.pop_back();
+
+			for (IRValueId value = 0; value < function.GetInstructionCount(); ++value)
+			{
+				const IRInstruction& instruction = function.GetInstruction(value);
+				if (instruction.removed || instruction.opcode != IROpCode::Call)
+				{
+					continue;
+				}
+
+				const IRFunctionId callee = static_cast<IRFunctionId>(instruction.immediate);
+				if (!reachable[callee])
+				{
+					reachable[callee] = true;
+					worklist.push_back(callee);
+				}
+			}
+		}
+
+		if (std::ranges::find(reachable, false) == reachable.end())
+		{
+			return false;
+		}
+
+		module.RemoveFunctions(reachable);
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "OspreyVM/IR/Passes/GlobalValueNumbering.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+namespace Osprey
+{
+	namespace
+	{
+		struct ValueKey
+		{
+			IROpCode opcode = IROpCode::Const;
+			IRType type = IRType::Void;
+			int32_t immediate = 0;
+			IRBlockId block = 0; // phis are only equivalent to phis in the same block
+			std::vector<IRValueId> operands;
+			std::vector<IRBlockId> targets;
+
+			bool operator==(const ValueKey&) const = default;
+		};
+
+		struct ValueKeyHash
+		{
+			size_t operator()(const ValueKey& key) const
+			{
+				size_t hash = std::hash<uint32_t>()((static_cast<uint32_t>(key.opcode) << 8) | static_cast<uint32_t>(key.type));
+
+				const auto Combine = [&hash](uint32_t value)
+					{
+						hash ^= std::hash<uint32_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+					};
+
+				Combine(static_cast<uint32_t>(key.immediate));
+				Combine(key.block);
+				for (const IRValueId operand : key.operands)
+				{
+					Combine(operand);
+				}
+				for (const IRBlockId target : key.targets)
+				{
+					Combine(target);
+				}
+
+				return hash;
+			}
+		};
+
+		bool IsNumberable(IROpCode opcode)
+		{
+			// Division and modulo may trap, but an equivalent dominating instruction
+			// would already have trapped, so reusing its value is still safe.
+			return opcode == IROpCode::Const
+				|| opcode == IROpCode::Param
+				|| opcode == IROpCode::Phi
+				|| IsUnaryOp(opcode)
+				|| IsBinaryOp(opcode);
+		}
+
+		ValueKey MakeKey(const IRInstruction& instruction)
+		{
+			ValueKey key;
+			key.opcode = instruction.opcode;
+			key.type = instruction.type;
+			key.immediate = instruction.immediate;
+			key.operands = instruction.operands;
+
+			switch (key.opcode)
+			{
+				case IROpCode::Add:
+				case IROpCode::Mul:
+				case IROpCode::CmpEq:
+				case IROpCode::CmpNe:
+				{
+					if (key.operands[0] > key.operands[1])
+					{
+						std::swap(key.operands[0], key.operands[1]);
+					}
+					break;
+				}
+				// a > b is b < a, and a >= b is b <= a
+				case IROpCode::CmpGt:
+				{
+					key.opcode = IROpCode::CmpLt;
+					std::swap(key.operands[0], key.operands[1]);
+					break;
+				}
+				case IROpCode::CmpGe:
+				{
+					key.opcode = IROpCode::CmpLe;
+					std::swap(key.operands[0], key.operands[1]);
+					break;
+				}
+				case IROpCode::Phi:
+				{
+					// Inputs are matched by incoming block, regardless of the order they were added in
+					std::vector<std::pair<IRBlockId, IRValueId>> inputs;
+					for (size_t i = 0; i < instruction.operands.size(); ++i)
+					{
+						inputs.push_back({ instruction.targets[i], instruction.operands[i] });
+					}
+					std::ranges::sort(inputs);
+
+					key.block = instruction.block;
+					key.operands.clear();
+					for (const auto& [target, operand] : inputs)
+					{
+						key.targets.push_back(target);
+						key.operands.push_back(operand);
+					}
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+
+			return key;
+		}
+	}
+
+	bool GlobalValueNumberingPass::RunOnFunction(IRFunction& function)
+	{
+		const std::vector<std::optional<IRBlockId>> dominators = function.ComputeImmediateDominators();
+
+		std::vector<std::vector<IRBlockId>> dominator_children(function.GetBlockCount());
+		for (const IRBlockId block : function.ComputeReversePostOrder())
+		{
+			if (block != function.GetEntryBlock())
+			{
+				dominator_children[*dominators[block]].push_back(block);
+			}
+		}
+
+		// Values available in the current block, i.e. those defined in a dominator.
+		// Entries are undone when the walk leaves the block that added them.
+		std::unordered_map<ValueKey, IRValueId, ValueKeyHash> available;
+		std::vector<ValueKey> scope_keys;
+
+		std::unordered_map<IRValueId, IRValueId> replacements;
+
+		const auto Resolve = [&replacements](IRValueId value)
+			{
+				for (auto found = replacements.find(value); found != replacements.end(); found = replacements.find(value))
+				{
+					value = found->second;
+				}
+				return value;
+			};
+
+		// (block, size of scope_keys on entry, whether the block has been numbered)
+		struct WalkEntry
+		{
+			IRBlockId block;
+			size_t scope_start;
+			bool visited;
+		};
+
+		std::vector<WalkEntry> walk;
+		walk.push_back({ function.GetEntryBlock(), 0, false });
+
+		while (!walk.empty())
+		{
+			WalkEntry& entry = walk.back();
+
+			if (entry.visited)
+			{
+				while (scope_keys.size() > entry.scope_start)
+				{
+					available.erase(scope_keys.back());
+					scope_keys.pop_back();
+				}
+				walk.pop_back();
+				continue;
+			}
+
+			entry.visited = true;
+			entry.scope_start = scope_keys.size();
+			const IRBlockId block = entry.block;
+
+			for (const IRValueId value : function.GetBlock(block).instructions)
+			{
+				IRInstruction& instruction = function.GetInstruction(value);
+
+				// Operands defined in dominating blocks have already been numbered. Phi
+				// inputs can come along back edges, so they are only resolved at the end.
+				if (instruction.opcode != IROpCode::Phi)
+				{
+					for (IRValueId& operand : instruction.operands)
+					{
+						operand = Resolve(operand);
+					}
+				}
+
+				if (!IsNumberable(instruction.opcode))
+				{
+					continue;
+				}
+
+				ValueKey key = MakeKey(instruction);
+
+				const auto found = available.find(key);
+				if (found != available.end())
+				{
+					replacements[value] = found->second;
+				}
+				else
+				{
+					available.emplace(key, value);
+					scope_keys.push_back(std::move(key));
+				}
+			}
+
+			for (const IRBlockId child : dominator_children[block])
+			{
+				walk.push_back({ child, 0, false });
+			}
+		}
+
+		if (replacements.empty())
+		{
+			return false;
+		}
+
+		function.ReplaceAllUsesWith(replacements);
+
+		for (const auto& [value, replacement] : replacements)
+		{
+			function.Erase(value);
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "OspreyVM/IR/Passes/JumpThreading.h"
+
+#include <algorithm>
+
+namespace Osprey
+{
+	namespace
+	{
+		// Whether every input of 'phi' that is 'value' comes in along the edge from 'block'
+		bool IsOnlyUsedFromBlock(const IRInstruction& phi, IRValueId value, IRBlockId block)
+		{
+			for (size_t i = 0; i < phi.operands.size(); ++i)
+			{
+				if (phi.operands[i] == value && phi.targets[i] != block)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Whether the block holds nothing but phis and its terminator, and those phis are only
+		// used by the terminator or as inputs to phis of its successors along its own edges.
+		// Such a block computes nothing that later code depends on, so predecessors can bypass it.
+		bool IsForwardingBlock(const IRFunction& function, IRBlockId block, const std::vector<std::vector<IRValueId>>& users)
+		{
+			const IRBasicBlock& basic_block = function.GetBlock(block);
+			const IRValueId terminator = basic_block.instructions.back();
+
+			for (const IRValueId value : basic_block.instructions)
+			{
+				const IRInstruction& instruction = function.GetInstruction(value);
+				if (value == terminator)
+				{
+					break;
+				}
+
+				if (instruction.opcode != IROpCode::Phi)
+				{
+					return false;
+				}
+
+				for (const IRValueId user : users[value])
+				{
+					const IRInstruction& user_instruction = function.GetInstruction(user);
+					const bool is_successor_phi = user_instruction.opcode == IROpCode::Phi
+						&& user_instruction.block != block
+						&& std::ranges::find(function.GetInstruction(terminator).targets, user_instruction.block) != function.GetInstruction(terminator).targets.end()
+						&& IsOnlyUsedFromBlock(user_instruction, value, block);
+
+					if (user != terminator && !is_successor_phi)
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+		// Where control goes after entering 'block' from 'predecessor', if that is known statically
+		std::optional<IRBlockId> GetThreadedTarget(const IRFunction& function, IRBlockId block, IRBlockId predecessor)
+		{
+			const IRInstruction& terminator = function.GetInstruction(*function.GetTerminator(block));
+
+			if (terminator.opcode == IROpCode::Branch)
+			{
+				return terminator.targets[0];
+			}
+
+			if (terminator.opcode != IROpCode::CondBranch)
+			{
+				return std::nullopt;
+			}
+
+			IRValueId condition = terminator.operands[0];
+
+			const IRInstruction& condition_instruction = function.GetInstruction(condition);
+			if (condition_instruction.opcode == IROpCode::Phi && condition_instruction.block == block)
+			{
+				condition = condition_instruction.operands[std::ranges::find(condition_instruction.targets, predecessor) - condition_instruction.targets.begin()];
+			}
+
+			const IRInstruction& incoming = function.GetInstruction(condition);
+			if (incoming.opcode != IROpCode::Const)
+			{
+				return std::nullopt;
+			}
+
+			return incoming.immediate != 0 ? terminator.targets[0] : terminator.targets[1];
+		}
+
+		std::vector<std::vector<IRValueId>> ComputeUsers(const IRFunction& function)
+		{
+			std::vector<std::vector<IRValueId>> users(function.GetInstructionCount());
+
+			for (IRBlockId block = 0; block < function.GetBlockCount(); ++block)
+			{
+				for (const IRValueId value : function.GetBlock(block).instructions)
+				{
+					for (const IRValueId operand : function.GetInstruction(value).operands)
+					{
+						users[operand].push_back(value);
+					}
+				}
+			}
+
+			return users;
+		}
+
+		bool ThreadEdges(IRFunction& function)
+		{
+			bool changed = false;
+
+			std::vector<std::vector<IRValueId>> users = ComputeUsers(function);
+			bool users_changed = false;
+
+			for (const IRBlockId block : function.ComputeReversePostOrder())
+			{
+				// Threading adds phi inputs, which may be new users of another block's phis
+				if (users_changed)
+				{
+					users = ComputeUsers(function);
+					users_changed = false;
+				}
+
+				if (block == function.GetEntryBlock() || function.GetBlock(block).removed || !IsForwardingBlock(function, block, users))
+				{
+					continue;
+				}
+
+				// Copy, as redirecting edges removes predecessors
+				const std::vector<IRBlockId> predecessors = function.GetBlock(block).predecessors;
+
+				for (const IRBlockId predecessor : predecessors)
+				{
+					const std::optional<IRBlockId> target = GetThreadedTarget(function, block, predecessor);
+					if (!target || *target == block || predecessor == block)
+					{
+						continue;
+					}
+
+					// Phis can only hold one input per predecessor
+					const std::vector<IRBlockId>& target_predecessors = function.GetBlock(*target).predecessors;
+					if (std::ranges::find(target_predecessors, predecessor) != target_predecessors.end())
+					{
+						continue;
+					}
+
+					function.RedirectEdge(predecessor, block, *target);
+					changed = true;
+					users_changed = true;
+				}
+			}
+
+			if (changed)
+			{
+				function.RemoveUnreachableBlocks();
+			}
+
+			return changed;
+		}
+
+		bool MergeBlocks(IRFunction& function)
+		{
+			bool changed = false;
+
+			for (const IRBlockId block : function.ComputeReversePostOrder())
+			{
+				const IRBasicBlock& basic_block = function.GetBlock(block);
+				if (block == function.GetEntryBlock() || basic_block.removed || basic_block.predecessors.size() != 1)
+				{
+					continue;
+				}
+
+				const IRBlockId predecessor = basic_block.predecessors[0];
+				if (predecessor == block || function.GetInstruction(*function.GetTerminator(predecessor)).opcode != IROpCode::Branch)
+				{
+					continue;
+				}
+
+				// With a single predecessor every phi is trivial
+				const std::vector<IRValueId> instructions = basic_block.instructions;
+				for (const IRValueId value : instructions)
+				{
+					const IRInstruction& phi = function.GetInstruction(value);
+					if (phi.opcode != IROpCode::Phi)
+					{
+						break;
+					}
+
+					function.ReplaceAllUsesWith(value, phi.operands[0]);
+					function.Erase(value);
+				}
+
+				function.MergeIntoPredecessor(block);
+				changed = true;
+			}
+
+			return changed;
+		}
+	}
+
+	bool JumpThreadingPass::RunOnFunction(IRFunction& function)
+	{
+		const bool threaded = ThreadEdges(function);
+		const bool merged = MergeBlocks(function);
+		return threaded || merged;
+	}
+}
\ No newline at end of file
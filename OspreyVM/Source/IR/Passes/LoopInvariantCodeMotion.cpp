@@ -0,0 +1,128 @@
+#include "OspreyVM/IR/Passes/LoopInvariantCodeMotion.h"
+
+#include <algorithm>
+
+namespace Osprey
+{
+	namespace
+	{
+		bool Dominates(const std::vector<std::optional<IRBlockId>>& immediate_dominators, IRBlockId dominator, IRBlockId block)
+		{
+			while (block != dominator)
+			{
+				const IRBlockId parent = *immediate_dominators[block];
+				if (parent == block)
+				{
+					return false;
+				}
+				block = parent;
+			}
+			return true;
+		}
+
+		// Division is only hoisted by a non-zero constant, anything else could trap
+		bool IsHoistable(const IRFunction& function, const IRInstruction& instruction)
+		{
+			return !HasSideEffects(function, instruction)
+				&& (instruction.opcode == IROpCode::Const || IsUnaryOp(instruction.opcode) || IsBinaryOp(instruction.opcode));
+		}
+
+		// The blocks of the natural loop of 'header', which can reach one of its back edges without passing through it
+		std::vector<bool> FindLoopBlocks(const IRFunction& function, IRBlockId header, const std::vector<IRBlockId>& latches)
+		{
+			std::vector<bool> in_loop(function.GetBlockCount(), false);
+			in_loop[header] = true;
+
+			std::vector<IRBlockId> worklist = latches;
+			while (!worklist.empty())
+			{
+				const IRBlockId block = worklist.back();
+				worklist.pop_back();
+
+				if (in_loop[block])
+				{
+					continue;
+				}
+				in_loop[block] = true;
+
+				for (const IRBlockId predecessor : function.GetBlock(block).predecessors)
+				{
+					worklist.push_back(predecessor);
+				}
+			}
+
+			return in_loop;
+		}
+	}
+
+	bool LoopInvariantCodeMotionPass::RunOnFunction(IRFunction& function)
+	{
+		bool changed = false;
+
+		const std::vector<IRBlockId> order = function.ComputeReversePostOrder();
+		const std::vector<std::optional<IRBlockId>> immediate_dominators = function.ComputeImmediateDominators();
+
+		for (const IRBlockId header : order)
+		{
+			std::vector<IRBlockId> latches;
+			std::vector<IRBlockId> entries;
+			for (const IRBlockId predecessor : function.GetBlock(header).predecessors)
+			{
+				if (!immediate_dominators[predecessor])
+				{
+					continue;
+				}
+				(Dominates(immediate_dominators, header, predecessor) ? latches : entries).push_back(predecessor);
+			}
+
+			if (latches.empty())
+			{
+				continue;
+			}
+
+			// Hoisted code needs a single block that always runs just before the loop
+			if (entries.size() != 1 || function.GetSuccessors(entries[0]).size() != 1)
+			{
+				continue;
+			}
+			const IRBlockId preheader = entries[0];
+
+			const std::vector<bool> in_loop = FindLoopBlocks(function, header, latches);
+
+			// Visiting in reverse post-order means the operands of an instruction have been
+			// hoisted before it is considered, so whole invariant expressions move together
+			for (const IRBlockId block : order)
+			{
+				if (!in_loop[block])
+				{
+					continue;
+				}
+
+				// Copy, as hoisting unlinks instructions from the block
+				const std::vector<IRValueId> instructions = function.GetBlock(block).instructions;
+
+				for (const IRValueId value : instructions)
+				{
+					const IRInstruction& instruction = function.GetInstruction(value);
+					if (!IsHoistable(function, instruction))
+					{
+						continue;
+					}
+
+					const bool invariant = std::ranges::none_of(instruction.operands, [&](IRValueId operand)
+						{
+							return in_loop[function.GetInstruction(operand).block];
+						});
+
+					if (invariant)
+					{
+						function.MoveBeforeTerminator(value, preheader);
+						changed = true;
+					}
+				}
+			}
+		}
+
+		return changed;
+	}
+}
\ No newline at end of file
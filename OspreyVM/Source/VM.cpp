@@ -2,14 +2,15 @@
 #include "OspreyVM/VMOpCode.h"
 
 #include <print>
+#include <format>
 
 namespace Osprey
 {
-	VM::VM(VMProgram program)
+	VM::VM(VMProgram program, size_t entry_offset)
 		: m_program(std::move(program))
 		, m_stack()
 		, m_memory(1'024)
-		, m_instruction_offset(0)
+		, m_instruction_offset(entry_offset)
 	{
 	}
 
@@ -18,6 +19,11 @@ namespace Osprey
 		return m_program;
 	}
 
+	VMProgram VM::TakeProgram()
+	{
+		return std::move(m_program);
+	}
+
 	const VMStack& VM::GetStack() const
 	{
 		return m_stack;
@@ -28,13 +34,54 @@ namespace Osprey
 		return m_memory;
 	}
 
-	std::optional<VM> VM::Load(VMProgram program)
+	VMStatus VM::GetStatus() const
+	{
+		return m_status;
+	}
+
+	size_t VM::GetRemainingFuel() const
+	{
+		return m_fuel.value_or(0);
+	}
+
+	std::optional<VM> VM::Load(VMProgram program, size_t entry_offset)
+	{
+		return VM(std::move(program), entry_offset);
+	}
+
+	// Stops execution; the message is only reported by the unbounded Execute, as
+	// traps are expected when evaluating code at compile time
+	void VM::Trap(std::string message)
+	{
+		m_status = VMStatus::Trapped;
+		m_trap_message = std::move(message);
+	}
+
+	void VM::SetProfile(VMProfile* profile)
 	{
-		return VM(std::move(program));
+		m_profile = profile;
+	}
+
+	void VM::JumpIf(size_t instruction_offset, int32_t target_offset, bool condition)
+	{
+		if (condition)
+		{
+			m_instruction_offset = target_offset;
+			if (m_instruction_offset <= instruction_offset)
+			{
+				ConsumeFuel();
+			}
+		}
+
+		if (m_profile)
+		{
+			m_profile->RecordBranch(instruction_offset, condition);
+		}
 	}
 
 	void VM::Step()
 	{
+		const size_t instruction_offset = m_instruction_offset;
 		const VMOpCode instruction = static_cast<VMOpCode>(m_program.GetInstruction(m_instruction_offset++));
 
 		switch (instruction)
@@ -68,6 +115,13 @@ namespace Osprey
 				m_stack.Push(left + right);
 				break;
 			}
+			case VMOpCode::SUB:
+			{
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				m_stack.Push(left - right);
+				break;
+			}
 			case VMOpCode::MUL:
 			{
 				const int32_t left = m_stack.Pop();
@@ -75,6 +129,35 @@ namespace Osprey
 				m_stack.Push(left * right);
 				break;
 			}
+			case VMOpCode::DIV:
+			case VMOpCode::MOD:
+			{
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				if (right == 0)
+				{
+					Trap("Division by zero");
+					break;
+				}
+				// Widen so that INT32_MIN / -1 wraps instead of trapping
+				const int64_t result = instruction == VMOpCode::DIV
+					? static_cast<int64_t>(left) / right
+					: static_cast<int64_t>(left) % right;
+				m_stack.Push(static_cast<int32_t>(result));
+				break;
+			}
+			case VMOpCode::NOT:
+			{
+				const int32_t value = m_stack.Pop();
+				m_stack.Push(value == 0 ? 1 : 0);
+				break;
+			}
+			case VMOpCode::NEGATE:
+			{
+				const int32_t value = m_stack.Pop();
+				m_stack.Push(0 - value);
+				break;
+			}
 			case VMOpCode::STORE:
 			{
 				int32_t address = m_program.GetInstruction(m_instruction_offset++);
@@ -90,22 +173,117 @@ namespace Osprey
 				break;
 			}
 			case VMOpCode::LT:
+			case VMOpCode::LE:
+			case VMOpCode::GT:
+			case VMOpCode::GE:
+			case VMOpCode::EQ:
+			case VMOpCode::NE:
 			{
 				// Stack: (Bottom)   (Top)
 				//          |          |
 				//        [ X, ..., A, B ]
-				const int32_t left = m_stack.Pop();
+				// computes A <op> B
 				const int32_t right = m_stack.Pop();
-				m_stack.Push(left < right ? 1 : 0);
+				const int32_t left = m_stack.Pop();
+				bool result = false;
+				switch (instruction)
+				{
+					case VMOpCode::LT: result = left < right; break;
+					case VMOpCode::LE: result = left <= right; break;
+					case VMOpCode::GT: result = left > right; break;
+					case VMOpCode::GE: result = left >= right; break;
+					case VMOpCode::EQ: result = left == right; break;
+					case VMOpCode::NE: result = left != right; break;
+					default: break;
+				}
+				m_stack.Push(result ? 1 : 0);
 				break;
 			}
 			case VMOpCode::JZ:
 			{
 				int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
 				int32_t value = m_stack.Pop();
-				if (value == 0)
+				JumpIf(instruction_offset, new_instruction_offset, value == 0);
+				break;
+			}
+			case VMOpCode::JLT:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left < right);
+				break;
+			}
+			case VMOpCode::JLE:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left <= right);
+				break;
+			}
+			case VMOpCode::JGT:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left > right);
+				break;
+			}
+			case VMOpCode::JGE:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left >= right);
+				break;
+			}
+			case VMOpCode::JEQ:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left == right);
+				break;
+			}
+			case VMOpCode::JNE:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t right = m_stack.Pop();
+				const int32_t left = m_stack.Pop();
+				JumpIf(instruction_offset, new_instruction_offset, left != right);
+				break;
+			}
+			case VMOpCode::FORPREP:
+			{
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t limit = m_stack.GetFromTop(0);
+				const int32_t counter = m_stack.GetFromTop(1);
+				JumpIf(instruction_offset, new_instruction_offset, !(counter < limit));
+				break;
+			}
+			case VMOpCode::FORLOOP:
+			{
+				// The body may have assigned the counter, so wrap like the IR does rather than overflow
+				const int32_t new_instruction_offset = m_program.GetInstruction(m_instruction_offset++);
+				const int32_t limit = m_stack.GetFromTop(0);
+				const int32_t counter = static_cast<int32_t>(static_cast<uint32_t>(m_stack.GetFromTop(1)) + 1u);
+				m_stack.SetFromTop(1, counter);
+				JumpIf(instruction_offset, new_instruction_offset, counter < limit);
+				break;
+			}
+			case VMOpCode::JTABLE:
+			{
+				const int32_t entry_count = m_program.GetInstruction(m_instruction_offset++);
+				const size_t table_offset = m_instruction_offset;
+				const int64_t index = static_cast<int64_t>(m_stack.GetFromTop(0)) - m_program.GetInstruction(table_offset);
+
+				// The default target comes first, then one per entry
+				const size_t target_offset = index >= 0 && index < entry_count ? table_offset + 2 + index : table_offset + 1;
+				m_instruction_offset = m_program.GetInstruction(target_offset);
+				if (m_instruction_offset <= instruction_offset)
 				{
-					m_instruction_offset = new_instruction_offset;
+					ConsumeFuel();
 				}
 				break;
 			}
@@ -113,11 +291,19 @@ namespace Osprey
 			{
 				int32_t address = m_stack.Pop();
 				m_instruction_offset = address;
+				if (m_instruction_offset <= instruction_offset)
+				{
+					ConsumeFuel();
+				}
+				if (m_profile)
+				{
+					m_profile->RecordJump(instruction_offset);
+				}
 				break;
 			}
 			case VMOpCode::HALT:
 			{
-				is_running = false;
+				m_status = VMStatus::Halted;
 				break;
 			}
 			case VMOpCode::SWAP:
@@ -134,18 +320,70 @@ namespace Osprey
 			}
 			default:
 			{
-				std::println("Unknown opcode: {}", OpCodeToString(instruction));
-				is_running = false;
+				Trap(std::format("Unknown opcode: {}", OpCodeToString(instruction)));
 				break;
 			}
 		}
 	}
 
+	// Called on every backward jump, once the jump has been made so that execution
+	// resumes at its target
+	void VM::ConsumeFuel()
+	{
+		if (!m_fuel)
+		{
+			return;
+		}
+
+		if (*m_fuel == 0)
+		{
+			m_status = VMStatus::Suspended;
+			return;
+		}
+
+		--*m_fuel;
+	}
+
 	void VM::Execute()
 	{
-		while (is_running)
+		m_fuel.reset();
+		if (m_status == VMStatus::Suspended)
+		{
+			m_status = VMStatus::Running;
+		}
+
+		while (m_status == VMStatus::Running)
 		{
 			Step();
 		}
+
+		if (m_status == VMStatus::Trapped)
+		{
+			std::println("{}", m_trap_message);
+		}
+	}
+
+	VMStatus VM::Execute(size_t fuel)
+	{
+		m_fuel = fuel;
+		if (m_status == VMStatus::Suspended)
+		{
+			m_status = VMStatus::Running;
+		}
+
+		// Bounded runs evaluate code at compile time, so a jump out of the program traps
+		// rather than reading past it
+		const size_t program_size = m_program.GetInstructions().size();
+		while (m_status == VMStatus::Running)
+		{
+			if (m_instruction_offset >= program_size)
+			{
+				Trap(std::format("Instruction offset out of range: {}", m_instruction_offset));
+				break;
+			}
+			Step();
+		}
+
+		return m_status;
 	}
 }
\ No newline at end of file
@@ -2,9 +2,16 @@
 
 #include "OspreyAST/AST.h"
 #include "OspreyAST/ASTVisitor.h"
+#include "OspreyAST/FlatAST.h"
+#include "OspreyAST/ParallelFor.h"
 #include "OspreyVM/VMProgram.h"
 #include "OspreyVM/VMOpCode.h"
+#include "OspreyVM/VMInstruction.h"
 #include "OspreyVM/VMStackBindings.h"
+#include "OspreyVM/VM.h"
+#include "OspreyVM/IR/IRBuilder.h"
+#include "OspreyVM/IR/IRPass.h"
+#include "OspreyVM/IR/IRCodeGen.h"
 
 #include "OspreyAST/Expressions/Literal.h"
 #include "OspreyAST/Expressions/Variable.h"
@@ -15,6 +22,9 @@
 #include "OspreyAST/Statements/VariableDecl.h"
 #include "OspreyAST/Statements/Return.h"
 #include "OspreyAST/Statements/If.h"
+#include "OspreyAST/Statements/While.h"
+#include "OspreyAST/Statements/For.h"
+#include "OspreyAST/Statements/Match.h"
 #include "OspreyAST/Statements/Block.h"
 #include "OspreyAST/Statements/Assignment.h"
 #include "OspreyAST/Statements/FunctionDecl.h"
@@ -25,135 +35,184 @@
 #include <cassert>
 #include <ranges>
 #include <set>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <span>
 
 namespace Osprey
 {
-	struct VMInstructionHandle
+	enum class VMCompilePhase
 	{
-		int32_t opcode_offset = 0;
-		std::optional<int32_t> operand_offset;
+		None,
+		FirstPass,
+		DeferredFunctions,
+		ConstantEvaluation,
 	};
 
-	class VMInstruction
+	class VMCompileContext
 	{
 	public:
-		static VMInstruction PUSH(int32_t value)
+		bool RegisterFunctionToCompile(const std::string& identifier, const ASTFunctionExpr* function)
 		{
-			return VMInstruction(VMOpCode::PUSH, value, 1);
-		}
+			if (!m_function_entries.emplace(identifier, FunctionEntry{ function, std::nullopt }).second)
+			{
+				return false;
+			}
 
-		static VMInstruction DUP(int32_t offset)
-		{
-			return VMInstruction(VMOpCode::DUP, offset, 1);
+			m_deferred_functions.push_back({ identifier, function });
+			return true;
 		}
 
-		static VMInstruction NOT()
+		const std::vector<std::pair<std::string, const ASTFunctionExpr*>>& GetDeferredFunctions() const
 		{
-			return VMInstruction(VMOpCode::DUP, std::nullopt, 0);
+			return m_deferred_functions;
 		}
 
-		static VMInstruction NEGATE()
+		void SetFunctionEntry(const std::string& identifier, int32_t instruction_offset)
 		{
-			return VMInstruction(VMOpCode::DUP, std::nullopt, 0);
+			m_function_entries[identifier].instruction_offset = instruction_offset;
 		}
 
-		static VMInstruction ADD()
+		// Functions are called by address, which is only known once the callee has
+		// been compiled, so the operand is patched in LinkFunctionCalls
+		void RegisterFunctionCall(const std::string& identifier, VMInstructionHandle handle_to_fix, size_t argument_count)
 		{
-			return VMInstruction(VMOpCode::ADD, std::nullopt, -1);
+			m_function_calls.push_back({ identifier, handle_to_fix, argument_count });
 		}
 
-		static VMInstruction MUL()
+		// Links the calls registered since 'first_call' of them, all of them by default
+		bool LinkFunctionCalls(size_t first_call = 0)
 		{
-			return VMInstruction(VMOpCode::MUL, std::nullopt, -1);
-		}
+			for (const FunctionCall& call : std::span(m_function_calls).subspan(first_call))
+			{
+				const auto entry = m_function_entries.find(call.identifier);
+				if (entry == m_function_entries.end() || !entry->second.instruction_offset)
+				{
+					std::println("Failed to call undefined function '{}'", call.identifier);
+					return false;
+				}
 
-		static VMInstruction SWAP(int32_t offset)
-		{
-			return VMInstruction(VMOpCode::SWAP, offset, 0);
-		}
+				const size_t parameter_count = entry->second.function->GetParameters().size();
+				if (parameter_count != call.argument_count)
+				{
+					std::println("Function '{}' expects {} argument(s) but was given {}", call.identifier, parameter_count, call.argument_count);
+					return false;
+				}
 
-		static VMInstruction POP(int32_t count)
-		{
-			return VMInstruction(VMOpCode::POP, count, -count);
+				UpdateOperand(*call.handle.operand_offset, *entry->second.instruction_offset);
+			}
+
+			return true;
 		}
 
-		static VMInstruction JMP()
+		size_t GetNextInstructionOffset() const
 		{
-			return VMInstruction(VMOpCode::JMP, std::nullopt, -1);
+			return instructions.size();
 		}
 
-		static VMInstruction HALT()
+		// Code following a return is unreachable, so the stack delta of the epilogue
+		// should not be applied to the bindings of the enclosing blocks
+		VMInstructionHandle EmitInstruction(VMInstruction instruction, bool apply_stack_delta = true)
 		{
-			return VMInstruction(VMOpCode::HALT, std::nullopt, 0);
-		}
+			VMInstructionHandle handle;
 
-		VMOpCode GetOpcode() const { return m_opcode; }
-		std::optional<int32_t> GetOperand() const { return m_operand; }
-		int32_t GetScopeSizeDelta() const { return m_scope_size_delta; }
+			handle.opcode_offset = EmitOpCode(instruction.GetOpcode());
 
-	private:
-		VMInstruction(VMOpCode opcode, std::optional<int32_t> operand, int32_t scope_size_delta)
-			: m_opcode(opcode)
-			, m_operand(operand)
-			, m_scope_size_delta(scope_size_delta)
-		{
-		}
+			const std::optional<int32_t> operand = instruction.GetOperand();
+			if (operand.has_value())
+			{
+				handle.operand_offset = static_cast<int32_t>(EmitOperand(*operand));
+			}
 
-		VMOpCode m_opcode;
-		std::optional<int32_t> m_operand;
-		int32_t m_scope_size_delta;
-	};
+			if (apply_stack_delta)
+			{
+				m_stack_bindings.ApplyOffset(instruction.GetScopeSizeDelta());
+			}
 
-	enum class VMCompilePhase
-	{
-		None,
-		FirstPass,
-		DeferredFunctions,
-	};
+			return handle;
+		}
 
-	class VMCompileContext
-	{
-	public:
-		void RegisterFunctionToCompile(ASTFunctionExpr* function, VMInstructionHandle handle_to_fix)
+		// Appends a word of inline data to the instruction just emitted, e.g. an entry of a
+		// jump table, returning its offset so that it can be patched like an operand
+		size_t EmitData(int32_t value)
 		{
-			m_deferred_functions.push_back({ function, handle_to_fix });
+			return EmitOperand(value);
 		}
 
-		const std::vector<std::pair<ASTFunctionExpr*, VMInstructionHandle>>& GetDeferredFunctions() const
+		void UpdateOperand(size_t offset, int32_t operand)
 		{
-			return m_deferred_functions;
+			instructions[offset] = operand;
 		}
 
-		size_t GetNextInstructionOffset() const
+		// Points an address operand (a jump target or return address) at the next instruction
+		// to be emitted, remembering it so that it can be relocated when the code is appended
+		// to another context
+		void PatchToNextInstruction(size_t offset)
 		{
-			return instructions.size();
+			PatchToInstruction(offset, GetNextInstructionOffset());
 		}
 
-		VMInstructionHandle EmitInstruction(VMInstruction instruction)
+		void PatchToInstruction(size_t offset, size_t instruction_offset)
 		{
-			VMInstructionHandle handle;
+			UpdateOperand(offset, static_cast<int32_t>(instruction_offset));
+			m_relocations.push_back(offset);
+		}
 
-			handle.opcode_offset = EmitOpCode(instruction.GetOpcode());
+		// Appends the instructions of a separately compiled function, returning where they
+		// start. Its calls are linked along with the rest in LinkFunctionCalls.
+		int32_t Append(const VMCompileContext& chunk)
+		{
+			const int32_t base = static_cast<int32_t>(instructions.size());
 
-			const std::optional<int32_t> operand = instruction.GetOperand();
-			if (operand.has_value())
+			instructions.insert(instructions.end(), chunk.instructions.begin(), chunk.instructions.end());
+
+			for (const size_t relocation : chunk.m_relocations)
 			{
-				handle.operand_offset = static_cast<int32_t>(EmitOperand(*operand));
+				instructions[base + relocation] += base;
+				m_relocations.push_back(base + relocation);
 			}
 
-			m_stack_bindings.ApplyOffset(instruction.GetScopeSizeDelta());
+			for (FunctionCall call : chunk.m_function_calls)
+			{
+				call.handle.opcode_offset += base;
+				*call.handle.operand_offset += base;
+				m_function_calls.push_back(std::move(call));
+			}
 
-			return handle;
+			return base;
 		}
 
-		void UpdateOperand(size_t offset, int32_t operand)
+		std::vector<int32_t> TakeInstructions()
 		{
-			instructions[offset] = operand;
+			return std::move(instructions);
+		}
+
+		// Gives back the instructions taken by TakeInstructions, e.g. once a VM has run them
+		void ReturnInstructions(std::vector<int32_t> in_instructions)
+		{
+			instructions = std::move(in_instructions);
+		}
+
+		// How much code the context holds, for removing whatever is appended after it with Truncate
+		struct Checkpoint
+		{
+			size_t instruction_count = 0;
+			size_t function_call_count = 0;
+			size_t relocation_count = 0;
+		};
+
+		Checkpoint GetCheckpoint() const
+		{
+			return { instructions.size(), m_function_calls.size(), m_relocations.size() };
 		}
 
-		const std::vector<int32_t>& GetInstructions()
+		void Truncate(const Checkpoint& checkpoint)
 		{
-			return instructions;
+			instructions.resize(checkpoint.instruction_count);
+			m_function_calls.resize(checkpoint.function_call_count);
+			m_relocations.resize(checkpoint.relocation_count);
 		}
 
 		VMStackBindings& GetStackBindings() { return m_stack_bindings; }
@@ -175,271 +234,1572 @@ namespace Osprey
 		}
 
 	private:
-		std::vector<std::pair<ASTFunctionExpr*, VMInstructionHandle>> m_deferred_functions;
+		struct FunctionEntry
+		{
+			const ASTFunctionExpr* function = nullptr;
+			std::optional<int32_t> instruction_offset;
+		};
+
+		struct FunctionCall
+		{
+			std::string identifier;
+			VMInstructionHandle handle;
+			size_t argument_count = 0;
+		};
+
+		std::vector<std::pair<std::string, const ASTFunctionExpr*>> m_deferred_functions;
+		std::unordered_map<std::string, FunctionEntry> m_function_entries;
+		std::vector<FunctionCall> m_function_calls;
+		// Operands holding instruction offsets within this context
+		std::vector<size_t> m_relocations;
 
 		VMStackBindings m_stack_bindings;
 		std::vector<int32_t> instructions;
 		VMCompilePhase m_phase = VMCompilePhase::None;
 	};
 
-	class VMCompiler : public ASTVisitor
+	/*
+		Records which functions each function calls by name so that the compiler
+		only emits functions reachable from 'main'. Calls made outside of any
+		function (e.g. in a global's initialiser) are treated as roots. Calls that
+		have been folded to a constant are not recorded.
+
+		Also records which functions read or assign variables declared outside of
+		themselves, from which the pure functions are derived.
+
+		Function bodies are only walked once the function is found to be reachable,
+		so the bodies of functions that are never called are never parsed if the
+		parser skipped them.
+	*/
+	class VMCallGraphBuilder : public ASTVisitor
 	{
 	public:
-		const VMCompileContext& GetContext() const
-		{
-			return m_context;
-		}
-
-	private:
-		ASTVisitorTraversal Visit(const ASTLiteral& node)
+		VMCallGraphBuilder(const std::unordered_map<const ASTFunctionCall*, int32_t>& folded_calls)
+			: m_folded_calls(folded_calls)
 		{
-			m_context.EmitInstruction(VMInstruction::PUSH(node.GetValue()));
-
-			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTVariable& node)
+		// A function is pure if it only touches its own parameters and locals, and
+		// only calls pure functions. Its result then depends on nothing but its
+		// arguments, and calling it has no effect other than possibly trapping.
+		// Only the functions walked by ComputeReachableFunctions are considered.
+		std::set<std::string> ComputePureFunctions() const
 		{
-			const std::optional<int32_t> top_offset = m_context.GetStackBindings().GetBindingOffsetFromTop(node.GetIdentifier());
-			if (!top_offset)
+			std::set<std::string> pure;
+			for (const std::string& function : m_walked_functions)
 			{
-				std::println("Variable '{}' does not exist", node.GetIdentifier());
-				return ASTVisitorTraversal::Stop;
+				if (!m_impure_functions.contains(function))
+				{
+					pure.insert(function);
+				}
 			}
 
-			m_context.EmitInstruction(VMInstruction::DUP(*top_offset));
+			// Optimistically assume (mutually) recursive functions are pure, then
+			// remove any that call something impure until nothing changes
+			bool changed = true;
+			while (changed)
+			{
+				changed = false;
 
-			return ASTVisitorTraversal::Continue;
+				for (auto it = pure.begin(); it != pure.end();)
+				{
+					const auto found = m_callees.find(*it);
+					const bool calls_impure = found != m_callees.end()
+						&& std::ranges::any_of(found->second, [&pure](const std::string& callee) { return !pure.contains(callee); });
+
+					if (calls_impure)
+					{
+						it = pure.erase(it);
+						changed = true;
+					}
+					else
+					{
+						++it;
+					}
+				}
+			}
+
+			return pure;
 		}
 
-		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		// Walks the bodies of the functions reachable from 'main' and the top level
+		std::set<std::string> ComputeReachableFunctions()
 		{
-			if (node.GetNode()->Accept(*this) == ASTVisitorTraversal::Stop)
-			{
-				return ASTVisitorTraversal::Stop;
-			}
+			Reach("main");
 
-			switch (node.GetOperator())
+			const auto it = m_callees.find("");
+			if (it != m_callees.end())
 			{
-				case UnaryOperator::Exclamation:
+				for (const std::string& callee : it->second)
 				{
-					m_context.EmitInstruction(VMInstruction::NOT());
-					break;
+					Reach(callee);
 				}
-				case UnaryOperator::Minus:
+			}
+
+			while (!m_worklist.empty())
+			{
+				const ASTFunctionDeclarationStmt& declaration = *m_worklist.back();
+				m_worklist.pop_back();
+
+				WalkFunction(declaration);
+
+				const auto found = m_callees.find(declaration.GetIdentifier());
+				if (found == m_callees.end())
 				{
-					m_context.EmitInstruction(VMInstruction::NEGATE());
-					break;
+					continue;
 				}
-				default:
+
+				for (const std::string& callee : found->second)
 				{
-					std::println("Unknown unary operator");
-					return ASTVisitorTraversal::Stop;
+					Reach(callee);
 				}
 			}
 
+			return m_reachable;
+		}
+
+	private:
+		ASTVisitorTraversal Visit(const ASTLiteral&)
+		{
 			return ASTVisitorTraversal::Continue;
 		}
-		
+
+		ASTVisitorTraversal Visit(const ASTVariable& node)
+		{
+			UseVariable(node.GetIdentifier());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		{
+			return node.GetNode()->Accept(*this);
+		}
+
 		ASTVisitorTraversal Visit(const ASTBinaryExpr& node)
 		{
-			if (node.GetLeftNode()->Accept(*this) == ASTVisitorTraversal::Stop)
-			{
-				return ASTVisitorTraversal::Stop;
-			}
+			node.GetLeftNode()->Accept(*this);
+			return node.GetRightNode()->Accept(*this);
+		}
 
-			if (node.GetRightNode()->Accept(*this) == ASTVisitorTraversal::Stop)
-			{
-				return ASTVisitorTraversal::Stop;
-			}
+		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		{
+			node.GetExpressionNode()->Accept(*this);
+			DeclareVariable(node.GetIdentifier());
+			return ASTVisitorTraversal::Continue;
+		}
 
-			if (node.GetOperator() == BinaryOperator::Plus)
-			{
-				m_context.EmitInstruction(VMInstruction::ADD());
-			}
-			else if (node.GetOperator() == BinaryOperator::Asterisk)
-			{
-				m_context.EmitInstruction(VMInstruction::MUL());
-			}
-			else
+		ASTVisitorTraversal Visit(const ASTReturn& node)
+		{
+			return node.GetExpressionNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTBlock& node)
+		{
+			m_scopes.emplace_back();
+			for (const ASTStmt* statement : node.GetStatements())
 			{
-				std::println("Unknown operator");
-				return ASTVisitorTraversal::Stop;
+				statement->Accept(*this);
 			}
+			m_scopes.pop_back();
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		{
+			UseVariable(node.GetIdentifier());
+			return node.GetExpressionNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		{
+			node.GetPredicate()->Accept(*this);
+			node.GetTrueBlock()->Accept(*this);
+			return node.GetFalseBlock() ? node.GetFalseBlock()->Accept(*this) : ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTWhileStmt& node)
+		{
+			node.GetPredicate()->Accept(*this);
+			return node.GetBody()->Accept(*this);
+		}
 
+		ASTVisitorTraversal Visit(const ASTForStmt& node)
+		{
+			node.GetStart()->Accept(*this);
+			node.GetLimit()->Accept(*this);
+			m_scopes.emplace_back();
+			DeclareVariable(node.GetIdentifier());
+			node.GetBody()->Accept(*this);
+			m_scopes.pop_back();
 			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		ASTVisitorTraversal Visit(const ASTMatchStmt& node)
 		{
-			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			node.GetValue()->Accept(*this);
+			for (const MatchArm& arm : node.GetArms())
 			{
-				return ASTVisitorTraversal::Stop;
+				arm.body->Accept(*this);
 			}
+			return node.GetElseArm() ? node.GetElseArm()->Accept(*this) : ASTVisitorTraversal::Continue;
+		}
 
-			if (!m_context.GetStackBindings().BindToVariable(node.GetIdentifier()))
+		ASTVisitorTraversal Visit(const ASTProgram& node)
+		{
+			for (const ASTStmt* statement : node.GetStatements())
 			{
-				std::println("Failed to push variable declaration");
-				return ASTVisitorTraversal::Stop;
+				statement->Accept(*this);
 			}
-
 			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTReturn& node)
+		ASTVisitorTraversal Visit(const ASTFunctionCall& node)
 		{
-			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			if (m_folded_calls.contains(&node))
 			{
-				return ASTVisitorTraversal::Stop;
+				return ASTVisitorTraversal::Continue;
 			}
 
+			m_callees[m_current_function].insert(node.GetIdentifier());
+
+			for (const ASTExpr* arg : node.GetArgs().args)
+			{
+				arg->Accept(*this);
+			}
 			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTBlock& node)
+		// Nested functions are walked on their own once reached; the enclosing function
+		// only reaches them if it calls them
+		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
 		{
-			m_context.GetStackBindings().EnterBlock();
+			m_declarations[node.GetIdentifier()].push_back(&node);
 
-			for (const std::unique_ptr<ASTStmt>& statement : node.GetStatements())
+			// Reached before the function enclosing it was walked
+			if (m_reachable.contains(node.GetIdentifier()))
 			{
-				if (statement->Accept(*this) == ASTVisitorTraversal::Stop)
-				{
-					return ASTVisitorTraversal::Stop;
-				}
+				m_worklist.push_back(&node);
 			}
 
-			m_context.GetStackBindings().ExitBlock();
-
 			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		ASTVisitorTraversal Visit(const ASTFunctionExpr& node)
 		{
-			std::optional<size_t> top_offset = m_context.GetStackBindings().GetBindingOffsetFromTop(node.GetIdentifier());
-			if (!top_offset)
+			m_scopes.emplace_back();
+			for (const FunctionParameter& parameter : node.GetParameters())
 			{
-				std::println("Trying to assign to a variable that doesn't exist", node.GetIdentifier());
-				return ASTVisitorTraversal::Stop;
+				DeclareVariable(parameter.GetIdentifier());
 			}
 
-			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			// A body that fails to parse is reported when the function is compiled
+			if (const ASTBlock* body = node.GetBody())
 			{
-				return ASTVisitorTraversal::Stop;
+				body->Accept(*this);
 			}
-
-			// Because of the expression above, we will now have 1 extra value on the data stack.
-			// The data stack should look like this
-			// (BOTTOM) [ _, _, _, k, _, a0, a1, a2, e ] (TOP)
-			// where k is the old value we want to assign and e is its new value
-			m_context.EmitInstruction(VMInstruction::SWAP(*top_offset + 1));
-			m_context.EmitInstruction(VMInstruction::POP(1));
+			m_scopes.pop_back();
 
 			return ASTVisitorTraversal::Continue;
 		}
 
-		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		void Reach(const std::string& function)
 		{
-			std::println("If-statements not supported by the VM compiler");
-			return ASTVisitorTraversal::Stop;
+			if (!m_reachable.insert(function).second)
+			{
+				return;
+			}
+
+			const auto found = m_declarations.find(function);
+			if (found != m_declarations.end())
+			{
+				m_worklist.insert(m_worklist.end(), found->second.begin(), found->second.end());
+			}
 		}
 
-		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
+		// A function cannot see the locals of the function it is nested in
+		void WalkFunction(const ASTFunctionDeclarationStmt& node)
 		{
-			VMInstructionHandle handle = m_context.EmitInstruction(VMInstruction::PUSH(0));
-			m_context.GetStackBindings().BindToVariable(node.GetIdentifier());
-
-			// We need to push the instruction offset of the function onto the
-			// data stack and bind the identifier to that value.
-
-			// We haven't compiled the function's instructions into the
-			// bytecode buffer yet so we need to use a placeholder 0 value
-			// until it has been compiled.
-
-			// We'll add this node to a 'To Compile' list and add make a note
-			// of this operand that we need to fix.
+			m_walked_functions.insert(node.GetIdentifier());
 
-			m_context.RegisterFunctionToCompile(node.GetFunction().get(), handle);
-
-			return ASTVisitorTraversal::Continue;
+			m_current_function = node.GetIdentifier();
+			m_scopes.clear();
+			node.GetFunction()->Accept(*this);
 		}
 
-		ASTVisitorTraversal Visit(const class ASTFunctionExpr& node)
+		void DeclareVariable(const std::string& identifier)
 		{
-			assert(m_context.GetPhase() == VMCompilePhase::DeferredFunctions);
-
-			//m_context.GetStackBindings().EnterBlock();
-
-			if (node.GetBody()->Accept(*this) == ASTVisitorTraversal::Stop)
+			if (!m_scopes.empty())
 			{
-				return ASTVisitorTraversal::Stop;
+				m_scopes.back().insert(identifier);
 			}
+		}
 
-			// The semantic analyser should check that the body ends in a return statement.
-			// The data stack looks something like this where x, y, z are the functions arguments:
-			// 
-			// offset:       4                   3  2  1  0
-			// stack:  [..., caller_return_addr, x, y, z, return_value ]
-			//
-			// we want to transform it into:
-			//
-			// offset: 
-			// stack:  [..., return_value, caller_return_addr ]
-			//
-			// and then call JMP
-
-			const int32_t return_address_offset = m_context.GetStackBindings().GetTopStackSize();
-
-			if (node.GetParameters().size() > 0)
+		void UseVariable(const std::string& identifier)
+		{
+			if (m_current_function.empty())
 			{
-				m_context.EmitInstruction(VMInstruction::SWAP(return_address_offset - 1));
-				// now looks like [..., caller_return_addr, return_value, y, z, x ]
-
-				m_context.EmitInstruction(VMInstruction::POP(node.GetParameters().size()));
-				// now looks like [..., caller_return_addr, return_value ]
+				return;
+			}
 
+			const bool is_local = std::ranges::any_of(m_scopes, [&identifier](const std::set<std::string>& scope) { return scope.contains(identifier); });
+			if (!is_local)
+			{
+				m_impure_functions.insert(m_current_function);
 			}
+		}
 
-			m_context.EmitInstruction(VMInstruction::SWAP(1));
-			// finally [..., return_value, caller_return_addr ]
+	private:
+		const std::unordered_map<const ASTFunctionCall*, int32_t>& m_folded_calls;
 
-			m_context.EmitInstruction(VMInstruction::JMP());
+		std::unordered_map<std::string, std::set<std::string>> m_callees;
+		std::string m_current_function;
 
-			//m_context.GetStackBindings().ExitBlock();
+		std::unordered_map<std::string, std::vector<const ASTFunctionDeclarationStmt*>> m_declarations;
+		std::set<std::string> m_reachable;
+		// Declarations of reachable functions that are yet to be walked
+		std::vector<const ASTFunctionDeclarationStmt*> m_worklist;
 
-			return ASTVisitorTraversal::Continue;
+		std::set<std::string> m_walked_functions;
+		std::set<std::string> m_impure_functions;
+		// Variables declared by the current function, innermost block last
+		std::vector<std::set<std::string>> m_scopes;
+	};
+
+	/*
+		Calls 'on_use' with each variable a statement reads or assigns, including inside any
+		nested blocks, but not inside nested functions as they cannot see them.
+	*/
+	template<typename OnUse>
+	void ForEachVariableUse(const FlatAST& ast, FlatNodeId statement, OnUse&& on_use)
+	{
+		const FlatNodeId end = ast.GetSubtreeEnd(statement);
+		for (FlatNodeId node = statement; node < end;)
+		{
+			switch (ast.GetKind(node))
+			{
+			case FlatNodeKind::Variable:
+			case FlatNodeKind::Assignment:
+				on_use(static_cast<SymbolId>(ast.GetPayload(node)));
+				++node;
+				break;
+			case FlatNodeKind::FunctionDeclaration:
+			case FlatNodeKind::FunctionExpr:
+				node = ast.GetSubtreeEnd(node);
+				break;
+			default:
+				++node;
+				break;
+			}
+		}
+	}
+
+	// What the compiler knows about the whole program, shared by the compilers of each function
+	struct VMProgramInfo
+	{
+		// Calls that are replaced by their result rather than compiled
+		std::unordered_map<const ASTFunctionCall*, int32_t> folded_calls;
+		std::set<std::string> reachable_functions;
+		std::set<std::string> pure_functions;
+	};
+
+	// What VMFunctionHasher saw of a function, which a cached function must match exactly, and its hash
+	struct VMFunctionFingerprint
+	{
+		uint64_t hash = 0;
+		std::string key;
+	};
+
+	/*
+		Fingerprints everything the bytecode of a function depends on: its AST, apart from
+		the bodies of nested functions as they are compiled separately, and what the rest of
+		the program decides about it (which calls are folded and to what, which callees
+		are pure and which nested functions are reachable).
+
+		Also collects the function's calls and nested functions in a fixed order, so
+		that a compiled function can refer to them without holding on to the AST.
+	*/
+	class VMFunctionHasher : public ASTVisitor
+	{
+	public:
+		VMFunctionHasher(const VMProgramInfo& program)
+			: m_program(program)
+		{
+		}
+
+		VMFunctionFingerprint Hash(const std::string& identifier, const ASTFunctionExpr& function)
+		{
+			Combine(identifier);
+			function.Accept(*this);
+			return std::move(m_fingerprint);
+		}
+
+		const std::vector<const ASTFunctionCall*>& GetCalls() const
+		{
+			return m_calls;
+		}
+
+		const std::vector<const ASTFunctionDeclarationStmt*>& GetNestedFunctions() const
+		{
+			return m_nested_functions;
+		}
+
+	private:
+		enum class NodeKind : uint64_t
+		{
+			Literal = 1,
+			Variable,
+			UnaryExpr,
+			BinaryExpr,
+			VariableDeclaration,
+			Return,
+			Block,
+			Assignment,
+			If,
+			FunctionCall,
+			FunctionDeclaration,
+			FunctionExpr,
+			While,
+			For,
+			Match,
+		};
+
+		void Mix(uint64_t value)
+		{
+			uint64_t& hash = m_fingerprint.hash;
+			hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+		}
+
+		void Combine(uint64_t value)
+		{
+			Mix(value);
+			m_fingerprint.key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+
+		void Combine(NodeKind kind)
+		{
+			Combine(static_cast<uint64_t>(kind));
+		}
+
+		// Strings are length-prefixed so that adjacent ones cannot run into each other in the key
+		void Combine(std::string_view value)
+		{
+			Combine(static_cast<uint64_t>(value.size()));
+			Mix(static_cast<uint64_t>(std::hash<std::string_view>{}(value)));
+			m_fingerprint.key.append(value);
+		}
+
+		// Only data types are produced by the parser, so function types are not told apart
+		void Combine(Type type)
+		{
+			const std::optional<DataType> data_type = type.GetDataType();
+			Combine(data_type ? static_cast<uint64_t>(*data_type) + 1 : 0);
+		}
+
+		ASTVisitorTraversal Visit(const ASTLiteral& node)
+		{
+			Combine(NodeKind::Literal);
+			Combine(node.GetType());
+			Combine(static_cast<uint64_t>(static_cast<uint32_t>(node.GetValue())));
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariable& node)
+		{
+			Combine(NodeKind::Variable);
+			Combine(node.GetIdentifier());
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		{
+			Combine(NodeKind::UnaryExpr);
+			Combine(static_cast<uint64_t>(node.GetOperator()));
+			return node.GetNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTBinaryExpr& node)
+		{
+			Combine(NodeKind::BinaryExpr);
+			Combine(static_cast<uint64_t>(node.GetOperator()));
+			node.GetLeftNode()->Accept(*this);
+			return node.GetRightNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		{
+			Combine(NodeKind::VariableDeclaration);
+			Combine(node.GetIdentifier());
+			Combine(node.GetType());
+			return node.GetExpressionNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTReturn& node)
+		{
+			Combine(NodeKind::Return);
+			return node.GetExpressionNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTBlock& node)
+		{
+			Combine(NodeKind::Block);
+			Combine(static_cast<uint64_t>(node.GetStatements().size()));
+			for (const ASTStmt* statement : node.GetStatements())
+			{
+				statement->Accept(*this);
+			}
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		{
+			Combine(NodeKind::Assignment);
+			Combine(node.GetIdentifier());
+			return node.GetExpressionNode()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		{
+			Combine(NodeKind::If);
+			Combine(static_cast<uint64_t>(node.GetFalseBlock() != nullptr));
+			node.GetPredicate()->Accept(*this);
+			node.GetTrueBlock()->Accept(*this);
+			return node.GetFalseBlock() ? node.GetFalseBlock()->Accept(*this) : ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTWhileStmt& node)
+		{
+			Combine(NodeKind::While);
+			node.GetPredicate()->Accept(*this);
+			return node.GetBody()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTForStmt& node)
+		{
+			Combine(NodeKind::For);
+			Combine(node.GetIdentifier());
+			node.GetStart()->Accept(*this);
+			node.GetLimit()->Accept(*this);
+			return node.GetBody()->Accept(*this);
+		}
+
+		ASTVisitorTraversal Visit(const ASTMatchStmt& node)
+		{
+			Combine(NodeKind::Match);
+			Combine(static_cast<uint64_t>(node.GetArms().size()));
+			Combine(static_cast<uint64_t>(node.GetElseArm() != nullptr));
+			node.GetValue()->Accept(*this);
+			for (const MatchArm& arm : node.GetArms())
+			{
+				Combine(static_cast<uint64_t>(arm.values.size()));
+				for (const int32_t value : arm.values)
+				{
+					Combine(static_cast<uint64_t>(static_cast<uint32_t>(value)));
+				}
+				arm.body->Accept(*this);
+			}
+			return node.GetElseArm() ? node.GetElseArm()->Accept(*this) : ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTProgram&)
+		{
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionCall& node)
+		{
+			m_calls.push_back(&node);
+
+			Combine(NodeKind::FunctionCall);
+			Combine(node.GetIdentifier());
+			Combine(static_cast<uint64_t>(node.GetArgs().args.size()));
+			Combine(static_cast<uint64_t>(m_program.pure_functions.contains(node.GetIdentifier())));
+
+			const auto folded = m_program.folded_calls.find(&node);
+			Combine(static_cast<uint64_t>(folded != m_program.folded_calls.end()));
+			if (folded != m_program.folded_calls.end())
+			{
+				Combine(static_cast<uint64_t>(static_cast<uint32_t>(folded->second)));
+			}
+
+			for (const ASTExpr* arg : node.GetArgs().args)
+			{
+				arg->Accept(*this);
+			}
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
+		{
+			m_nested_functions.push_back(&node);
+
+			Combine(NodeKind::FunctionDeclaration);
+			Combine(node.GetIdentifier());
+			Combine(static_cast<uint64_t>(m_program.reachable_functions.contains(node.GetIdentifier())));
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionExpr& node)
+		{
+			Combine(NodeKind::FunctionExpr);
+			for (const FunctionParameter& parameter : node.GetParameters())
+			{
+				Combine(parameter.GetIdentifier());
+				Combine(parameter.GetType());
+			}
+			Combine(node.GetReturnType());
+			return node.GetBody()->Accept(*this);
+		}
+
+	private:
+		const VMProgramInfo& m_program;
+		VMFunctionFingerprint m_fingerprint;
+
+		std::vector<const ASTFunctionCall*> m_calls;
+		std::vector<const ASTFunctionDeclarationStmt*> m_nested_functions;
+	};
+
+	// The relocatable bytecode of one function, which refers to the function's calls and
+	// nested functions by their position in VMFunctionHasher rather than by AST node
+	struct VMCompiledFunction
+	{
+		VMCompileContext context;
+		std::vector<std::string> nested_functions;
+		std::vector<size_t> constant_calls;
+	};
+
+	/*
+		The compiled functions of the last compile, by VMFunctionHasher fingerprint.
+		Functions that a compile does not use are dropped at the end of it.
+	*/
+	class VMFunctionCache
+	{
+	public:
+		std::shared_ptr<const VMCompiledFunction> Find(const VMFunctionFingerprint& fingerprint) const
+		{
+			// Only a matching key is a hit, as different functions can share a hash
+			const auto found = m_entries.find(fingerprint.hash);
+			return found != m_entries.end() && found->second.key == fingerprint.key ? found->second.function : nullptr;
+		}
+
+		void Store(const VMFunctionFingerprint& fingerprint, std::shared_ptr<const VMCompiledFunction> function, bool reused)
+		{
+			m_entries[fingerprint.hash] = { fingerprint.key, std::move(function), true };
+			++(reused ? m_reused_count : m_compiled_count);
+		}
+
+		void BeginCompile()
+		{
+			for (auto& [fingerprint, entry] : m_entries)
+			{
+				entry.used = false;
+			}
+			m_compiled_count = 0;
+			m_reused_count = 0;
+		}
+
+		void EndCompile()
+		{
+			std::erase_if(m_entries, [](const auto& entry) { return !entry.second.used; });
+		}
+
+		size_t GetCompiledCount() const { return m_compiled_count; }
+		size_t GetReusedCount() const { return m_reused_count; }
+
+	private:
+		struct Entry
+		{
+			std::string key;
+			std::shared_ptr<const VMCompiledFunction> function;
+			bool used = false;
+		};
+
+		std::unordered_map<uint64_t, Entry> m_entries;
+		size_t m_compiled_count = 0;
+		size_t m_reused_count = 0;
+	};
+
+	class VMCompiler : public ASTVisitor
+	{
+	public:
+		// Functions are looked up in, and added to, 'cache' if there is one
+		VMCompiler(const VMCompileOptions& options, VMFunctionCache* cache, std::unordered_map<const ASTFunctionCall*, int32_t> folded_calls = {})
+			: m_program(std::make_shared<VMProgramInfo>())
+			, m_cache(cache)
+			, m_thread_count(options.thread_count > 0 ? options.thread_count : std::max(1u, std::thread::hardware_concurrency()))
+		{
+			m_program->folded_calls = std::move(folded_calls);
+		}
+
+		// Compiles a single function of the program into its own context
+		VMCompiler(std::shared_ptr<VMProgramInfo> program)
+			: m_program(std::move(program))
+		{
+		}
+
+		ASTVisitorTraversal CompileFunction(const ASTFunctionExpr& function)
+		{
+			m_flat_ast.emplace(function, FlatNestedFunctions::Exclude);
+			m_context.SetPhase(VMCompilePhase::DeferredFunctions);
+			return function.Accept(*this);
+		}
+
+		// Hands over the linked bytecode, leaving the compiler empty
+		VMProgram TakeProgram()
+		{
+			return VMProgram(m_context.TakeInstructions());
+		}
+
+		// Runs each call to a pure function with constant arguments found while compiling
+		// the program, in a VM limited to 'fuel' backward jumps per call and 'budget' for
+		// every call together. Calls that trap or run out of fuel are left to fail, or loop,
+		// at runtime.
+		std::unordered_map<const ASTFunctionCall*, int32_t> EvaluateConstantCalls(size_t fuel, size_t budget)
+		{
+			std::unordered_map<const ASTFunctionCall*, int32_t> results;
+
+			m_context.SetPhase(VMCompilePhase::ConstantEvaluation);
+			const VMCompileContext::Checkpoint compiled_checkpoint = m_context.GetCheckpoint();
+
+			for (const ASTFunctionCall* call : m_constant_calls)
+			{
+				const size_t call_fuel = std::min(fuel, budget);
+				if (call_fuel == 0)
+				{
+					break;
+				}
+
+				// Append an entry point that calls the function and halts to the program as
+				// linked, so only its own calls need linking, then remove it again
+				const size_t entry_offset = m_context.GetNextInstructionOffset();
+
+				m_context.GetStackBindings().EnterBlock();
+				const ASTVisitorTraversal traversal = call->Accept(*this);
+				m_context.EmitInstruction(VMInstruction::HALT());
+				m_context.GetStackBindings().ExitBlock();
+
+				if (traversal == ASTVisitorTraversal::Continue && m_context.LinkFunctionCalls(compiled_checkpoint.function_call_count))
+				{
+					std::optional<VM> vm = VM::Load(VMProgram(m_context.TakeInstructions()), entry_offset);
+					if (vm->Execute(call_fuel) == VMStatus::Halted && vm->GetStack().GetSize() == 1)
+					{
+						results.emplace(call, vm->GetStack().GetFromTop(0));
+					}
+
+					budget -= call_fuel - vm->GetRemainingFuel();
+					m_context.ReturnInstructions(vm->TakeProgram().TakeInstructions());
+				}
+
+				m_context.Truncate(compiled_checkpoint);
+			}
+
+			return results;
+		}
+
+	private:
+		ASTVisitorTraversal Visit(const ASTLiteral& node)
+		{
+			m_context.EmitInstruction(VMInstruction::PUSH(node.GetValue()));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariable& node)
+		{
+			const std::optional<int32_t> top_offset = m_context.GetStackBindings().GetBindingOffsetFromTop(node.GetSymbol());
+			if (!top_offset)
+			{
+				std::println("Variable '{}' does not exist", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			m_context.EmitInstruction(VMInstruction::DUP(*top_offset));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTUnaryExpr& node)
+		{
+			if (node.GetNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			switch (node.GetOperator())
+			{
+				case UnaryOperator::Exclamation:
+				{
+					m_context.EmitInstruction(VMInstruction::NOT());
+					break;
+				}
+				case UnaryOperator::Minus:
+				{
+					m_context.EmitInstruction(VMInstruction::NEGATE());
+					break;
+				}
+				default:
+				{
+					std::println("Unknown unary operator");
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+		
+		ASTVisitorTraversal Visit(const ASTBinaryExpr& node)
+		{
+			if (node.GetOperator() == BinaryOperator::And || node.GetOperator() == BinaryOperator::Or)
+			{
+				return VisitLogicalExpr(node);
+			}
+
+			if (node.GetLeftNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (node.GetRightNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			switch (node.GetOperator())
+			{
+				case BinaryOperator::Plus: m_context.EmitInstruction(VMInstruction::ADD()); break;
+				case BinaryOperator::Minus: m_context.EmitInstruction(VMInstruction::SUB()); break;
+				case BinaryOperator::Asterisk: m_context.EmitInstruction(VMInstruction::MUL()); break;
+				case BinaryOperator::Divide: m_context.EmitInstruction(VMInstruction::DIV()); break;
+				case BinaryOperator::Percent: m_context.EmitInstruction(VMInstruction::MOD()); break;
+				case BinaryOperator::Lt: m_context.EmitInstruction(VMInstruction::LT()); break;
+				case BinaryOperator::LtEq: m_context.EmitInstruction(VMInstruction::LE()); break;
+				case BinaryOperator::Gt: m_context.EmitInstruction(VMInstruction::GT()); break;
+				case BinaryOperator::GtEq: m_context.EmitInstruction(VMInstruction::GE()); break;
+				case BinaryOperator::Equality: m_context.EmitInstruction(VMInstruction::EQ()); break;
+				case BinaryOperator::NotEquality: m_context.EmitInstruction(VMInstruction::NE()); break;
+				default:
+				{
+					std::println("Unknown operator");
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		// '&&' and '||' used as a value: branch on the condition, then push 1 or 0
+		ASTVisitorTraversal VisitLogicalExpr(const ASTBinaryExpr& node)
+		{
+			std::vector<VMInstructionHandle> jumps_if_false;
+			if (!EmitConditionalJump(node, false, jumps_if_false))
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			m_context.EmitInstruction(VMInstruction::PUSH(1));
+			const VMInstructionHandle jump_to_end = m_context.EmitInstruction(VMInstruction::PUSH(0));
+			m_context.EmitInstruction(VMInstruction::JMP());
+
+			// The false path arrives without the 1 pushed above
+			m_context.GetStackBindings().ApplyOffset(-1);
+			PatchJumps(jumps_if_false);
+			m_context.EmitInstruction(VMInstruction::PUSH(0));
+
+			PatchJumps({ jump_to_end });
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTVariableDeclarationStmt& node)
+		{
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// Move the value into the slot of a variable that is no longer used, if there
+			// is one, rather than growing the stack
+			int32_t offset_from_top = 0;
+			if (const std::optional<int32_t> free_slot = m_context.GetStackBindings().TakeFreeSlot())
+			{
+				m_context.EmitInstruction(VMInstruction::SWAP(*free_slot));
+				m_context.EmitInstruction(VMInstruction::POP(1));
+				offset_from_top = *free_slot - 1;
+			}
+
+			if (!m_context.GetStackBindings().BindToVariable(node.GetSymbol(), offset_from_top))
+			{
+				std::println("Failed to push variable declaration");
+				return ASTVisitorTraversal::Stop;
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTReturn& node)
+		{
+			// Everything the function has pushed since the caller's return address
+			const int32_t frame_size = m_context.GetStackBindings().GetStackSize() - m_frame_base;
+
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// The data stack looks something like this where x, y are the function's
+			// arguments and a, b are locals from any enclosing block:
+			// 
+			// stack:  [..., caller_return_addr, x, y, a, b, return_value ]
+			//
+			// we want to transform it into:
+			//
+			// stack:  [..., return_value, caller_return_addr ]
+			//
+			// and then call JMP
+
+			if (frame_size > 0)
+			{
+				m_context.EmitInstruction(VMInstruction::SWAP(frame_size), false);
+				// now looks like [..., caller_return_addr, return_value, y, a, b, x ]
+
+				m_context.EmitInstruction(VMInstruction::POP(frame_size), false);
+				// now looks like [..., caller_return_addr, return_value ]
+			}
+
+			m_context.EmitInstruction(VMInstruction::SWAP(1), false);
+			// finally [..., return_value, caller_return_addr ]
+
+			m_context.EmitInstruction(VMInstruction::JMP(), false);
+
+			m_context.GetStackBindings().ApplyOffset(-1);
+
+			m_has_returned = true;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTBlock& node)
+		{
+			return CompileBlock(node, {});
+		}
+
+		// 'variables' are those already bound that the block may release, e.g. a function's parameters
+		ASTVisitorTraversal CompileBlock(const ASTBlock& node, std::vector<SymbolId> variables)
+		{
+			m_context.GetStackBindings().EnterBlock();
+
+			const std::span<const ASTStmt* const> statements = node.GetStatements();
+
+			// A variable is dead once the last statement of the block that uses it has
+			// run, as blocks are straight-line code at this level
+			std::unordered_map<SymbolId, size_t> last_uses;
+			const FlatAST& flat_ast = *m_flat_ast;
+			const std::span<const FlatNodeId> flat_statements = flat_ast.GetChildren(flat_ast.FindNode(node));
+			for (size_t index = 0; index < flat_statements.size(); ++index)
+			{
+				ForEachVariableUse(flat_ast, flat_statements[index], [&](SymbolId variable)
+					{
+						last_uses[variable] = index;
+					});
+			}
+
+			for (size_t index = 0; index < statements.size(); ++index)
+			{
+				// Anything after a return can never execute
+				if (m_has_returned)
+				{
+					break;
+				}
+
+				if (statements[index]->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+
+				if (const ASTVariableDeclarationStmt* declaration = ASTNodeCast<ASTVariableDeclarationStmt>(statements[index]))
+				{
+					variables.push_back(declaration->GetSymbol());
+				}
+
+				if (!m_has_returned)
+				{
+					ReleaseDeadVariables(variables, last_uses, index);
+				}
+			}
+
+			// Pop the block's variables if control can flow out of the end of it
+			const int32_t block_size = m_context.GetStackBindings().GetTopStackSize();
+			if (!m_has_returned && block_size > 0)
+			{
+				m_context.EmitInstruction(VMInstruction::POP(block_size));
+			}
+
+			m_context.GetStackBindings().ExitBlock();
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		// Releases the variables not used after the statement at 'index', popping any that
+		// are on top of the stack and leaving the rest to be reused by later declarations
+		void ReleaseDeadVariables(std::vector<SymbolId>& variables, const std::unordered_map<SymbolId, size_t>& last_uses, size_t index)
+		{
+			std::erase_if(variables, [&](SymbolId variable)
+				{
+					const auto last_use = last_uses.find(variable);
+					if (last_use != last_uses.end() && last_use->second > index)
+					{
+						return false;
+					}
+
+					m_context.GetStackBindings().ReleaseVariable(variable);
+					return true;
+				});
+
+			const int32_t dead_count = m_context.GetStackBindings().TakeFreeSlotsAtTop();
+			if (dead_count > 0)
+			{
+				m_context.EmitInstruction(VMInstruction::POP(dead_count));
+			}
+		}
+
+		ASTVisitorTraversal Visit(const ASTAssignmentStmt& node)
+		{
+			std::optional<size_t> top_offset = m_context.GetStackBindings().GetBindingOffsetFromTop(node.GetSymbol());
+			if (!top_offset)
+			{
+				std::println("Trying to assign to a variable that doesn't exist", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (node.GetExpressionNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// Because of the expression above, we will now have 1 extra value on the data stack.
+			// The data stack should look like this
+			// (BOTTOM) [ _, _, _, k, _, a0, a1, a2, e ] (TOP)
+			// where k is the old value we want to assign and e is its new value
+			m_context.EmitInstruction(VMInstruction::SWAP(*top_offset + 1));
+			m_context.EmitInstruction(VMInstruction::POP(1));
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTIfStmt& node)
+		{
+			// The jumps to the false block (or past the true block) have their address patched in later
+			std::vector<VMInstructionHandle> jumps_if_false;
+			if (!EmitConditionalJump(*node.GetPredicate(), false, jumps_if_false))
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (node.GetTrueBlock()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const bool true_block_returned = std::exchange(m_has_returned, false);
+
+			if (!node.GetFalseBlock())
+			{
+				PatchJumps(jumps_if_false);
+				return ASTVisitorTraversal::Continue;
+			}
+
+			// Skip over the false block, unless the true block has already returned
+			std::optional<VMInstructionHandle> jump_to_end;
+			if (!true_block_returned)
+			{
+				jump_to_end = m_context.EmitInstruction(VMInstruction::PUSH(0));
+				m_context.EmitInstruction(VMInstruction::JMP());
+			}
+
+			PatchJumps(jumps_if_false);
+
+			if (node.GetFalseBlock()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (jump_to_end)
+			{
+				PatchJumps({ *jump_to_end });
+			}
+
+			m_has_returned &= true_block_returned;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTWhileStmt& node)
+		{
+			// The loop is entered at its condition, which follows the body, so each iteration
+			// ends in a single conditional jump back to the start of the body
+			const VMInstructionHandle jump_to_condition = m_context.EmitInstruction(VMInstruction::PUSH(0));
+			m_context.EmitInstruction(VMInstruction::JMP());
+
+			const size_t body_offset = m_context.GetNextInstructionOffset();
+			if (node.GetBody()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// The body may never run, so returning from it does not return from the function
+			m_has_returned = false;
+
+			PatchJumps({ jump_to_condition });
+
+			std::vector<VMInstructionHandle> jumps_to_body;
+			if (!EmitConditionalJump(*node.GetPredicate(), true, jumps_to_body))
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+			PatchJumps(jumps_to_body, body_offset);
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTForStmt& node)
+		{
+			// The counter and limit stay on top of the stack for the whole loop, where FORPREP
+			// and FORLOOP expect them, as the body pops everything it pushes before FORLOOP
+			m_context.GetStackBindings().EnterBlock();
+
+			if (node.GetStart()->Accept(*this) == ASTVisitorTraversal::Stop
+				|| node.GetLimit()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			if (!m_context.GetStackBindings().BindToVariable(node.GetSymbol(), 1))
+			{
+				std::println("Failed to declare loop variable '{}'", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			const VMInstructionHandle jump_to_exit = m_context.EmitInstruction(VMInstruction::FORPREP(0));
+
+			const size_t body_offset = m_context.GetNextInstructionOffset();
+			if (node.GetBody()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			// The body may never run, so returning from it does not return from the function
+			m_has_returned = false;
+
+			const VMInstructionHandle jump_to_body = m_context.EmitInstruction(VMInstruction::FORLOOP(0));
+			PatchJumps({ jump_to_body }, body_offset);
+			PatchJumps({ jump_to_exit });
+
+			m_context.EmitInstruction(VMInstruction::POP(2));
+			m_context.GetStackBindings().ExitBlock();
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const ASTMatchStmt& node)
+		{
+			// The matched value stays on top of the stack until the arms rejoin
+			m_context.GetStackBindings().EnterBlock();
+
+			if (node.GetValue()->Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			std::vector<MatchCase> cases;
+			for (size_t arm = 0; arm < node.GetArms().size(); ++arm)
+			{
+				for (const int32_t value : node.GetArms()[arm].values)
+				{
+					cases.push_back({ value, arm });
+				}
+			}
+			std::ranges::sort(cases, {}, &MatchCase::value);
+
+			std::vector<std::vector<VMInstructionHandle>> jumps_to_arms(node.GetArms().size());
+			std::vector<VMInstructionHandle> jumps_to_else;
+			const bool dispatch_falls_through = EmitMatchDispatch(cases, jumps_to_arms, jumps_to_else);
+
+			// Arms are laid out after the else arm, which the dispatch falls through into, so
+			// only the last arm can fall through to the end
+			std::vector<VMInstructionHandle> jumps_to_end;
+			bool all_returned = node.GetElseArm() != nullptr;
+
+			const auto CompileArm = [&](const ASTBlock& body, bool is_last) -> bool
+				{
+					if (body.Accept(*this) == ASTVisitorTraversal::Stop)
+					{
+						return false;
+					}
+
+					const bool returned = std::exchange(m_has_returned, false);
+					all_returned &= returned;
+
+					if (!returned && !is_last)
+					{
+						jumps_to_end.push_back(m_context.EmitInstruction(VMInstruction::PUSH(0)));
+						m_context.EmitInstruction(VMInstruction::JMP());
+					}
+					return true;
+				};
+
+			if (node.GetElseArm())
+			{
+				PatchJumps(jumps_to_else);
+				if (!CompileArm(*node.GetElseArm(), node.GetArms().empty()))
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+			else
+			{
+				// Without an else arm, values that match nothing skip straight to the end
+				jumps_to_end = std::move(jumps_to_else);
+				if (dispatch_falls_through && !node.GetArms().empty())
+				{
+					jumps_to_end.push_back(m_context.EmitInstruction(VMInstruction::PUSH(0)));
+					m_context.EmitInstruction(VMInstruction::JMP());
+				}
+			}
+
+			for (size_t arm = 0; arm < node.GetArms().size(); ++arm)
+			{
+				PatchJumps(jumps_to_arms[arm]);
+				if (!CompileArm(*node.GetArms()[arm].body, arm + 1 == node.GetArms().size()))
+				{
+					return ASTVisitorTraversal::Stop;
+				}
+			}
+
+			PatchJumps(jumps_to_end);
+
+			if (!all_returned)
+			{
+				m_context.EmitInstruction(VMInstruction::POP(1));
+			}
+			m_context.GetStackBindings().ExitBlock();
+
+			m_has_returned = all_returned;
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		struct MatchCase
+		{
+			int32_t value;
+			size_t arm;
+		};
+
+		// Jumps to the arm of the matched value on top of the stack, returning whether unmatched values fall through
+		bool EmitMatchDispatch(std::span<const MatchCase> cases, std::vector<std::vector<VMInstructionHandle>>& jumps_to_arms, std::vector<VMInstructionHandle>& jumps_to_else)
+		{
+			constexpr size_t MaxCompareChain = 4;
+			constexpr int64_t MaxJumpTableSize = 1'024;
+
+			if (cases.size() <= MaxCompareChain)
+			{
+				for (const MatchCase& match_case : cases)
+				{
+					m_context.EmitInstruction(VMInstruction::DUP(0));
+					m_context.EmitInstruction(VMInstruction::PUSH(match_case.value));
+					jumps_to_arms[match_case.arm].push_back(m_context.EmitInstruction(VMInstruction::JEQ(0)));
+				}
+				return true;
+			}
+
+			// Runs where at least half of the values are cases use a jump table
+			const int64_t span = static_cast<int64_t>(cases.back().value) - cases.front().value + 1;
+			if (span <= MaxJumpTableSize && span <= 2 * static_cast<int64_t>(cases.size()))
+			{
+				const VMInstructionHandle table = m_context.EmitInstruction(VMInstruction::JTABLE(static_cast<int32_t>(span)));
+				m_context.EmitData(cases.front().value);
+
+				jumps_to_else.push_back({ table.opcode_offset, static_cast<int32_t>(m_context.EmitData(0)) });
+
+				// Values missing from the span go to the default target
+				size_t next_case = 0;
+				for (int64_t value = cases.front().value; value <= cases.back().value; ++value)
+				{
+					const VMInstructionHandle entry = { table.opcode_offset, static_cast<int32_t>(m_context.EmitData(0)) };
+					if (cases[next_case].value == value)
+					{
+						jumps_to_arms[cases[next_case++].arm].push_back(entry);
+					}
+					else
+					{
+						jumps_to_else.push_back(entry);
+					}
+				}
+
+				return false;
+			}
+
+			// Values below the middle case jump to the lower half, the upper half follows inline
+			const size_t middle = cases.size() / 2;
+			m_context.EmitInstruction(VMInstruction::DUP(0));
+			m_context.EmitInstruction(VMInstruction::PUSH(cases[middle].value));
+			const VMInstructionHandle jump_to_lower = m_context.EmitInstruction(VMInstruction::JLT(0));
+
+			if (EmitMatchDispatch(cases.subspan(middle), jumps_to_arms, jumps_to_else))
+			{
+				jumps_to_else.push_back(m_context.EmitInstruction(VMInstruction::PUSH(0)));
+				m_context.EmitInstruction(VMInstruction::JMP());
+			}
+
+			PatchJumps({ jump_to_lower });
+			return EmitMatchDispatch(cases.first(middle), jumps_to_arms, jumps_to_else);
+		}
+
+		// Evaluates the predicate and jumps if it equals 'jump_when', otherwise falls through.
+		// The jumps are appended to 'jumps' for the caller to patch once the target is known.
+		// 
+		// Comparisons are fused with the jump (e.g. 'a < b' emits JGE when jumping on false)
+		// so they branch in a single dispatch. '&&', '||' and '!' never materialise a boolean;
+		// each operand jumps straight to the final target, or past the rest of the condition.
+		bool EmitConditionalJump(const ASTExpr& predicate, bool jump_when, std::vector<VMInstructionHandle>& jumps)
+		{
+			if (const ASTUnaryExpr* unary_expr = ASTNodeCast<ASTUnaryExpr>(&predicate))
+			{
+				if (unary_expr->GetOperator() == UnaryOperator::Exclamation)
+				{
+					return EmitConditionalJump(*unary_expr->GetNode(), !jump_when, jumps);
+				}
+			}
+
+			const ASTBinaryExpr* binary_expr = ASTNodeCast<ASTBinaryExpr>(&predicate);
+
+			if (binary_expr && (binary_expr->GetOperator() == BinaryOperator::And || binary_expr->GetOperator() == BinaryOperator::Or))
+			{
+				// 'a && b' jumps on false as soon as either operand is false, and 'a || b' jumps
+				// on true as soon as either operand is true. Otherwise the left operand decides
+				// whether to skip the right one.
+				const bool is_and = binary_expr->GetOperator() == BinaryOperator::And;
+
+				if (jump_when == !is_and)
+				{
+					return EmitConditionalJump(*binary_expr->GetLeftNode(), jump_when, jumps)
+						&& EmitConditionalJump(*binary_expr->GetRightNode(), jump_when, jumps);
+				}
+
+				std::vector<VMInstructionHandle> skip_right;
+				if (!EmitConditionalJump(*binary_expr->GetLeftNode(), !jump_when, skip_right)
+					|| !EmitConditionalJump(*binary_expr->GetRightNode(), jump_when, jumps))
+				{
+					return false;
+				}
+
+				PatchJumps(skip_right);
+				return true;
+			}
+
+			const std::optional<VMOpCode> comparison = binary_expr ? GetComparisonOpCode(binary_expr->GetOperator()) : std::nullopt;
+
+			if (comparison)
+			{
+				if (binary_expr->GetLeftNode()->Accept(*this) == ASTVisitorTraversal::Stop
+					|| binary_expr->GetRightNode()->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return false;
+				}
+
+				const VMInstruction jump = jump_when ? *VMInstruction::JumpIf(*comparison, 0) : *VMInstruction::JumpIfNot(*comparison, 0);
+				jumps.push_back(m_context.EmitInstruction(jump));
+				return true;
+			}
+
+			if (predicate.Accept(*this) == ASTVisitorTraversal::Stop)
+			{
+				return false;
+			}
+
+			if (jump_when)
+			{
+				// There is no jump-if-not-zero, so compare against zero instead
+				m_context.EmitInstruction(VMInstruction::PUSH(0));
+				jumps.push_back(m_context.EmitInstruction(VMInstruction::JNE(0)));
+			}
+			else
+			{
+				jumps.push_back(m_context.EmitInstruction(VMInstruction::JZ(0)));
+			}
+
+			return true;
+		}
+
+		// Points each jump at the next instruction to be emitted
+		void PatchJumps(const std::vector<VMInstructionHandle>& jumps)
+		{
+			PatchJumps(jumps, m_context.GetNextInstructionOffset());
+		}
+
+		void PatchJumps(const std::vector<VMInstructionHandle>& jumps, size_t instruction_offset)
+		{
+			for (const VMInstructionHandle& jump : jumps)
+			{
+				m_context.PatchToInstruction(*jump.operand_offset, instruction_offset);
+			}
+		}
+
+		static std::optional<VMOpCode> GetComparisonOpCode(BinaryOperator binary_operator)
+		{
+			switch (binary_operator)
+			{
+				case BinaryOperator::Lt: return VMOpCode::LT;
+				case BinaryOperator::LtEq: return VMOpCode::LE;
+				case BinaryOperator::Gt: return VMOpCode::GT;
+				case BinaryOperator::GtEq: return VMOpCode::GE;
+				case BinaryOperator::Equality: return VMOpCode::EQ;
+				case BinaryOperator::NotEquality: return VMOpCode::NE;
+				default: return std::nullopt;
+			}
+		}
+
+		ASTVisitorTraversal Visit(const ASTFunctionDeclarationStmt& node)
+		{
+			if (!m_program->reachable_functions.contains(node.GetIdentifier()))
+			{
+				// Never called, so neither its address nor its body are needed
+				return ASTVisitorTraversal::Continue;
+			}
+
+			// We'll add this node to a 'To Compile' list; calls to it refer to
+			// its instruction offset, which is patched in once it has been compiled.
+
+			if (!m_context.RegisterFunctionToCompile(node.GetIdentifier(), node.GetFunction()))
+			{
+				std::println("Function '{}' is already defined", node.GetIdentifier());
+				return ASTVisitorTraversal::Stop;
+			}
+
+			return ASTVisitorTraversal::Continue;
+		}
+
+		ASTVisitorTraversal Visit(const class ASTFunctionExpr& node)
+		{
+			assert(m_context.GetPhase() == VMCompilePhase::DeferredFunctions);
+
+			m_context.GetStackBindings().EnterBlock();
+
+			// The caller's return address is already on the stack, followed by the arguments
+			m_context.GetStackBindings().ApplyOffset(1);
+			m_frame_base = m_context.GetStackBindings().GetStackSize();
+			m_has_returned = false;
+
+			std::vector<SymbolId> parameters;
+			for (const FunctionParameter& parameter : node.GetParameters())
+			{
+				m_context.GetStackBindings().ApplyOffset(1);
+				if (!m_context.GetStackBindings().BindToVariable(parameter.GetSymbol()))
+				{
+					std::println("Duplicate parameter '{}'", parameter.GetIdentifier());
+					return ASTVisitorTraversal::Stop;
+				}
+				parameters.push_back(parameter.GetSymbol());
+			}
+
+			// The semantic analyser should check that the body ends in a return statement,
+			// each of which emits the function's epilogue
+			if (CompileBlock(*node.GetBody(), std::move(parameters)) == ASTVisitorTraversal::Stop)
+			{
+				return ASTVisitorTraversal::Stop;
+			}
+
+			m_context.GetStackBindings().ExitBlock();
+
+			return ASTVisitorTraversal::Continue;
 		}
 
 		ASTVisitorTraversal Visit(const class ASTFunctionCall& node)
 		{
+			if (const auto folded = m_program->folded_calls.find(&node); folded != m_program->folded_calls.end())
+			{
+				m_context.EmitInstruction(VMInstruction::PUSH(folded->second));
+				return ASTVisitorTraversal::Continue;
+			}
+
+			// Only the outermost constant call needs evaluating, its arguments are evaluated with it
+			const bool is_constant_call = m_collect_constant_calls && m_context.GetPhase() != VMCompilePhase::ConstantEvaluation && IsConstantCall(node);
+			if (is_constant_call)
+			{
+				m_constant_calls.push_back(&node);
+				m_collect_constant_calls = false;
+			}
+
 			const VMInstructionHandle return_instruction_offset = m_context.EmitInstruction(VMInstruction::PUSH(0));
 
-			std::optional<int32_t> function_instruction_offset =  m_context.GetStackBindings().GetBindingOffsetFromTop(node.GetIdentifier());
-			if (!function_instruction_offset)
+			for (const ASTExpr* arg : node.GetArgs().args)
 			{
-				std::println("Failed to call undefined function '{}'", node.GetIdentifier());
-				return ASTVisitorTraversal::Stop;
+				if (arg->Accept(*this) == ASTVisitorTraversal::Stop)
+				{
+					return ASTVisitorTraversal::Stop;
+				}
 			}
 
-			// TODO: handle args (may have to go before function_instruction_offset is calculated
+			const VMInstructionHandle function_instruction_offset = m_context.EmitInstruction(VMInstruction::PUSH(0));
+			m_context.RegisterFunctionCall(node.GetIdentifier(), function_instruction_offset, node.GetArgs().args.size());
 
-			m_context.EmitInstruction(VMInstruction::DUP(*function_instruction_offset));
 			m_context.EmitInstruction(VMInstruction::JMP());
 
-			const auto next_instruction_offset = m_context.GetNextInstructionOffset();
-			m_context.UpdateOperand(*return_instruction_offset.operand_offset, next_instruction_offset);
+			// The callee consumes the arguments and the return address, then pushes its result
+			m_context.GetStackBindings().ApplyOffset(-static_cast<int32_t>(node.GetArgs().args.size()));
+
+			m_context.PatchToNextInstruction(*return_instruction_offset.operand_offset);
+
+			if (is_constant_call)
+			{
+				m_collect_constant_calls = true;
+			}
 
 			return ASTVisitorTraversal::Continue;
 		}
+
+		bool IsConstantCall(const ASTFunctionCall& node) const
+		{
+			return m_program->pure_functions.contains(node.GetIdentifier())
+				&& std::ranges::all_of(node.GetArgs().args, [this](const ASTExpr* arg) { return IsConstantExpr(*arg); });
+		}
+
+		// Whether the expression only depends on literals, so can be evaluated without a frame
+		bool IsConstantExpr(const ASTExpr& expr) const
+		{
+			if (ASTNodeCast<ASTLiteral>(&expr))
+			{
+				return true;
+			}
+			if (const ASTUnaryExpr* unary_expr = ASTNodeCast<ASTUnaryExpr>(&expr))
+			{
+				return IsConstantExpr(*unary_expr->GetNode());
+			}
+			if (const ASTBinaryExpr* binary_expr = ASTNodeCast<ASTBinaryExpr>(&expr))
+			{
+				return IsConstantExpr(*binary_expr->GetLeftNode()) && IsConstantExpr(*binary_expr->GetRightNode());
+			}
+			if (const ASTFunctionCall* call = ASTNodeCast<ASTFunctionCall>(&expr))
+			{
+				return m_program->folded_calls.contains(call) || IsConstantCall(*call);
+			}
+			return false;
+		}
 		
 		ASTVisitorTraversal Visit(const class ASTProgram& Node)
 		{
+			m_flat_ast.emplace(Node, FlatNestedFunctions::Exclude);
+
+			VMCallGraphBuilder call_graph(m_program->folded_calls);
+			Node.Accept(call_graph);
+			m_program->reachable_functions = call_graph.ComputeReachableFunctions();
+			m_program->pure_functions = call_graph.ComputePureFunctions();
+
 			m_context.GetStackBindings().EnterBlock();
 
 			// Generate instructions for all statements (except function expressions that we compile last)
 			{
 				m_context.SetPhase(VMCompilePhase::FirstPass);
 
-				for (const std::unique_ptr<ASTStmt>& statement : Node.GetStatements())
+				for (const ASTStmt* statement : Node.GetStatements())
 				{
 					if (statement->Accept(*this) == ASTVisitorTraversal::Stop)
 					{
@@ -448,13 +1808,16 @@ namespace Osprey
 				}
 			}
 
-			// Create a fake call function node
-			ASTFunctionCall main_call_node("main", {});
+			// Create a fake call function node. It only lives for this pass, so is never
+			// evaluated at compile time.
+			ASTFunctionCall main_call_node(SymbolTable::Intern("main"), {});
+			m_collect_constant_calls = false;
 			if (main_call_node.Accept(*this) == ASTVisitorTraversal::Stop)
 			{
 				std::println("Failed to call 'main' function");
 				return ASTVisitorTraversal::Stop;
 			}
+			m_collect_constant_calls = true;
 
 			// We now have the return value on the stack unaccounted for, let's adjust the binding offsets to accomodate
 			//m_context.GetStackBindings().ApplyOffset(1); // TODO: maybe needed
@@ -462,42 +1825,175 @@ namespace Osprey
 			// Once main returns we need to halt the program
 			m_context.EmitInstruction(VMInstruction::HALT());
 
-			std::optional<int32_t> main_stack_entry = m_context.GetStackBindings().GetBindingOffsetFromTop("main");
-			if (!main_stack_entry)
-			{
-				std::println("Failed to compile program: no 'main' function");
-				return ASTVisitorTraversal::Stop;
-			}
-
-			// Generate instructions for all function expressions
+			// Generate instructions for all function expressions. Each function is compiled
+			// into its own context in parallel, then appended in the order the functions were
+			// declared so that the program does not depend on how the threads were scheduled.
+			// Nested functions are only found by compiling their parent, so follow in the next wave.
 			{
 				m_context.SetPhase(VMCompilePhase::DeferredFunctions);
 
-				for (const auto& deferred_function : m_context.GetDeferredFunctions())
+				std::vector<std::pair<std::string, const ASTFunctionExpr*>> wave = m_context.GetDeferredFunctions();
+				while (!wave.empty())
 				{
-					const auto function_entry_offset = m_context.GetNextInstructionOffset();
-					m_context.UpdateOperand(*deferred_function.second.operand_offset, function_entry_offset);
+					std::vector<FunctionChunk> chunks(wave.size());
+
+					ParallelFor(wave.size(), m_thread_count, [&](size_t index)
+						{
+							chunks[index] = CompileChunk(wave[index].first, *wave[index].second);
+						});
 
-					if (deferred_function.first->Accept(*this) == ASTVisitorTraversal::Stop)
+					std::vector<std::pair<std::string, const ASTFunctionExpr*>> next_wave;
+
+					for (size_t index = 0; index < wave.size(); ++index)
 					{
-						std::println("Failed to compile function");
-						return ASTVisitorTraversal::Stop;
+						const FunctionChunk& chunk = chunks[index];
+						if (!chunk.compiled)
+						{
+							std::println("Failed to compile function");
+							return ASTVisitorTraversal::Stop;
+						}
+
+						if (m_cache)
+						{
+							m_cache->Store(chunk.fingerprint, chunk.compiled, chunk.reused);
+						}
+
+						m_context.SetFunctionEntry(wave[index].first, m_context.Append(chunk.compiled->context));
+
+						for (const auto& [identifier, function] : chunk.nested_functions)
+						{
+							if (!m_context.RegisterFunctionToCompile(identifier, function))
+							{
+								std::println("Function '{}' is already defined", identifier);
+								return ASTVisitorTraversal::Stop;
+							}
+							next_wave.push_back({ identifier, function });
+						}
+
+						m_constant_calls.insert(m_constant_calls.end(), chunk.constant_calls.begin(), chunk.constant_calls.end());
 					}
+
+					wave = std::move(next_wave);
 				}
 			}
 
+			if (!m_context.LinkFunctionCalls())
+			{
+				std::println("Failed to compile program");
+				return ASTVisitorTraversal::Stop;
+			}
+
 			m_context.GetStackBindings().ExitBlock();
 
 			return ASTVisitorTraversal::Continue;
 		}
 
 	private:
+		// A compiled function along with its calls and nested functions in the current AST
+		struct FunctionChunk
+		{
+			VMFunctionFingerprint fingerprint;
+			std::shared_ptr<const VMCompiledFunction> compiled;
+			bool reused = false;
+
+			std::vector<std::pair<std::string, const ASTFunctionExpr*>> nested_functions;
+			std::vector<const ASTFunctionCall*> constant_calls;
+		};
+
+		// Compiles a function, or takes it from the cache if nothing it depends on has changed.
+		// Called from several threads at once, so only reads the shared state.
+		FunctionChunk CompileChunk(const std::string& identifier, const ASTFunctionExpr& function) const
+		{
+			FunctionChunk chunk;
+
+			// Parses the body now if the parser skipped it
+			if (!function.GetBody())
+			{
+				std::println("Failed to parse function '{}': {}", identifier, function.GetBodyError().value_or(""));
+				return chunk;
+			}
+
+			VMFunctionHasher hasher(*m_program);
+			chunk.fingerprint = hasher.Hash(identifier, function);
+
+			if (m_cache)
+			{
+				chunk.compiled = m_cache->Find(chunk.fingerprint);
+				chunk.reused = chunk.compiled != nullptr;
+			}
+
+			if (!chunk.compiled)
+			{
+				VMCompiler function_compiler(m_program);
+				if (function_compiler.CompileFunction(function) == ASTVisitorTraversal::Stop)
+				{
+					return chunk;
+				}
+
+				std::shared_ptr<VMCompiledFunction> compiled = std::make_shared<VMCompiledFunction>();
+				for (const auto& [nested_identifier, nested_function] : function_compiler.m_context.GetDeferredFunctions())
+				{
+					compiled->nested_functions.push_back(nested_identifier);
+				}
+				for (const ASTFunctionCall* call : function_compiler.m_constant_calls)
+				{
+					compiled->constant_calls.push_back(std::ranges::find(hasher.GetCalls(), call) - hasher.GetCalls().begin());
+				}
+				compiled->context = std::move(function_compiler.m_context);
+
+				chunk.compiled = std::move(compiled);
+			}
+
+			for (const std::string& nested_identifier : chunk.compiled->nested_functions)
+			{
+				const auto declaration = std::ranges::find(hasher.GetNestedFunctions(), nested_identifier, &ASTFunctionDeclarationStmt::GetIdentifier);
+				chunk.nested_functions.push_back({ nested_identifier, (*declaration)->GetFunction() });
+			}
+			for (const size_t call : chunk.compiled->constant_calls)
+			{
+				chunk.constant_calls.push_back(hasher.GetCalls()[call]);
+			}
+
+			return chunk;
+		}
+
 		VMCompileContext m_context;
+		// What is being compiled laid out for the analyses that walk it linearly, apart
+		// from nested functions as each is compiled on its own
+		std::optional<FlatAST> m_flat_ast;
+
+		// Stack size just above the return address of the function being compiled
+		int32_t m_frame_base = 0;
+		// Whether the statement just compiled returns, making the rest of its block unreachable
+		bool m_has_returned = false;
+
+		std::shared_ptr<VMProgramInfo> m_program;
+		VMFunctionCache* m_cache = nullptr;
+		size_t m_thread_count = 1;
+
+		// Calls found by IsConstantCall, in the order they were compiled
+		std::vector<const ASTFunctionCall*> m_constant_calls;
+		// Cleared while compiling the arguments of a constant call, which are evaluated with it
+		bool m_collect_constant_calls = true;
 	};
 
-	std::optional<VMProgram> Compile(const AST& ast)
+	std::optional<VMProgram> CompileOptimised(const AST& ast, const VMCompileOptions& options)
+	{
+		std::optional<IRModule> module = BuildIR(ast);
+		if (!module)
+		{
+			std::println("Failed to compile");
+			return std::nullopt;
+		}
+
+		IRPassManager::CreateDefaultPipeline(options).Run(*module);
+
+		return options.profile ? GenerateProgram(*module, *options.profile) : GenerateProgram(*module);
+	}
+
+	std::optional<VMProgram> CompileDirect(const AST& ast, const VMCompileOptions& options, VMFunctionCache* cache)
 	{
-		VMCompiler compiler;
+		VMCompiler compiler(options, cache);
 
 		ASTVisitorTraversal result = ast.GetRoot()->Accept(compiler);
 
@@ -507,10 +2003,68 @@ namespace Osprey
 			return std::nullopt;
 		}
 
-		VMCompileContext context = compiler.GetContext();
+		// The constant calls are evaluated against the program as compiled, which is
+		// then compiled again with their results in place of the calls. Functions only
+		// called from those calls are no longer reachable, so are not emitted.
+		if (options.evaluation_fuel > 0)
+		{
+			std::unordered_map<const ASTFunctionCall*, int32_t> folded_calls = compiler.EvaluateConstantCalls(options.evaluation_fuel, options.evaluation_budget);
+			if (!folded_calls.empty())
+			{
+				VMCompiler folding_compiler(options, cache, std::move(folded_calls));
+
+				if (ast.GetRoot()->Accept(folding_compiler) == ASTVisitorTraversal::Stop)
+				{
+					std::println("Failed to compile");
+					return std::nullopt;
+				}
+
+				return folding_compiler.TakeProgram();
+			}
+		}
+
+		return compiler.TakeProgram();
+	}
+
+	std::optional<VMProgram> Compile(const AST& ast, const VMCompileOptions& options)
+	{
+		if (options.optimise)
+		{
+			return CompileOptimised(ast, options);
+		}
+
+		return CompileDirect(ast, options, nullptr);
+	}
+
+	VMIncrementalCompiler::VMIncrementalCompiler(const VMCompileOptions& options)
+		: m_options(options)
+		, m_cache(std::make_unique<VMFunctionCache>())
+	{
+	}
+
+	VMIncrementalCompiler::~VMIncrementalCompiler() = default;
+
+	std::optional<VMProgram> VMIncrementalCompiler::Compile(const AST& ast)
+	{
+		if (m_options.optimise)
+		{
+			return CompileOptimised(ast, m_options);
+		}
 
-		VMProgram program(context.GetInstructions());
+		m_cache->BeginCompile();
+		std::optional<VMProgram> program = CompileDirect(ast, m_options, m_cache.get());
+		m_cache->EndCompile();
 
 		return program;
 	}
+
+	size_t VMIncrementalCompiler::GetCompiledFunctionCount() const
+	{
+		return m_cache->GetCompiledCount();
+	}
+
+	size_t VMIncrementalCompiler::GetReusedFunctionCount() const
+	{
+		return m_cache->GetReusedCount();
+	}
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "OspreyVM/VMProfile.h"
+
+namespace Osprey
+{
+	void VMProfile::RecordBranch(size_t instruction_offset, bool taken)
+	{
+		VMBranchCounts& counts = m_branches[instruction_offset];
+		++(taken ? counts.taken : counts.not_taken);
+	}
+
+	void VMProfile::RecordJump(size_t instruction_offset)
+	{
+		++m_jumps[instruction_offset];
+	}
+
+	VMBranchCounts VMProfile::GetBranchCounts(size_t instruction_offset) const
+	{
+		const auto counts = m_branches.find(instruction_offset);
+		return counts != m_branches.end() ? counts->second : VMBranchCounts();
+	}
+
+	uint64_t VMProfile::GetJumpCount(size_t instruction_offset) const
+	{
+		const auto count = m_jumps.find(instruction_offset);
+		return count != m_jumps.end() ? count->second : 0;
+	}
+}
\ No newline at end of file
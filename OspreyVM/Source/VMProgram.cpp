@@ -7,70 +7,43 @@
 namespace Osprey
 {
 	VMProgram::VMProgram(std::vector<int32_t> in_program)
-		: m_program(in_program)
+		: m_program(std::move(in_program))
 	{
 	}
 
-	int32_t VMProgram::GetInstruction(size_t offset)
-	{
-		return m_program[offset];
-	}
-
 	void VMProgram::Dump() const
 	{
 		size_t instruction_offset = 0;
 		const size_t program_size = m_program.size();
 
-		bool stop = false;
-
-		while (instruction_offset < program_size && !stop)
+		while (instruction_offset < program_size)
 		{
 			const auto start_instruction_offset = instruction_offset;
 			const VMOpCode opcode = static_cast<VMOpCode>(m_program[instruction_offset]);
 			++instruction_offset;
 
-			switch (opcode)
+			if (opcode == VMOpCode::JTABLE)
 			{
-				case VMOpCode::PUSH:
-				{
-					const int32_t operand = m_program[instruction_offset++];
-					std::println("{}: PUSH {}", start_instruction_offset, operand);
-					break;
-				}
-				case VMOpCode::POP:
-				{
-					const int32_t operand = m_program[instruction_offset++];
-					std::println("{}: POP {}", start_instruction_offset, operand);
-					break;
-				}
-				case VMOpCode::DUP:
-				{
-					const int32_t operand = m_program[instruction_offset++];
-					std::println("{}: DUP {}", start_instruction_offset, operand);
-					break;
-				}
-				case VMOpCode::SWAP:
-				{
-					const int32_t operand = m_program[instruction_offset++];
-					std::println("{}: SWAP {}", start_instruction_offset, operand);
-					break;
-				}
-				case VMOpCode::JMP:
-				{
-					std::println("{}: JMP", start_instruction_offset);
-					break;
-				}
-				case VMOpCode::HALT:
-				{
-					std::println("{}: HALT", start_instruction_offset);
-					break;
-				}
-				default:
+				const int32_t entry_count = m_program[instruction_offset++];
+				const int32_t lowest_value = m_program[instruction_offset++];
+				const int32_t default_target = m_program[instruction_offset++];
+				std::println("{}: {} {} (from {}, default {})", start_instruction_offset, OpCodeToString(opcode), entry_count, lowest_value, default_target);
+
+				for (int32_t entry = 0; entry < entry_count; ++entry)
 				{
-					std::println("Unknown opcode");
+					std::println("{}:     {} => {}", instruction_offset, lowest_value + entry, m_program[instruction_offset]);
+					++instruction_offset;
 				}
 			}
+			else if (OpCodeOperandCount(opcode) > 0)
+			{
+				const int32_t operand = m_program[instruction_offset++];
+				std::println("{}: {} {}", start_instruction_offset, OpCodeToString(opcode), operand);
+			}
+			else
+			{
+				std::println("{}: {}", start_instruction_offset, OpCodeToString(opcode));
+			}
 		}
-
 	}
 }
\ No newline at end of file
@@ -1,81 +1,151 @@
 #include "OspreyVM/VMStackBindings.h"
 
 #include <cassert>
+#include <algorithm>
 
 namespace Osprey
 {
 	void VMStackBindings::ApplyOffset(int32_t delta)
 	{
-		m_block_sizes.back() += delta;
-		assert(m_block_sizes.back() >= 0);
+		m_blocks.back().size += delta;
+		m_stack_size += delta;
+		assert(m_blocks.back().size >= 0);
 	}
 	
 	void VMStackBindings::EnterBlock()
 	{
-		m_block_sizes.push_back(0);
+		Block& block = m_blocks.emplace_back();
+		block.bottom_offset = m_stack_size;
 	}
 
 	void VMStackBindings::ExitBlock()
 	{
-		assert(!m_block_sizes.empty());
+		assert(!m_blocks.empty());
 
-		for (size_t binding_index = m_bindings.size(); binding_index-- > 0;)
+		const int32_t block_index = static_cast<int32_t>(m_blocks.size()) - 1;
+
+		for (const SymbolId variable : m_blocks.back().variables)
 		{
-			Binding& binding = m_bindings[binding_index];
-			if (binding.owning_block == m_block_sizes.size() - 1)
+			const auto binding = m_bindings.find(variable);
+			assert(binding != m_bindings.end());
+
+			// Variables that reused a slot of an enclosing block hand it back
+			if (!binding->second.released && binding->second.slot_block < block_index)
 			{
-				m_bindings.erase(m_bindings.begin() + binding_index);
+				FreeSlot(binding->second.slot_block, binding->second.bottom_offset);
 			}
+			m_bindings.erase(binding);
 		}
 
-		ApplyOffset(-m_block_sizes.back());
-		m_block_sizes.pop_back();
+		// The block's own slots, free or not, are about to be popped
+		m_stack_size -= m_blocks.back().size;
+		m_blocks.pop_back();
 	}
 
 	int32_t VMStackBindings::GetStackSize() const
 	{
-		int32_t size = 0;
+		return m_stack_size;
+	}
+
+	int32_t VMStackBindings::GetTopStackSize() const
+	{
+		return m_blocks.back().size;
+	}
+
+	bool VMStackBindings::BindToVariable(SymbolId variable, int32_t offset_from_top)
+	{
+		assert(offset_from_top < GetStackSize()); // nothing to bind to
 
-		for (const int32_t block_size : m_block_sizes)
+		const int32_t bottom_offset = GetStackSize() - 1 - offset_from_top;
+		const int32_t owning_block = static_cast<int32_t>(m_blocks.size()) - 1;
+
+		const Binding binding = { bottom_offset, owning_block, FindSlotBlock(bottom_offset) };
+		if (!m_bindings.emplace(variable, binding).second)
 		{
-			size += block_size;
+			return false;
 		}
 
-		return size;
+		m_blocks.back().variables.push_back(variable);
+		return true;
 	}
 
-	int32_t VMStackBindings::GetTopStackSize() const
+	bool VMStackBindings::ReleaseVariable(SymbolId variable)
 	{
-		return m_block_sizes.back();
+		const auto binding = m_bindings.find(variable);
+		if (binding == m_bindings.end() || binding->second.released)
+		{
+			return false;
+		}
+
+		binding->second.released = true;
+		FreeSlot(binding->second.slot_block, binding->second.bottom_offset);
+		return true;
 	}
 
-	bool VMStackBindings::BindToVariable(std::string variable)
+	std::optional<int32_t> VMStackBindings::TakeFreeSlot()
 	{
-		for (const Binding& binding : m_bindings)
+		// Inner blocks sit higher on the stack, so the nearest slot is the largest
+		// in the innermost block that has any
+		for (auto block = m_blocks.rbegin(); block != m_blocks.rend(); ++block)
 		{
-			if (binding.identifier == variable)
+			if (block->free_slots.empty())
 			{
-				return false;
+				continue;
 			}
+
+			std::ranges::pop_heap(block->free_slots);
+			const int32_t bottom_offset = block->free_slots.back();
+			block->free_slots.pop_back();
+
+			return GetStackSize() - 1 - bottom_offset;
+		}
+
+		return std::nullopt;
+	}
+
+	int32_t VMStackBindings::TakeFreeSlotsAtTop()
+	{
+		std::vector<int32_t>& free_slots = m_blocks.back().free_slots;
+
+		int32_t count = 0;
+		while (!free_slots.empty() && free_slots.front() == GetStackSize() - 1 - count)
+		{
+			std::ranges::pop_heap(free_slots);
+			free_slots.pop_back();
+			++count;
 		}
 
-		assert(m_block_sizes.back() > 0); // nothing to bind to
+		return count;
+	}
 
-		const int32_t bottom_offset = GetStackSize() - 1;
+	std::optional<int32_t> VMStackBindings::GetBindingOffsetFromTop(SymbolId variable) const
+	{
+		const auto binding = m_bindings.find(variable);
+		if (binding == m_bindings.end() || binding->second.released)
+		{
+			return std::nullopt;
+		}
 
-		m_bindings.push_back(Binding(variable, bottom_offset, m_block_sizes.size() - 1));
+		return GetStackSize() - 1 - binding->second.bottom_offset;
 	}
 
-	std::optional<int32_t> VMStackBindings::GetBindingOffsetFromTop(std::string_view variable) const
+	int32_t VMStackBindings::FindSlotBlock(int32_t bottom_offset) const
 	{
-		for (const Binding& binding : m_bindings)
+		// Slots nearly always belong to the current block, otherwise search the enclosing ones
+		if (bottom_offset >= m_blocks.back().bottom_offset)
 		{
-			if (binding.identifier == variable)
-			{
-				return GetStackSize() - 1 - binding.bottom_offset;
-			}
+			return static_cast<int32_t>(m_blocks.size()) - 1;
 		}
 
-		return std::nullopt;
+		const auto block = std::ranges::upper_bound(m_blocks, bottom_offset, {}, &Block::bottom_offset);
+		assert(block != m_blocks.begin());
+		return static_cast<int32_t>(std::distance(m_blocks.begin(), block)) - 1;
+	}
+
+	void VMStackBindings::FreeSlot(int32_t block, int32_t bottom_offset)
+	{
+		std::vector<int32_t>& free_slots = m_blocks[block].free_slots;
+		free_slots.push_back(bottom_offset);
+		std::ranges::push_heap(free_slots);
 	}
 }
\ No newline at end of file
@@ -43,7 +43,7 @@ int main()
 		return 1;
 	}
 
-	std::optional<Osprey::VM> vm = Osprey::VM::Load(*program);
+	std::optional<Osprey::VM> vm = Osprey::VM::Load(std::move(*program));
 	if (!vm)
 	{
 		return 1;
@@ -1,13 +1,110 @@
 #include "OspreyAST/Tokeniser.h"
 #include "OspreyAST/ASTDump.h"
 #include "OspreyAST/Parser.h"
+#include "OspreyAST/MappedFile.h"
 #include "OspreyVM/VMCompiler.h"
 #include "OspreyVM/VM.h"
+#include "OspreyVM/VMProfile.h"
 
 #include <print>
 #include <filesystem>
 #include <vector>
-#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Every allocation is counted so the tests can check that the pipeline hands its
+	// buffers from one stage to the next rather than copying them
+	std::atomic<size_t> g_allocation_count = 0;
+
+	template<typename Function>
+	size_t CountAllocations(Function&& function)
+	{
+		const size_t allocation_count = g_allocation_count;
+		function();
+		return g_allocation_count - allocation_count;
+	}
+
+	// Tokenises the test files, repeated to at least 16 MiB, and reports the best throughput of several runs
+	int RunTokeniserBenchmark(const std::vector<std::filesystem::path>& files)
+	{
+		constexpr size_t MinScriptSize = 16 * 1'024 * 1'024;
+		constexpr size_t RunCount = 10;
+
+		std::string script;
+		for (const std::filesystem::path& file_path : files)
+		{
+			std::expected<Osprey::MappedFile, Osprey::ErrorMessage> file = Osprey::MappedFile::Open(file_path);
+			if (!file)
+			{
+				std::println(stderr, "[{}]: {}", file_path.filename().string(), file.error());
+				return 1;
+			}
+			script.append(file->GetContents());
+			script.push_back('\n');
+		}
+
+		if (script.size() <= files.size())
+		{
+			std::println(stderr, "The test files are empty");
+			return 1;
+		}
+
+		const size_t file_size = script.size();
+		while (script.size() < MinScriptSize)
+		{
+			script.append(script, 0, file_size);
+		}
+
+		double best_seconds = 0.0;
+		size_t token_count = 0;
+		for (size_t run = 0; run < RunCount; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			std::expected<Osprey::TokenBuffer, Osprey::ErrorMessage> tokens = Osprey::Tokenise(script);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			if (!tokens)
+			{
+				std::println(stderr, "Tokeniser Error: {}", tokens.error());
+				return 1;
+			}
+
+			token_count = tokens->size();
+			if (run == 0 || elapsed.count() < best_seconds)
+			{
+				best_seconds = elapsed.count();
+			}
+		}
+
+		const double megabytes = static_cast<double>(script.size()) / (1'024.0 * 1'024.0);
+		std::println("Tokenised {:.1f} MiB ({} tokens) at {:.1f} MiB/s, best of {} runs", megabytes, token_count, megabytes / best_seconds, RunCount);
+		return 0;
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	++g_allocation_count;
+	if (void* memory = std::malloc(size > 0 ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
 
 int main(int argc, char* argv[])
 {
@@ -17,6 +114,9 @@ int main(int argc, char* argv[])
 		return 1;
 	}
 
+	// Tests <path> --benchmark-tokeniser measures the tokeniser on the test files instead of running them
+	const bool benchmark_tokeniser = argc > 2 && std::string_view(argv[2]) == "--benchmark-tokeniser";
+
 	std::vector<std::filesystem::path> test_files_to_run;
 	const std::string location = argv[1];
 	constexpr std::string_view filetype_extension = ".osp";
@@ -50,72 +150,200 @@ int main(int argc, char* argv[])
 		test_files_to_run.push_back(location);
 	}
 
+	if (benchmark_tokeniser)
+	{
+		return RunTokeniserBenchmark(test_files_to_run);
+	}
+
 	std::println(stderr, "Running {} test(s)", test_files_to_run.size());
 
-	for (const std::filesystem::path& file_path : test_files_to_run)
+	struct TestConfiguration
 	{
-		const auto ReportError = [&](const std::string& message)
-			{
-				std::println("[{}]: {} {}", file_path.filename().string(), test_fail_prefix, message);
-			};
+		std::string_view name;
+		Osprey::VMCompileOptions options;
+		// Compile twice with a VMIncrementalCompiler and run the relinked program
+		bool incremental = false;
+		// Run the program once to profile it, then run it again compiled with the profile
+		bool profiled = false;
+		// Parse straight from a TokenStream instead of a TokenBuffer
+		bool streamed = false;
+		// How to parse the TokenBuffer when not streamed
+		Osprey::ParseOptions parse_options = {};
+		// Reparse the script after typing in a function and again after deleting it
+		bool reparsed = false;
+	};
 
-		std::ifstream file(file_path, std::ios::binary);
+	// Every test is run through each compiler pipeline
+	const TestConfiguration configurations[] =
+	{
+		{ .name = "direct", .options = { .optimise = false } },
+		{ .name = "optimised", .options = { .optimise = true } },
+		{ .name = "incremental", .options = { .optimise = false }, .incremental = true },
+		{ .name = "profiled", .options = { .optimise = true }, .profiled = true },
+		{ .name = "streamed", .options = { .optimise = true }, .streamed = true },
+		{ .name = "chunked", .options = { .optimise = false }, .parse_options = { .thread_count = 4, .min_chunk_tokens = 1 } },
+		{ .name = "lazy", .options = { .optimise = false }, .parse_options = { .lazy_function_bodies = true } },
+		{ .name = "reparsed", .options = { .optimise = false }, .reparsed = true },
+	};
 
-		file.seekg(0, std::ios::end);
-		std::string file_data;
-		file_data.resize(file.tellg());
+	// What the VM allocates for itself, e.g. its memory, regardless of the program
+	const size_t vm_allocation_count = CountAllocations([] { Osprey::VM::Load(Osprey::VMProgram({})); });
 
-		file.seekg(0, std::ios::beg);
-		file.read(file_data.data(), file_data.size());
+	size_t failure_count = 0;
 
-		std::expected<Osprey::TokenBuffer, Osprey::ErrorMessage> tokens = Osprey::Tokenise(file_data);
-		if (!tokens)
+	for (const std::filesystem::path& file_path : test_files_to_run)
+	{
+		std::expected<Osprey::MappedFile, Osprey::ErrorMessage> file = Osprey::MappedFile::Open(file_path);
+		if (!file)
 		{
-			ReportError(std::format("Tokeniser Error: {}", tokens.error()));
+			std::println("[{}]: {} {}", file_path.filename().string(), test_fail_prefix, file.error());
+			++failure_count;
 			continue;
 		}
 
-		std::expected<Osprey::AST, Osprey::ErrorMessage> ast = Osprey::Parse(*tokens);
-		if (!ast)
-		{
-			ReportError(std::format("Parser Error: {}", ast.error()));
-			continue;
-		}
+		const std::string_view file_data = file->GetContents();
 
-		std::optional<Osprey::VMProgram> program = Osprey::Compile(*ast);
-		if (!program)
+		for (const auto& [configuration_name, options, incremental, profiled, streamed, parse_options, reparsed] : configurations)
 		{
-			ReportError("Compile Error");
-			continue;
-		}
+			const auto ReportError = [&](const std::string& message)
+				{
+					std::println("[{}, {}]: {} {}", file_path.filename().string(), configuration_name, test_fail_prefix, message);
+					++failure_count;
+				};
 
-		//program->Dump();
+			// Declared first as lazily parsed function bodies are parsed from the tokens later
+			std::expected<Osprey::TokenBuffer, Osprey::ErrorMessage> tokens = std::unexpected("");
+			std::optional<Osprey::TokenBuffer> moved_tokens;
+			std::expected<Osprey::AST, Osprey::ErrorMessage> ast = std::unexpected("");
+			if (streamed)
+			{
+				Osprey::TokenStream stream(file_data);
+				ast = Osprey::Parse(stream);
+			}
+			else
+			{
+				tokens = Osprey::Tokenise(file_data);
+				if (!tokens)
+				{
+					ReportError(std::format("Tokeniser Error: {}", tokens.error()));
+					continue;
+				}
 
-		std::optional<Osprey::VM> vm = Osprey::VM::Load(*program);
-		if (!vm)
-		{
-			ReportError("VM Error");
-			continue;
-		}
+				ast = Osprey::Parse(*tokens, parse_options);
 
-		vm->Execute();
+				// Lazily parsed function bodies should still find their tokens once the buffer
+				// is moved, e.g. into a ParsedScript, and the one they were parsed from is gone
+				if (parse_options.lazy_function_bodies)
+				{
+					moved_tokens.emplace(std::move(*tokens));
+					tokens = std::unexpected("");
+				}
+			}
 
-		const Osprey::VMStack& stack = vm->GetStack();
+			if (reparsed && ast)
+			{
+				const size_t main_offset = file_data.find("main :=");
+				const Osprey::TextEdit insertion = { main_offset != std::string_view::npos ? main_offset : 0, 0, "inserted := () -> i32\n{\n\treturn 1;\n}\n\n" };
+				const std::string edited_data = std::format("{}{}{}", file_data.substr(0, insertion.offset), insertion.text, file_data.substr(insertion.offset));
 
-		if (stack.GetSize() == 0)
-		{
-			ReportError(std::format("Expected test to produce a value, received {}", stack.GetSize()));
-			continue;
-		}
+				std::expected<Osprey::ParsedScript, Osprey::ErrorMessage> edited = Osprey::Reparse(std::move(*ast), std::move(*tokens), edited_data, insertion);
+				if (edited)
+				{
+					const Osprey::TextEdit deletion = { insertion.offset, insertion.text.size(), "" };
+					edited = Osprey::Reparse(std::move(edited->ast), std::move(edited->tokens), file_data, deletion);
+				}
 
-		if (stack.GetFromTop(0) != 0)
-		{
-			ReportError("Test failed");
-			continue;
-		}
+				if (!edited)
+				{
+					ReportError(std::format("Reparse Error: {}", edited.error()));
+					continue;
+				}
+
+				tokens = std::move(edited->tokens);
+				ast = std::move(edited->ast);
+			}
+
+			if (!ast)
+			{
+				ReportError(std::format("Parser Error: {}", ast.error()));
+				continue;
+			}
+
+			std::optional<Osprey::VMProgram> program;
+			if (incremental)
+			{
+				Osprey::VMIncrementalCompiler compiler(options);
+				compiler.Compile(*ast);
+				program = compiler.Compile(*ast);
 
-		std::println("[{}]: {}", file_path.filename().string(), test_pass_prefix);
+				if (program && compiler.GetCompiledFunctionCount() > 0)
+				{
+					ReportError(std::format("Expected every function to be reused, {} were compiled again", compiler.GetCompiledFunctionCount()));
+					continue;
+				}
+			}
+			else if (profiled)
+			{
+				Osprey::VMProfile profile;
+				if (std::optional<Osprey::VMProgram> profiled_program = Osprey::Compile(*ast, options))
+				{
+					std::optional<Osprey::VM> profiled_vm = Osprey::VM::Load(std::move(*profiled_program));
+					profiled_vm->SetProfile(&profile);
+					profiled_vm->Execute();
+				}
+
+				Osprey::VMCompileOptions profiled_options = options;
+				profiled_options.profile = &profile;
+				program = Osprey::Compile(*ast, profiled_options);
+			}
+			else
+			{
+				program = Osprey::Compile(*ast, options);
+			}
+
+			if (!program)
+			{
+				ReportError("Compile Error");
+				continue;
+			}
+
+			//program->Dump();
+
+			// The VM must take the compiled bytecode as it is, without allocating a copy
+			const int32_t* bytecode = program->GetInstructions().data();
+			std::optional<Osprey::VM> vm;
+			const size_t load_allocation_count = CountAllocations([&] { vm = Osprey::VM::Load(std::move(*program)); });
+			if (!vm)
+			{
+				ReportError("VM Error");
+				continue;
+			}
+
+			if (load_allocation_count > vm_allocation_count || vm->GetProgram().GetInstructions().data() != bytecode)
+			{
+				ReportError(std::format("Loading the program made {} allocation(s), expected at most {}", load_allocation_count, vm_allocation_count));
+				continue;
+			}
+
+			vm->Execute();
+
+			const Osprey::VMStack& stack = vm->GetStack();
+
+			if (stack.GetSize() == 0)
+			{
+				ReportError(std::format("Expected test to produce a value, received {}", stack.GetSize()));
+				continue;
+			}
+
+			if (stack.GetFromTop(0) != 0)
+			{
+				ReportError("Test failed");
+				continue;
+			}
+
+			std::println("[{}, {}]: {}", file_path.filename().string(), configuration_name, test_pass_prefix);
+		}
 	}
 
-	return 0;
+	return failure_count > 0 ? 1 : 0;
 }
\ No newline at end of file